@@ -16,7 +16,9 @@
 #define MSUNUSED __attribute__((unused))
 #define MSUSERET __attribute__((warn_unused_result))
 #define MSINLINE __attribute__((always_inline))
+#define MSNOINLINE __attribute__((noinline))
 #define MSUNREACHABLE __builtin_unreachable()
+#define MS_PREFETCH(addr) __builtin_prefetch(addr) // Read prefetch hint
 
 #define MS_ALIGNED(x) __attribute__((aligned (x)))
 
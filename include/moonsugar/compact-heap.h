@@ -0,0 +1,75 @@
+/**
+ * @file
+ *
+ * Compacting heap.
+ *
+ * A compacting heap hands out handles instead of pointers, and is
+ * free to move the blocks in memory, so that freed memory can be
+ * reclaimed regardless of fragmentation.
+ *
+ * Blocks are allocated by bumping the heap top. Freed blocks become
+ * holes, reclaimed by compaction: live blocks slide towards the heap
+ * base, in address order, and the handle table is updated to their
+ * new address. Compaction is incremental - each step moves blocks
+ * until its time budget runs out, so that it can run during idle time.
+ * Allocation and deallocation are allowed between steps. A full
+ * compaction is run when the heap top is exhausted.
+ *
+ * Handles are resolved to pointers via `ms_compact_heap_resolve()`.
+ * A pointer is only valid until the next compaction step or allocation.
+ *
+ * Blocks are aligned to `MS_COMPACT_HEAP_ALIGNMENT`.
+ *
+ * Compacting heaps are not thread-safe.
+ */
+#ifndef MS_COMPACT_HEAP_H
+#define MS_COMPACT_HEAP_H
+
+#include <moonsugar/api.h>
+#include <moonsugar/memory.h>
+#include <moonsugar/containers/indexed-pool.h>
+
+#define MS_COMPACT_HEAP_ALIGNMENT (16u) // Alignment of all the blocks
+
+MS_HDECL(ms_compact_handle);
+
+typedef struct {
+  ms_allocator allocator; // Handle table allocator
+  uint64_t size; // Max heap size, in bytes - multiple of the OS page size
+  uint32_t handle_capacity; // Initial number of handles - multiple of 64, grows on demand
+} ms_compact_heap_description;
+
+typedef struct {
+  uint8_t *base;
+  uint64_t size;
+  uint64_t committed_size;
+  uint8_t *top; // End of the last block
+  uint64_t free_size; // Size of the holes below the top, in bytes
+  uint8_t *scan; // Next block to compact - NULL when no compaction is in progress
+  uint8_t *dest; // Destination of the next block to compact
+  ms_ipool handles;
+  void **blocks; // Block address of each handle
+  ms_allocator allocator; // Handle table allocator - not owned
+} ms_compact_heap;
+
+MSAPI ms_result ms_compact_heap_construct(ms_compact_heap *const heap, ms_compact_heap_description const *const description);
+MSAPI void ms_compact_heap_destroy(ms_compact_heap *const heap);
+MSAPI MSUSERET ms_compact_handle ms_compact_heap_malloc(ms_compact_heap *const heap, size_t const count); // Returns an invalid handle on failure or if count is 0
+MSAPI void ms_compact_heap_free(ms_compact_heap *const heap, ms_compact_handle const handle);
+MSAPI MSUSERET size_t ms_compact_heap_get_size(ms_compact_heap const *const heap, ms_compact_handle const handle); // Usable size of a block, in bytes
+MSAPI bool ms_compact_heap_compact(ms_compact_heap *const heap, ms_time const budget); // Run a compaction step - Returns true when compaction completes
+
+/**
+ * Get the current address of a block.
+ *
+ * @param heap The heap owning the block.
+ * @param handle A valid handle to the block.
+ *
+ * @return A pointer to the block, valid until the next compaction
+ *  step or allocation.
+ */
+MSINLINE MSUSERET inline static void * ms_compact_heap_resolve(ms_compact_heap const *const heap, ms_compact_handle const handle) {
+  return heap->blocks[handle.raw];
+}
+
+#endif // MS_COMPACT_HEAP_H
@@ -0,0 +1,163 @@
+/**
+ * @file
+ *
+ * Allocator composition.
+ *
+ * Composite allocators route each allocation to one of a set of
+ * allocators, and are themselves exposed as an `ms_allocator`,
+ * so that they can be nested:
+ *
+ * - Fallback: allocate from a primary allocator, then from a
+ *   secondary one when the primary fails.
+ * - Segregator: allocate up to a threshold size from one allocator,
+ *   and larger blocks from another.
+ * - Bucketizer: allocate each size range from its own allocator.
+ *
+ * Blocks are freed and reallocated by the allocator owning them,
+ * found by testing ownership on the routed allocators that provide
+ * an ownership callback. At most one routed allocator can lack it:
+ * that allocator owns all the blocks not claimed by the others, so
+ * the others must not own its memory, as a parent allocator would.
+ *
+ * Reallocation moves a block to the other allocator of a fallback
+ * when the primary fails, and across the threshold of a segregator.
+ * Moving a block copies it, so its owner must report the usable
+ * size of its blocks: blocks of allocators without a size callback
+ * are reallocated in place by their owner. Bucketizers never move
+ * blocks.
+ *
+ * Composite allocators own none of the routed allocators and are
+ * as thread-safe as the allocators they route to. No destructor
+ * is necessary.
+ */
+#ifndef MS_COMPOSE_H
+#define MS_COMPOSE_H
+
+#include <moonsugar/api.h>
+#include <moonsugar/memory.h>
+
+#define MS_BUCKETIZER_MAX_BUCKETS (16u) // Max number of size ranges of a bucketizer
+
+#define MS_ALLOCATOR_DEF_FALLBACK(fallback) (ms_allocator) { \
+  (ms_malloc_clbk)ms_fallback_malloc, \
+  (ms_free_clbk)ms_fallback_free, \
+  (ms_realloc_clbk)ms_fallback_realloc, \
+  &(fallback), \
+  NULL, \
+  NULL, \
+  NULL \
+}
+
+#define MS_ALLOCATOR_DEF_SEGREGATOR(segregator) (ms_allocator) { \
+  (ms_malloc_clbk)ms_segregator_malloc, \
+  (ms_free_clbk)ms_segregator_free, \
+  (ms_realloc_clbk)ms_segregator_realloc, \
+  &(segregator), \
+  NULL, \
+  NULL, \
+  NULL \
+}
+
+#define MS_ALLOCATOR_DEF_BUCKETIZER(bucketizer) (ms_allocator) { \
+  (ms_malloc_clbk)ms_bucketizer_malloc, \
+  (ms_free_clbk)ms_bucketizer_free, \
+  (ms_realloc_clbk)ms_bucketizer_realloc, \
+  &(bucketizer), \
+  NULL, \
+  NULL, \
+  NULL \
+}
+
+/**
+ * Ownership test callback.
+ *
+ * @param user The user pointer as stored in the allocator.
+ * @param ptr A pointer to the base of a memory block.
+ *
+ * @return True if the block was allocated by the allocator.
+ */
+typedef bool (*ms_owns_clbk)(void * const user, void * const ptr);
+
+/**
+ * Block size callback.
+ *
+ * @param user The user pointer as stored in the allocator.
+ * @param ptr A pointer to the base of a memory block owned by the allocator.
+ *
+ * @return The usable size of the block, in bytes.
+ */
+typedef size_t (*ms_size_clbk)(void * const user, void * const ptr);
+
+typedef struct {
+  ms_allocator allocator; // Not owned
+  ms_owns_clbk owns; // NULL = owns the blocks not claimed by the other allocators
+  ms_size_clbk get_size; // NULL = blocks are never moved out of this allocator
+} ms_routed_allocator;
+
+/*
+ * Fallback
+ */
+
+typedef struct {
+  ms_routed_allocator primary;
+  ms_routed_allocator secondary; // Serves the allocations and reallocations the primary fails
+} ms_fallback_description;
+
+typedef struct {
+  ms_routed_allocator primary;
+  ms_routed_allocator secondary;
+} ms_fallback;
+
+MSAPI ms_result ms_fallback_construct(ms_fallback *const fallback, ms_fallback_description const *const description); // MS_RESULT_INVALID_ARGUMENT if neither allocator tests ownership
+MSAPI MSUSERET void * ms_fallback_malloc(ms_fallback *const fallback, size_t const count, size_t const alignment); // Returns NULL if both allocators fail
+MSAPI MSUSERET void * ms_fallback_realloc(ms_fallback *const fallback, void *const ptr, size_t const new_count);
+MSAPI void ms_fallback_free(ms_fallback *const fallback, void *const ptr);
+
+/*
+ * Segregator
+ */
+
+typedef struct {
+  ms_routed_allocator small; // Serves allocations up to the threshold
+  ms_routed_allocator large; // Serves allocations larger than the threshold
+  size_t threshold; // In bytes
+} ms_segregator_description;
+
+typedef struct {
+  size_t threshold;
+  ms_routed_allocator small;
+  ms_routed_allocator large;
+} ms_segregator;
+
+MSAPI ms_result ms_segregator_construct(ms_segregator *const segregator, ms_segregator_description const *const description); // MS_RESULT_INVALID_ARGUMENT if neither allocator tests ownership
+MSAPI MSUSERET void * ms_segregator_malloc(ms_segregator *const segregator, size_t const count, size_t const alignment); // Returns NULL on failure
+MSAPI MSUSERET void * ms_segregator_realloc(ms_segregator *const segregator, void *const ptr, size_t const new_count);
+MSAPI void ms_segregator_free(ms_segregator *const segregator, void *const ptr);
+
+/*
+ * Bucketizer
+ */
+
+typedef struct {
+  ms_routed_allocator allocator;
+  size_t max_size; // Largest allocation served, in bytes - the bucket serves sizes above the max size of the previous one
+} ms_bucket;
+
+typedef struct {
+  ms_bucket const *buckets; // Sorted by max size
+  uint32_t bucket_count; // Up to MS_BUCKETIZER_MAX_BUCKETS
+} ms_bucketizer_description;
+
+typedef struct {
+  size_t max_sizes[MS_BUCKETIZER_MAX_BUCKETS]; // Kept apart from the allocators to speed up the size lookup
+  ms_routed_allocator allocators[MS_BUCKETIZER_MAX_BUCKETS];
+  uint32_t bucket_count;
+  uint32_t default_owner; // Index of the bucket owning the blocks not claimed by the others
+} ms_bucketizer;
+
+MSAPI ms_result ms_bucketizer_construct(ms_bucketizer *const bucketizer, ms_bucketizer_description const *const description); // MS_RESULT_INVALID_ARGUMENT on bad bucket count, order or ownership
+MSAPI MSUSERET void * ms_bucketizer_malloc(ms_bucketizer *const bucketizer, size_t const count, size_t const alignment); // Returns NULL on failure or when larger than the last bucket
+MSAPI MSUSERET void * ms_bucketizer_realloc(ms_bucketizer *const bucketizer, void *const ptr, size_t const new_count);
+MSAPI void ms_bucketizer_free(ms_bucketizer *const bucketizer, void *const ptr);
+
+#endif // MS_COMPOSE_H
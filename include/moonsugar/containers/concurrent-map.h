@@ -0,0 +1,83 @@
+/**
+ * @file
+ *
+ * Concurrent hash map.
+ *
+ * Keys are partitioned across a power of 2 number of shards, each
+ * an `ms_map` guarded by its own reader-writer lock, so that threads
+ * working on different shards never contend. Shards are selected by
+ * hash bits not used for the slot lookup.
+ *
+ * Values are copied out under the shard lock, as the slots of a
+ * shard move when pairs are inserted or removed.
+ */
+#ifndef MS_CONTAINERS_CONCURRENT_MAP_H
+#define MS_CONTAINERS_CONCURRENT_MAP_H
+
+#include <moonsugar/api.h>
+#include <moonsugar/memory.h>
+#include <moonsugar/thread.h>
+#include <moonsugar/containers/map.h>
+
+/**
+ * Compute the value of an absent key.
+ *
+ * Invoked with the shard write lock held - must not access the map.
+ *
+ * @param key The key.
+ * @param out_value The value to set.
+ * @param ctx The user context.
+ *
+ * @return MS_RESULT_SUCCESS to insert the value, any other value to
+ *  leave the map untouched.
+ */
+typedef ms_result (*ms_cmap_compute_clbk)(void const *const key, void *const out_value, void *const ctx);
+
+typedef struct {
+  MS_ALIGNED(MS_CACHE_LINE_SIZE) ms_rwlock lock; // Shard access synchronization
+  ms_map map;
+} ms_cmap_shard;
+
+typedef struct {
+  ms_map_description map; // Description of each shard - the allocator must be thread-safe
+  uint32_t shard_count; // Power of 2 - 0 = one per logical processor, rounded up
+} ms_cmap_description;
+
+typedef struct {
+  ms_allocator allocator; // Allocator of the shard array
+  ms_cmap_shard *shards;
+  uint32_t shard_count;
+} ms_cmap;
+
+MSAPI ms_result ms_cmap_construct(ms_cmap *const map, ms_cmap_description const *const description);
+MSAPI void ms_cmap_destroy(ms_cmap *const map); // All threads must have stopped using the map
+MSAPI bool ms_cmap_get(ms_cmap *const map, void const *const key, void *const out_value); // Copy the value of a key - Returns false if the key is not found
+MSAPI ms_result ms_cmap_set(ms_cmap *const map, void const *const key, void const *const value);
+MSAPI bool ms_cmap_remove(ms_cmap *const map, void const *const key); // Returns true if the key was found
+
+/**
+ * Get the value of a key, inserting a computed value if absent.
+ *
+ * The value is computed at most once per key, even if multiple
+ * threads race on the same key.
+ *
+ * @param map The map.
+ * @param key The key.
+ * @param compute The routine computing the value of an absent key.
+ * @param ctx The user context of the routine.
+ * @param out_value The value of the key, existing or computed.
+ *
+ * @return MS_RESULT_SUCCESS on success, the routine result if it fails,
+ *  or the insertion error.
+ */
+MSAPI ms_result ms_cmap_compute_if_absent(
+  ms_cmap *const map,
+  void const *const key,
+  ms_cmap_compute_clbk const compute,
+  void *const ctx,
+  void *const out_value
+);
+
+MSAPI uint32_t ms_cmap_get_count(ms_cmap *const map); // Number of pairs - only exact when no thread modifies the map
+
+#endif // MS_CONTAINERS_CONCURRENT_MAP_H
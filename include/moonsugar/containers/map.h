@@ -2,6 +2,18 @@
  * @file
  *
  * Hash map implementation.
+ *
+ * Each slot has a control byte, holding 7 bits of the key hash when
+ * the slot is full. A key is looked up by probing the slots that
+ * follow its home slot, one group at a time: the control bytes of a
+ * group are matched against the hash bits at once, with SIMD
+ * instructions, so that only the candidate keys are compared.
+ *
+ * Pairs are inserted Robin Hood style - a pair displaces the pairs
+ * closer to their home slot - and removed by shifting back the pairs
+ * that follow, which keeps probe sequences short and free of empty
+ * slots. Growable maps grow when their load exceeds 87.5%, fixed-size
+ * maps can be filled up to their capacity.
  */
 #ifndef MS_CONTAINERS_MAP_H
 #define MS_CONTAINERS_MAP_H
@@ -11,7 +23,22 @@
 #include <moonsugar/functional.h>
 #include <moonsugar/hash.h>
 
-#define MS_MAP_SLICE_SIZE (16u)
+#if defined(__arm64__)
+  #include <arm_neon.h>
+#endif
+
+#define MS_MAP_GROUP_SIZE (16u) // Number of control bytes matched at once
+#define MS_MAP_MAX_PROBE (255u) // Max probe length of a pair - a map grows when exceeded
+#define MS_MAP_GET_MAX_COUNT(capacity) ((capacity) - (capacity) / 8u) // Max pair count of a growable map
+
+#define MS_MAP_CTRL_EMPTY ((uint8_t)0x80) // Control byte of an empty slot
+#define MS_MAP_CTRL_H2(h) ((uint8_t)((h) >> 57)) // Control byte of a full slot - 7 bits of the mixed hash
+
+#if defined(__arm64__)
+  #define MS_MAP_GROUP_MASK_SHIFT (2u) // One bit per 4 in group masks
+#else
+  #define MS_MAP_GROUP_MASK_SHIFT (0u) // One bit per slot in group masks
+#endif
 
 #define MS_MAP_GET_KEY(map, index) ((void*)((uint8_t*)(map)->keys + (index) * (map)->key_size))
 #define MS_MAP_GET_VALUE(map, index) ((void*)((uint8_t*)(map)->values + (index) * (map)->value_size))
@@ -36,7 +63,11 @@ typedef struct {
   uint32_t growth_factor;
   uint32_t key_size;
   uint32_t value_size;
-  void *keys;
+  uint32_t count; // Number of pairs
+  uint32_t max_probe; // Upper bound of the probe lengths - reset on resize
+  uint8_t *ctrl; // Control bytes - capacity + MS_MAP_GROUP_SIZE, the bytes past the capacity mirror the first ones
+  uint8_t *probes; // Probe length of each full slot - distance from the home slot of its key
+  void *keys; // Empty slots hold none keys
   void *values;
   ms_allocator allocator;
   ms_equals_clbk are_keys_equal;
@@ -45,6 +76,76 @@ typedef struct {
   ms_none_set_clbk set_key_none;
 } ms_map;
 
+typedef struct {
+  uint32_t count; // Number of pairs
+  uint32_t capacity;
+  uint32_t max_probe; // Longest probe length
+  double mean_probe; // Mean probe length - 0 = all pairs in their home slot
+  double load_factor; // count / capacity
+} ms_map_stats;
+
+typedef uint64_t ms_map_group_mask; // Set bits = matching slots of a group
+
+/**
+ * Mix a key hash, so that identity hashes spread evenly.
+ *
+ * The low bits select the home slot, the high bits the control byte.
+ */
+MSINLINE MSUSERET inline static uint64_t ms_map_mix_hash(uint64_t const h) {
+  uint64_t const product = h * 0x9e3779b97f4a7c15ull;
+
+  return product ^ (product >> 32);
+}
+
+/**
+ * Match the control bytes of a group against a value.
+ *
+ * @param ctrl The first control byte of the group.
+ * @param value The control byte to match.
+ *
+ * @return The mask of the matching slots - see `ms_map_group_mask_first()`.
+ */
+MSINLINE MSUSERET inline static ms_map_group_mask ms_map_group_match(uint8_t const *const ctrl, uint8_t const value) {
+#if defined(__x86_64__)
+  __m128i const group = _mm_loadu_si128((__m128i const *)ctrl);
+
+  return (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(group, _mm_set1_epi8((char)value)));
+#elif defined(__arm64__)
+  uint8x16_t const matches = vceqq_u8(vld1q_u8(ctrl), vdupq_n_u8(value));
+  uint8x8_t const nibbles = vshrn_n_u16(vreinterpretq_u16_u8(matches), 4); // One nibble per slot
+
+  return vget_lane_u64(vreinterpret_u64_u8(nibbles), 0) & 0x8888888888888888ull;
+#else
+  ms_map_group_mask mask = 0;
+
+  for(uint32_t i = 0; i < MS_MAP_GROUP_SIZE; ++i) {
+    mask |= (ms_map_group_mask)(ctrl[i] == value) << i;
+  }
+
+  return mask;
+#endif
+}
+
+/**
+ * Get the offset of the first matching slot of a non-empty group mask.
+ *
+ * Clear it with `mask &= mask - 1`.
+ */
+MSINLINE MSUSERET inline static uint32_t ms_map_group_mask_first(ms_map_group_mask const mask) {
+  return (uint32_t)__builtin_ctzll(mask) >> MS_MAP_GROUP_MASK_SHIFT;
+}
+
+/**
+ * Set the control byte of a slot, and its mirrors.
+ */
+MSINLINE inline static void ms_map_set_ctrl(uint8_t *const ctrl, uint32_t const capacity, uint32_t const index, uint8_t const value) {
+  ctrl[index] = value;
+
+  for(uint32_t i = index + capacity; i < capacity + MS_MAP_GROUP_SIZE; i += capacity) {
+    ctrl[i] = value;
+  }
+}
+
 MSAPI ms_result ms_map_construct( 
   ms_map *const map, 
   ms_map_description const *const description
@@ -69,9 +170,225 @@ MSAPI ms_result ms_map_set(
 ); 
 
 MSAPI bool ms_map_remove( 
-  ms_map const *const map, 
+  ms_map *const map, 
   void const *const key
 );
 
+MSAPI void ms_map_remove_at(
+  ms_map *const map,
+  uint32_t const index
+); // Remove the pair of a full slot
+
+MSAPI void ms_map_get_stats(
+  ms_map const *const map,
+  ms_map_stats *const out_stats
+);
+
+MSAPI ms_result ms_map_resize(
+  ms_map *const map,
+  uint32_t const new_capacity
+); // Capacity must be a power of 2 - Returns MS_RESULT_FULL if the pairs do not fit, the map is left untouched
+
+MSAPI ms_result ms_map_reserve(
+  ms_map *const map,
+  uint32_t const count
+); // Grow so that count pairs fit without growing past the max load
+
+MSAPI void ms_map_clear(ms_map *const map); // Remove all the pairs, keeping the capacity
+
+/**
+ * Iterate the pairs of a map.
+ *
+ * The map must not be modified during iteration.
+ *
+ * @param map The map to iterate.
+ * @param cursor The iteration cursor - 0 to start from the first pair.
+ * @param out_key The key of the next pair - can be NULL.
+ * @param out_value The value of the next pair - can be NULL.
+ *
+ * @return True if a pair was found, false past the last pair.
+ */
+MSAPI bool ms_map_next(
+  ms_map const *const map,
+  uint32_t *const cursor,
+  void **const out_key,
+  void **const out_value
+);
+
+/*
+ * Bulk operations
+ *
+ * Keys and values are passed as packed arrays. Keys are processed in
+ * batches: all the keys of a batch are hashed and the memory of their
+ * home slot prefetched before probing, so that the cache misses of
+ * different keys overlap.
+ */
+
+MSAPI ms_result ms_map_set_many(
+  ms_map *const map,
+  uint32_t const count,
+  void const *const keys,
+  void const *const values
+); // Set count pairs - Stops at the first failure, the previous pairs are set
+
+MSAPI uint32_t ms_map_get_many(
+  ms_map const *const map,
+  uint32_t const count,
+  void const *const keys,
+  void **const out_values
+); // Look up count keys - Sets the value pointers, NULL for keys not found, and returns the number of keys found
+
+MSAPI MSUSERET uint32_t ms_map_get_index(
+  ms_map const *const map,
+  void const *const key,
+  uint64_t const h // Mixed key hash - see `ms_map_mix_hash()`
+); // Find the slot holding a key - Returns the slot index or UINT32_MAX if the key is not found
+
+MSAPI ms_result ms_map_insert_hashed(
+  ms_map *const map,
+  uint64_t const h, // Mixed key hash - see `ms_map_mix_hash()`
+  void const *const key,
+  void const *const value
+); // Insert a key known to be absent - Grows the map when full, as ms_map_set()
+
+/*
+ * Typed maps
+ *
+ * MS_MAP_DEFINE() generates functions specialized for a key and value
+ * type, operating on an `ms_map`. Hashing and key comparison are
+ * inlined and keys and values are accessed by type, with no indirect
+ * call or memcpy on lookup. The hash and equality functions can be
+ * macros, such as MS_MAP_HASH_IDENTITY and MS_MAP_EQUALS.
+ *
+ * The generic functions also work on typed maps, but the keys of the
+ * empty slots are left undefined: use `<name>_next()` to iterate.
+ */
+
+#define MS_MAP_HASH_IDENTITY(key) ((uint64_t)(key)) // Hash of integer and handle index keys - mixed by the map
+#define MS_MAP_EQUALS(a, b) ((a) == (b))
+
+/**
+ * Define a typed map.
+ *
+ * Generates:
+ * - `ms_result <name>_construct(ms_map *map, ms_allocator allocator, uint32_t capacity, uint32_t growth_factor)`
+ * - `value_t * <name>_get(ms_map const *map, key_t key)` - NULL if the key is not found
+ * - `ms_result <name>_set(ms_map *map, key_t key, value_t value)`
+ * - `bool <name>_remove(ms_map *map, key_t key)`
+ * - `bool <name>_next(ms_map const *map, uint32_t *cursor, key_t **key, value_t **value)` - Iterate
+ *   the pairs, starting with `*cursor == 0`. Returns false past the last pair
+ *
+ * @param name The function name prefix.
+ * @param key_t The key type.
+ * @param value_t The value type.
+ * @param hash_fn The key hash function or macro - `uint64_t hash_fn(key_t key)`.
+ * @param eq_fn The key equality function or macro - `bool eq_fn(key_t a, key_t b)`.
+ */
+#define MS_MAP_DEFINE(name, key_t, value_t, hash_fn, eq_fn) \
+  MSUNUSED static uint64_t name##__hash_clbk(void const *const key) { \
+    return hash_fn(*(key_t const *)key); \
+  } \
+  \
+  MSUNUSED static bool name##__equals_clbk(void const *const a, void const *const b) { \
+    return eq_fn(*(key_t const *)a, *(key_t const *)b); \
+  } \
+  \
+  MSUNUSED static bool name##__is_none_clbk(void const *const key) { \
+    ((void)key); \
+    return false; \
+  } \
+  \
+  MSUNUSED static void name##__set_none_clbk(void *const key) { \
+    ((void)key); \
+  } \
+  \
+  MSUNUSED static inline ms_result name##_construct( \
+    ms_map *const map, \
+    ms_allocator const allocator, \
+    uint32_t const capacity, \
+    uint32_t const growth_factor \
+  ) { \
+    return ms_map_construct(map, &(ms_map_description) { \
+      allocator, \
+      name##__equals_clbk, \
+      name##__hash_clbk, \
+      name##__is_none_clbk, \
+      name##__set_none_clbk, \
+      capacity, \
+      growth_factor, \
+      sizeof(key_t), \
+      sizeof(value_t) \
+    }); \
+  } \
+  \
+  MSINLINE MSUNUSED static inline uint32_t name##__get_index(ms_map const *const map, key_t const key, uint64_t const h) { \
+    key_t const *const keys = (key_t const *)map->keys; \
+    uint32_t const w = map->capacity - 1; \
+    \
+    for(uint32_t offset = 0; offset <= map->max_probe; offset += MS_MAP_GROUP_SIZE) { \
+      uint32_t const start = (h + offset) & w; \
+      ms_map_group_mask matches = ms_map_group_match(map->ctrl + start, MS_MAP_CTRL_H2(h)); \
+      \
+      while(matches != 0) { \
+        uint32_t const index = (start + ms_map_group_mask_first(matches)) & w; \
+        \
+        if(eq_fn(keys[index], key)) { \
+          return index; \
+        } \
+        \
+        matches &= matches - 1; \
+      } \
+      \
+      if(ms_map_group_match(map->ctrl + start, MS_MAP_CTRL_EMPTY) != 0) { \
+        break; \
+      } \
+    } \
+    \
+    return UINT32_MAX; \
+  } \
+  \
+  MSUNUSED static inline value_t * name##_get(ms_map const *const map, key_t const key) { \
+    uint32_t const index = name##__get_index(map, key, ms_map_mix_hash(hash_fn(key))); \
+    \
+    return index != UINT32_MAX ? (value_t *)map->values + index : NULL; \
+  } \
+  \
+  MSUNUSED static inline ms_result name##_set(ms_map *const map, key_t const key, value_t const value) { \
+    uint64_t const h = ms_map_mix_hash(hash_fn(key)); \
+    uint32_t const index = name##__get_index(map, key, h); \
+    \
+    if(index != UINT32_MAX) { \
+      ((value_t *)map->values)[index] = value; \
+      return MS_RESULT_SUCCESS; \
+    } \
+    \
+    return ms_map_insert_hashed(map, h, &key, &value); \
+  } \
+  \
+  MSUNUSED static inline bool name##_remove(ms_map *const map, key_t const key) { \
+    uint32_t const index = name##__get_index(map, key, ms_map_mix_hash(hash_fn(key))); \
+    \
+    if(index == UINT32_MAX) { \
+      return false; \
+    } \
+    \
+    ms_map_remove_at(map, index); \
+    return true; \
+  } \
+  \
+  MSUNUSED static inline bool name##_next(ms_map const *const map, uint32_t *const cursor, key_t **const key, value_t **const value) { \
+    for(uint32_t i = *cursor; i < map->capacity; ++i) { \
+      if(map->ctrl[i] != MS_MAP_CTRL_EMPTY) { \
+        *key = (key_t *)map->keys + i; \
+        *value = (value_t *)map->values + i; \
+        *cursor = i + 1; \
+        return true; \
+      } \
+    } \
+    \
+    *cursor = map->capacity; \
+    return false; \
+  }
+
 #endif // MS_CONTAINERS_MAP_H
 
@@ -100,7 +100,7 @@ MSAPI void ms_pool_destroy(ms_pool *const this);
  *
  * @param this The pool.
  *
- * @return A pointer to the acquired item.
+ * @return A pointer to the acquired item, or NULL if memory allocation failed.
  */
 MSAPI MSUSERET void* ms_pool_acquire(ms_pool *const this);
 
@@ -10,27 +10,58 @@
 #include <moonsugar/api.h>
 
 #define MS_DEFAULT_ALIGNMENT (8ULL)
-#define MS_HEAP_DEALLOC_THR (4194304ull)
+#define MS_HEAP_DEALLOC_THR (4194304ull) // Default decommit threshold, in bytes
+#define MS_FREE_BATCH_SIZE (64u) // Number of blocks containers free at once via ms_free_n()
+#define MS_HEAP_MAX_REGIONS (64u) // Max number of regions a growable heap reserves in addition to its own
+
+#define MS_FREE_LIST_FL_COUNT (64u) // Number of first-level (power of two) size classes
+#define MS_FREE_LIST_SL_BITS (2u) // Log2 of the number of second-level subdivisions per size class
+#define MS_FREE_LIST_SL_COUNT (1u << MS_FREE_LIST_SL_BITS) // Must be <= 8
+
+typedef enum {
+  MS_PAGE_HUGE_BIT = 1, // Back memory with huge pages when available - see `ms_sys_info::huge_page_size`
+  MS_PAGE_NUMA_PREFERRED_BIT = 2, // Place pages on the node set via MS_PAGE_NUMA_NODE(), falling back to other nodes
+  MS_PAGE_NUMA_BIND_BIT = 4, // Place pages on the node set via MS_PAGE_NUMA_NODE() only
+  MS_PAGE_NUMA_INTERLEAVE_BIT = 8 // Interleave pages across all the nodes
+} ms_page_flag_bits;
+
+typedef uint32_t ms_page_flags; // The same flags must be passed to all OS calls for a reservation
+
+#define MS_PAGE_NUMA_NODE_SHIFT (24u)
+#define MS_PAGE_NUMA_NODE(node) ((ms_page_flags)(node) << MS_PAGE_NUMA_NODE_SHIFT) // Page flags selecting a NUMA node
+#define MS_PAGE_GET_NUMA_NODE(flags) ((uint32_t)(flags) >> MS_PAGE_NUMA_NODE_SHIFT)
+#define MS_PAGE_NUMA_MASK (MS_PAGE_NUMA_PREFERRED_BIT | MS_PAGE_NUMA_BIND_BIT | MS_PAGE_NUMA_INTERLEAVE_BIT)
+
+#define MS_DECOMMIT_POLICY_DEFAULT (ms_decommit_policy) { MS_DECOMMIT_THRESHOLD, MS_HEAP_DEALLOC_THR }
 
 #define MS_ALLOCATOR_INIT(prefix, user) (ms_allocator) { \
   prefix ## malloc, \
   prefix ## free, \
   prefix ## realloc, \
-  (user) \
+  (user), \
+  NULL, \
+  NULL, \
+  NULL \
 }
 
 #define MS_ALLOCATOR_DEF_HEAP(heap) (ms_allocator) { \
   (ms_malloc_clbk)ms_heap_malloc, \
   (ms_free_clbk)ms_heap_free, \
   (ms_realloc_clbk)ms_heap_realloc, \
-  &(heap) \
+  &(heap), \
+  NULL, \
+  NULL, \
+  (ms_free_n_clbk)ms_heap_free_n \
 }
 
 #define MS_ALLOCATOR_DEF_ARENA(arena) (ms_allocator) { \
   (ms_malloc_clbk)ms_arena_malloc, \
   (ms_free_clbk)ms_arena_free, \
   (ms_realloc_clbk)ms_arena_realloc, \
-  &(arena) \
+  &(arena), \
+  NULL, \
+  NULL, \
+  NULL \
 }
 
 /**
@@ -68,16 +99,69 @@ typedef void (*ms_free_clbk)(void * const user, void * const ptr);
  */
 typedef void* (*ms_realloc_clbk)(void * const user, void * const ptr, size_t const new_count);
 
+/**
+ * Sized memory deallocation callback.
+ *
+ * @param user The user pointer as stored in the allocator.
+ * @param ptr A pointer to the base of the memory block to free.
+ * @param size The number of bytes the block was allocated or last
+ *  reallocated with.
+ */
+typedef void (*ms_free_sized_clbk)(void * const user, void * const ptr, size_t const size);
+
+/**
+ * Batch aligned memory allocation callback.
+ *
+ * @param user The user pointer as stored in the allocator.
+ * @param count The number of bytes to allocate for each block.
+ * @param alignment The alignment boundary, in bytes. This value must
+ *  always be a power of two.
+ * @param ptrs The array receiving the pointers to the allocated blocks.
+ * @param ptr_count The number of blocks to allocate.
+ *
+ * @return The number of blocks allocated, stored at the beginning of
+ *  `ptrs`. Less than `ptr_count` on failure.
+ */
+typedef size_t (*ms_malloc_n_clbk)(
+  void * const user,
+  size_t const count,
+  size_t const alignment,
+  void ** const ptrs,
+  size_t const ptr_count
+);
+
+/**
+ * Batch memory deallocation callback.
+ *
+ * @param user The user pointer as stored in the allocator.
+ * @param ptrs The pointers to the bases of the memory blocks to free.
+ *  NULL pointers are skipped.
+ * @param ptr_count The number of pointers.
+ */
+typedef void (*ms_free_n_clbk)(void * const user, void * const * const ptrs, size_t const ptr_count);
+
 typedef struct {
   ms_malloc_clbk allocate;
   ms_free_clbk deallocate;
   ms_realloc_clbk reallocate;
   void * user; // User data pointer
+  ms_free_sized_clbk deallocate_sized; // Optional - NULL = deallocate
+  ms_malloc_n_clbk allocate_n; // Optional - NULL = allocate each block
+  ms_free_n_clbk deallocate_n; // Optional - NULL = deallocate each block
 } ms_allocator;
 
 MSUSERET void* MSAPI ms_malloc(ms_allocator const * const allocator, size_t const size, size_t const alignment);
 MSUSERET void* MSAPI ms_realloc(ms_allocator const * const allocator, void * const ptr, size_t const new_size);
 void MSAPI ms_free(ms_allocator const * const allocator, void * const ptr);
+void MSAPI ms_free_sized(ms_allocator const * const allocator, void * const ptr, size_t const size); // Free a block of known size
+MSUSERET size_t MSAPI ms_malloc_n(
+  ms_allocator const * const allocator,
+  size_t const size,
+  size_t const alignment,
+  void ** const ptrs,
+  size_t const ptr_count
+); // Allocate ptr_count blocks of the same size - Returns the number of blocks allocated
+void MSAPI ms_free_n(ms_allocator const * const allocator, void * const * const ptrs, size_t const ptr_count); // Free a batch of blocks - NULL pointers are skipped
 
 typedef struct {
   uint64_t size; // Total size (including metadata and padding)
@@ -102,18 +186,42 @@ typedef void (*ms_free_list_on_before_alloc_from_node_clbk)(
   void * const user
 ); // Invoked before memory is allocate from a node
 
+/*
+ * Free list
+ *
+ * Free nodes are kept in an address-ordered list, used for
+ * coalescing, and in a two-level set of segregated size class
+ * bins, used for allocation. The first level splits sizes in
+ * powers of two, the second level splits each power of two in
+ * MS_FREE_LIST_SL_COUNT linear ranges. A bitmap per level
+ * tracks non-empty bins so that a suitable node is found in
+ * constant time. A red-black tree indexes the nodes by address,
+ * so that the neighbours of a freed chunk are found in O(log n).
+ */
 struct ms_free_list {
   ms_free_list_node *first;
+  ms_free_list_node *root; // Address index tree root
   void *user;
   ms_free_list_on_before_node_create_clbk on_before_node_create;
   ms_free_list_on_before_alloc_from_node_clbk on_before_alloc_from_node;
+  uint64_t fl_bitmap; // Bit N set = bins of first level N not empty
+  uint8_t sl_bitmaps[MS_FREE_LIST_FL_COUNT]; // Bit M set = bin [N][M] not empty
+  ms_free_list_node *bins[MS_FREE_LIST_FL_COUNT][MS_FREE_LIST_SL_COUNT]; // Size class bin heads
 };
 
 struct ms_free_list_node {
-  ms_free_list_node *next, *prev; // NULL = no next/prev
+  ms_free_list_node *next, *prev; // Address order - NULL = no next/prev
+  ms_free_list_node *bin_next, *bin_prev; // Size class bin - NULL = no next/prev
+  ms_free_list_node *left, *right, *parent; // Address index tree - NULL = no child/parent
   uint64_t size;
+  bool is_red; // Address index tree node colour
 };
 
+uint64_t MSAPI ms_free_list_get_node_size(
+  uint64_t const count, // Bytes to allocate
+  uint32_t const alignment
+); // Size of the node serving an allocation, header and padding included
+
 void * MSAPI ms_free_list_malloc(
   ms_free_list *const list,
   size_t const count, // Bytes to allocate
@@ -127,6 +235,16 @@ void MSAPI ms_free_list_free(
   size_t const size
 );
 
+size_t MSAPI ms_free_list_grow(
+  ms_free_list *const list,
+  void * const ptr, // Allocated chunk
+  size_t const size, // Allocated chunk size
+  size_t const new_size // Must be larger than size
+); // Extend a chunk into the free node following it - Returns the new chunk size or 0 on failure
+
+void MSAPI ms_free_list_clear(ms_free_list *const list); // Remove all nodes
+void MSAPI ms_free_list_relocate(ms_free_list *const list, intptr_t const offset); // Offset all node pointers after the nodes were moved by offset bytes
+
 void MSAPI ms_free_list_create_node(
   ms_free_list* const list,
   ms_free_list_node *const node,
@@ -135,42 +253,234 @@ void MSAPI ms_free_list_create_node(
   uint64_t const size
 );
 
+/*
+ * Statistics
+ *
+ * Sizes, free node count, largest free block and fragmentation
+ * are computed on request by walking the allocator state. Peak
+ * usage and allocation and free counts are collected on every
+ * call, and only when the library is built with
+ * MS_FEAT_MEMORY_STATS - they are 0 otherwise.
+ */
+
+typedef struct {
+  uint64_t reserved_size; // Address space owned by the allocator
+  uint64_t committed_size; // Memory backed by physical pages
+  uint64_t live_size; // Memory held by live allocations, including metadata and padding
+  uint64_t peak_live_size; // Highest live_size observed - MS_FEAT_MEMORY_STATS only
+  uint64_t alloc_count; // MS_FEAT_MEMORY_STATS only
+  uint64_t free_count; // MS_FEAT_MEMORY_STATS only
+  uint64_t free_node_count; // Number of free blocks
+  uint64_t free_size; // Total free memory, committed or not
+  uint64_t largest_free_size; // Largest allocation the free memory can host, including metadata
+  double fragmentation; // 1 - largest_free_size / free_size - 0 = all free memory is contiguous
+} ms_memory_stats;
+
+typedef struct {
+  uint64_t live_size;
+  uint64_t peak_live_size;
+  uint64_t alloc_count;
+  uint64_t free_count;
+} ms_memory_counters; // Allocation counters - only updated with MS_FEAT_MEMORY_STATS
+
+MSINLINE inline static void ms_memory_counters_on_malloc(ms_memory_counters *const counters, uint64_t const size) {
+#ifdef MS_FEAT_MEMORY_STATS
+  counters->live_size += size;
+  counters->alloc_count++;
+
+  if(counters->live_size > counters->peak_live_size) {
+    counters->peak_live_size = counters->live_size;
+  }
+#else // MS_FEAT_MEMORY_STATS
+  ((void)counters);
+  ((void)size);
+#endif // MS_FEAT_MEMORY_STATS
+}
+
+MSINLINE inline static void ms_memory_counters_on_free(ms_memory_counters *const counters, uint64_t const size) {
+#ifdef MS_FEAT_MEMORY_STATS
+  counters->live_size -= size;
+  counters->free_count++;
+#else // MS_FEAT_MEMORY_STATS
+  ((void)counters);
+  ((void)size);
+#endif // MS_FEAT_MEMORY_STATS
+}
+
+MSINLINE inline static void ms_memory_counters_on_resize(
+  ms_memory_counters *const counters,
+  uint64_t const size,
+  uint64_t const new_size
+) { // In-place resize of a live allocation
+#ifdef MS_FEAT_MEMORY_STATS
+  counters->live_size = counters->live_size - size + new_size;
+
+  if(counters->live_size > counters->peak_live_size) {
+    counters->peak_live_size = counters->live_size;
+  }
+#else // MS_FEAT_MEMORY_STATS
+  ((void)counters);
+  ((void)size);
+  ((void)new_size);
+#endif // MS_FEAT_MEMORY_STATS
+}
+
+MSINLINE MSUSERET inline static double ms_memory_stats_get_fragmentation(ms_memory_stats const *const stats) {
+  return stats->free_size > 0
+    ? 1.0 - (double)stats->largest_free_size / (double)stats->free_size
+    : 0.0;
+}
+
+void MSAPI ms_free_list_get_stats(
+  ms_free_list const *const list,
+  ms_memory_stats *const stats
+); // Accumulate free_node_count, free_size and largest_free_size into stats
+
+/*
+ * Decommit policy
+ *
+ * Controls when free memory at the end of a heap or stack
+ * is returned to the OS. Decommitting early keeps the memory
+ * footprint low, keeping memory committed avoids commit and
+ * decommit syscalls when memory usage oscillates.
+ */
+
+typedef enum {
+  MS_DECOMMIT_IMMEDIATE, // Decommit free memory as soon as it is released
+  MS_DECOMMIT_DELAYED, // Only decommit on explicit request - see `ms_heap_purge()`
+  MS_DECOMMIT_THRESHOLD // Decommit in batches once free memory exceeds twice the threshold, keeping the threshold committed
+} ms_decommit_mode;
+
 typedef struct {
+  ms_decommit_mode mode;
+  uint64_t threshold; // Threshold mode - free memory kept committed, in bytes
+} ms_decommit_policy;
+
+/**
+ * Get the amount of free committed memory to decommit.
+ *
+ * @param policy The decommit policy.
+ * @param free_size The amount of committed memory that is free, in bytes.
+ *
+ * @return The amount of memory to decommit, in bytes.
+ */
+MSINLINE MSUSERET inline static uint64_t ms_decommit_policy_get_size(
+  ms_decommit_policy const * const policy,
+  uint64_t const free_size
+) {
+  switch(policy->mode) {
+    case MS_DECOMMIT_IMMEDIATE:
+      return free_size;
+    case MS_DECOMMIT_THRESHOLD:
+      return free_size > 2 * policy->threshold ? free_size - policy->threshold : 0;
+    default:
+      return 0;
+  }
+}
+
+/*
+ * Heap
+ *
+ * A heap serves allocations from a reserved region, committing
+ * memory as needed. A growable heap reserves additional regions
+ * of `growth_size` bytes when its own is exhausted. The regions
+ * host their own state and are indexed by address, so that blocks
+ * are freed to the region owning them. Regions are released to the
+ * OS as soon as they are empty.
+ *
+ * Ownership tests on a growable heap read the region index, so they
+ * are not safe against concurrent frees: growable heaps cannot back
+ * a thread-caching heap.
+ */
+
+typedef struct ms_heap ms_heap;
+
+struct ms_heap {
   void *base;
   uint64_t size;
   uint64_t commit_page_size; // Size of the memory commit unit
   uint64_t committed_size;
+  ms_page_flags page_flags;
+  ms_decommit_policy decommit_policy; // MS_DECOMMIT_POLICY_DEFAULT on construction - can be changed at any time
   ms_free_list free_list;
-} ms_heap;
+  ms_memory_counters counters;
+  uint64_t growth_size; // Size of the additional regions, multiple of the commit page size - 0 = not growable (default), can be changed at any time unless the heap backs a thread-caching heap
+  ms_heap *regions[MS_HEAP_MAX_REGIONS]; // Additional regions, sorted by address
+  uint32_t region_count;
+};
 
 MSAPI ms_result ms_heap_construct(
   ms_heap *const heap,
   uint64_t const size, // Must be multiple of the page size
-  uint64_t const page_size // Must be a power of two
+  uint64_t const page_size, // Must be a power of two
+  ms_page_flags const page_flags // Huge page and NUMA placement flags
 );
 
+MSAPI ms_result ms_heap_construct_at(
+  ms_heap *const heap,
+  void *const base, // Committed memory, not owned by the heap - aligned to MS_DEFAULT_ALIGNMENT
+  uint64_t const size,
+  ms_page_flags const page_flags
+); // Construct a heap over memory committed as a whole, such as a file mapping - Must not be destroyed, purged, trimmed or made growable - MS_RESULT_INVALID_ARGUMENT if the base is not aligned
+
+MSAPI void ms_heap_attach(ms_heap *const heap, void *const base); // Rebind a heap constructed at another address or by another process to this process and base, relocating its free list
+
 MSAPI void ms_heap_destroy(ms_heap *const heap);
 MSAPI MSUSERET void * ms_heap_malloc(ms_heap *const heap, size_t const count, size_t const alignment); // Returns NULL on failure
-MSAPI MSUSERET void * ms_heap_realloc(ms_heap *const heap, void *const ptr, size_t const new_count);
+MSAPI MSUSERET void * ms_heap_realloc(ms_heap *const heap, void *const ptr, size_t const new_count); // Returns NULL on failure, leaving the block untouched
 MSAPI void ms_heap_free(ms_heap *const heap, void *const ptr);
+MSAPI void ms_heap_free_n(ms_heap *const heap, void *const *const ptrs, size_t const ptr_count); // Free a batch of blocks, then decommit once
 MSUSERET MSAPI ms_header *ms_heap_get_header(void *const ptr);
+MSAPI MSUSERET size_t ms_heap_get_usable_size(void *const ptr); // Usable size of a heap block, in bytes
+MSAPI MSUSERET size_t ms_heap_get_block_size(ms_heap *const heap, void *const ptr); // Usable size of a block of this heap, in bytes - for use as a size callback
+MSAPI MSUSERET void * ms_heap_realloc_via(ms_allocator const *const allocator, void *const ptr, size_t const new_count); // Reallocate a heap block by copy through a heap front end - Blocks already large enough are kept
 MSAPI MSUSERET bool ms_heap_owns(ms_heap *const heap, void *const ptr);
+MSAPI void ms_heap_purge(ms_heap *const heap); // Decommit the free memory at the end of the heap and its regions, regardless of the decommit policy
+MSAPI uint64_t ms_heap_trim(ms_heap *const heap); // Purge, then reset the free memory within the heap and its regions - Returns the size of the memory reset, in bytes
+MSAPI void ms_heap_get_stats(ms_heap const *const heap, ms_memory_stats *const out_stats);
 
 /*
  * Stack
+ *
+ * A stack allocates by bumping a pointer, and may be shared
+ * between threads. Its memory is only released as a whole by
+ * `ms_stack_clear()` or, in LIFO order, by rewinding to a marker.
+ * Markers are meant for nested scopes on a stack used by one
+ * thread at a time, such as the stack of the calling thread
+ * returned by `ms_stack_get_thread_stack()`.
+ *
+ * Memory is committed as the top grows. Commits and decommits
+ * are serialized, so that allocations racing with a clear are
+ * served from the cleared stack or invalidated by the clear,
+ * and never from decommitted memory.
  */
 
+#ifndef MS_STACK_THREAD_SIZE
+  #define MS_STACK_THREAD_SIZE (67108864ull) // Memory reserved for each thread stack, in bytes
+#endif // MS_STACK_THREAD_SIZE
+
+typedef void* ms_stack_marker; // Top of the stack at the time of marking
+
 typedef struct {
   void *base; // Base stack memory address
   size_t size; // Stack memory size
-  MS_ATOMIC(uint8_t*) top; // Top stack pointer
-  MS_ATOMIC(uint8_t*) committed_top; // Top of committed memory
+  MS_ATOMIC(uint8_t*) top; // Top stack pointer - past the end when exhausted
+  MS_ATOMIC(uint8_t*) committed_top; // Top of committed memory - only lowered by clearing
+  ms_atomic_flag commit_lock; // Commit and decommit synchronization
+  ms_page_flags page_flags;
+  ms_decommit_policy decommit_policy; // MS_DECOMMIT_POLICY_DEFAULT on construction - can be changed at any time
+  MS_ATOMIC(uint64_t) alloc_count; // MS_FEAT_MEMORY_STATS only
+  MS_ATOMIC(uint64_t) peak_size; // Highest top offset - MS_FEAT_MEMORY_STATS only
 } ms_stack;
 
-MSAPI ms_result ms_stack_construct(ms_stack * const stack, uint64_t const max_size);
+MSAPI ms_result ms_stack_construct(ms_stack * const stack, uint64_t const max_size, ms_page_flags const page_flags);
 MSAPI void ms_stack_destroy(ms_stack * const stack);
-MSAPI void* ms_stack_malloc(ms_stack * const stack, size_t size, size_t const alignment);
-MSAPI void ms_stack_clear(ms_stack * const stack); // Reset the stack to empty state
+MSAPI void* ms_stack_malloc(ms_stack * const stack, size_t size, size_t const alignment); // Returns NULL on failure or when the stack is exhausted
+MSAPI void ms_stack_clear(ms_stack * const stack); // Reset the stack to empty state, decommitting memory according to the decommit policy
+MSAPI MSUSERET ms_stack_marker ms_stack_mark(ms_stack const * const stack);
+MSAPI void ms_stack_rewind(ms_stack * const stack, ms_stack_marker const marker); // Release allocations made since the marker - memory stays committed
+MSAPI MSUSERET ms_stack * ms_stack_get_thread_stack(void); // Stack of the calling thread, constructed on first use - Returns NULL on failure
+MSAPI void ms_stack_get_stats(ms_stack const * const stack, ms_memory_stats *const out_stats); // The whole free space counts as one free block
 
 /*
  * Arena
@@ -182,7 +492,14 @@ MSAPI void ms_stack_clear(ms_stack * const stack); // Reset the stack to empty s
  * Arenas are of fixed size but can be chained. Chained
  * arenas will automatically be deallocated when they
  * become empty. Each chained arena size is aligned
- * to a multiple of the primary arena.
+ * to a multiple of the primary arena. Each allocation
+ * records its node right before its header, so that
+ * deallocation does not search the node chain.
+ *
+ * Linear arenas allocate by bumping a pointer and do not
+ * prepend a header to the allocations. Their memory is
+ * only released as a whole by `ms_arena_clear()` or, in
+ * LIFO order, by rolling back to a savepoint.
  */
 
 typedef struct ms_arena ms_arena;
@@ -192,12 +509,15 @@ struct ms_arena_node {
   ms_free_list free_list;
   uint64_t total_size;
   uint64_t allocated_size;
+  ms_arena *arena; // Owner
+  ms_arena_node *prev;
   ms_arena_node *next;
   uint8_t base[];
 };
 
 typedef enum {
-  MS_ARENA_STICKY_BIT = 1 // Do not release empty nodes on deallocation
+  MS_ARENA_STICKY_BIT = 1, // Do not release empty nodes on deallocation
+  MS_ARENA_LINEAR_BIT = 2 // Bump-pointer allocation - individual allocations cannot be freed
 } ms_arena_flag_bits;
 
 typedef uint32_t ms_arena_flags;
@@ -205,31 +525,75 @@ typedef uint32_t ms_arena_flags;
 struct ms_arena {
   uint64_t base_size;
   ms_arena_node *first;
+  ms_arena_node *current; // Linear mode - node allocations are bumped from
   ms_allocator allocator;
   ms_arena_flags flags;
+  ms_page_flags page_flags;
+  ms_memory_counters counters;
 };
 
 typedef struct {
   uint64_t base_size; // Initial arena size
   ms_allocator allocator; // Allocator the arena draws memory from
   ms_arena_flags flags;
+  ms_page_flags page_flags; // NUMA placement of the node memory - see `ms_place()`
 } ms_arena_description;
 
+typedef struct {
+  ms_arena_node *node; // NULL = arena was empty
+  uint64_t allocated_size;
+  uint64_t live_size; // Allocation counters state
+} ms_arena_savepoint;
+
 MSAPI void ms_arena_construct(ms_arena *const arena, ms_arena_description const * const description);
 MSAPI void ms_arena_destroy(ms_arena *const arena);
 MSAPI MSUSERET void * ms_arena_malloc(ms_arena *const arena, size_t const count, size_t const alignment); // Returns the pointer; NULL on failure or when count is 0
 MSAPI MSUSERET void * ms_arena_realloc(ms_arena *const arena, void *const ptr, size_t const new_count); // Returns the new pointer; NULL on failure of if new_count is 0
-MSAPI void ms_arena_free(ms_arena *const arena, void *const ptr);
-ms_header * MSAPI ms_arena_get_header(void *const ptr); // Get allocation header
+MSAPI void ms_arena_free(ms_arena *const arena, void *const ptr); // No-op in linear mode
+ms_header * MSAPI ms_arena_get_header(void *const ptr); // Get allocation header - not available in linear mode
 MSAPI void ms_arena_clear(ms_arena *const arena); // Reset arena to empty, invalidating all previous allocations
+MSAPI ms_arena_savepoint ms_arena_save(ms_arena const *const arena); // Linear mode only
+MSAPI void ms_arena_rollback(ms_arena *const arena, ms_arena_savepoint const *const savepoint); // Release allocations made since the savepoint - linear mode only
+MSAPI void ms_arena_get_stats(ms_arena const *const arena, ms_memory_stats *const out_stats); // Linear mode - the free space of each node counts as one free block
 
 /*
  * OS memory interface.
+ *
+ * NUMA policies are applied on reservation and take effect as
+ * pages are committed. They are ignored on single-node systems
+ * and when the node is offline.
  */
 
-MSAPI void ms_release(void * const ptr, const size_t count); // Release reserved memory to the OS
-MSUSERET MSAPI MSMALLOC void* ms_reserve(const size_t count); // Reserve memory - Returns the pointer to the base of the reserved block or NULL on failure
-MSAPI bool ms_commit(void * const ptr, const size_t count); // Commit reserved memory - Returns false on failure
-MSAPI void ms_decommit(void * const ptr, const size_t count); // Decommit committed memory
+MSAPI void ms_release(void * const ptr, const size_t count, ms_page_flags const flags); // Release reserved memory to the OS
+MSUSERET MSAPI MSMALLOC void* ms_reserve(const size_t count, ms_page_flags const flags); // Reserve memory - Returns the pointer to the base of the reserved block or NULL on failure
+MSAPI bool ms_commit(void * const ptr, const size_t count, ms_page_flags const flags); // Commit reserved memory - Returns false on failure
+MSAPI void ms_decommit(void * const ptr, const size_t count, ms_page_flags const flags); // Decommit the whole pages within committed memory
+MSAPI void ms_reset(void * const ptr, const size_t count, ms_page_flags const flags); // Return the physical pages of the whole pages within committed memory to the OS - Pages stay accessible, with undefined content
+MSAPI void ms_place(void * const ptr, const size_t count, ms_page_flags const flags); // Apply the NUMA policy of the flags to the whole pages within committed memory, migrating them
+MSAPI bool ms_set_thread_numa_policy(ms_page_flags const flags); // Set the NUMA policy of the memory the calling thread touches first - Returns false on failure
+
+/*
+ * File mappings
+ *
+ * A file mapping maps a whole file as shared, readable and
+ * writable memory, so that writes are carried to the file.
+ */
+
+typedef struct {
+  void *base; // Base address of the mapping
+  uint64_t size; // Size of the mapping and the file, in bytes
+  intptr_t file; // OS file descriptor or handle
+  intptr_t mapping; // OS file mapping handle - Windows only
+} ms_file_mapping;
+
+MSAPI ms_result ms_map_file(
+  char const * const path, // Created if it does not exist
+  uint64_t const size, // Size of new or empty files - existing files are mapped whole
+  void * const base_hint, // Preferred base address - NULL = any
+  ms_file_mapping * const out_mapping
+); // Map a file - the base hint is not honored if the range is not available
+MSAPI void ms_unmap_file(ms_file_mapping * const mapping);
+MSAPI bool ms_sync_file(ms_file_mapping const * const mapping); // Write the mapped memory to the file - Returns false on failure
+MSAPI bool ms_lock_file(ms_file_mapping const * const mapping); // Lock the file for exclusive use, until unmapped - Returns false if locked via another mapping
 
 #endif // MS_MEMORY_H
@@ -0,0 +1,66 @@
+/**
+ * @file
+ *
+ * Persistent heap.
+ *
+ * A persistent heap (pheap) is a heap hosted by a file mapping. The
+ * heap state, free list included, lives in the mapping, so that a
+ * process reopening the file gets back the allocations made by the
+ * previous one, with no deserialization.
+ *
+ * The file is mapped at its previous base address when available,
+ * so that pointers stored in the allocations remain valid. Otherwise,
+ * relocatable heaps are mapped elsewhere and the heap state is
+ * relocated: pointers stored in the allocations must be offset by
+ * `relocation_offset` by the user.
+ *
+ * A heap is opened by one process at a time: the file is locked
+ * while the heap is open, and the lock is released when the process
+ * exits, even on a crash.
+ *
+ * The file is only consistent once the heap is closed or synced. A
+ * heap neither closed nor synced since it was opened, e.g. after a
+ * crash, is marked dirty and is only reopened with
+ * `MS_PHEAP_RECOVER_BIT`. A heap synced then modified before a crash
+ * is reopened as is: sync when the allocations are consistent.
+ *
+ * Persistent heaps are not thread-safe.
+ */
+#ifndef MS_PERSISTENT_HEAP_H
+#define MS_PERSISTENT_HEAP_H
+
+#include <moonsugar/api.h>
+#include <moonsugar/memory.h>
+
+#define MS_PHEAP_VERSION (2u) // File format version
+
+#define MS_ALLOCATOR_DEF_PHEAP(pheap) MS_ALLOCATOR_DEF_HEAP(*(pheap).heap)
+
+typedef enum {
+  MS_PHEAP_RELOCATABLE_BIT = 1, // Map at another base when the previous one is not available
+  MS_PHEAP_RECOVER_BIT = 2 // Open dirty heaps - their content may be inconsistent
+} ms_pheap_flag_bits;
+
+typedef uint32_t ms_pheap_flags;
+
+typedef struct {
+  char const *path; // Heap file - created if it does not exist
+  uint64_t size; // Size of a new heap, excluding the file header - existing heaps keep their size
+  void *base; // Preferred base address of a new heap mapping - NULL = any
+  ms_pheap_flags flags;
+} ms_pheap_description;
+
+typedef struct {
+  ms_file_mapping mapping;
+  ms_heap *heap; // Hosted in the mapping
+  intptr_t relocation_offset; // Offset of the mapping from its previous base - 0 if not relocated
+  bool is_new; // True if the heap was created on open
+} ms_pheap;
+
+MSAPI ms_result ms_pheap_open(ms_pheap *const pheap, ms_pheap_description const *const description); // MS_RESULT_ACCESS if the heap is in use or dirty, MS_RESULT_MEMORY if the previous base is not available and the heap is not relocatable
+MSAPI void ms_pheap_close(ms_pheap *const pheap); // Sync and unmap the heap - allocations persist
+MSAPI bool ms_pheap_sync(ms_pheap *const pheap); // Write the heap to its file and clear its dirty flag - Returns false on failure
+MSAPI MSUSERET void * ms_pheap_get_root(ms_pheap const *const pheap); // Get the root allocation - NULL if not set
+MSAPI void ms_pheap_set_root(ms_pheap *const pheap, void *const root); // Set the allocation the other allocations are reachable from
+
+#endif // MS_PERSISTENT_HEAP_H
@@ -0,0 +1,110 @@
+/**
+ * @file
+ *
+ * Sampling memory profiler.
+ *
+ * The memory profiler (mprof) wraps an allocator and records the
+ * call stack of a sample of the allocations. An allocation is
+ * sampled every `sample_interval` allocated bytes on average, so
+ * that each sample stands for about `sample_interval` bytes. Samples
+ * are aggregated per call site, and live samples are tracked until
+ * freed, so that the profile shows where both the allocated and
+ * the currently live memory come from.
+ *
+ * Profiles are written in the folded stack format, one call site per
+ * line, which can be rendered by flame graph tools or converted to
+ * pprof.
+ */
+#ifndef MS_PROFILER_H
+#define MS_PROFILER_H
+
+#include <moonsugar/api.h>
+#include <moonsugar/memory.h>
+#include <moonsugar/thread.h>
+
+#define MS_MPROF_MAX_FRAMES (32u) // Max number of frames recorded per call site
+#define MS_MPROF_DEFAULT_SAMPLE_INTERVAL (524288ull) // Default mean number of bytes between samples
+
+#define MS_ALLOCATOR_DEF_MPROF(mprof) (ms_allocator) { \
+  (ms_malloc_clbk)ms_mprof_malloc, \
+  (ms_free_clbk)ms_mprof_free, \
+  (ms_realloc_clbk)ms_mprof_realloc, \
+  &(mprof), \
+  NULL, \
+  NULL, \
+  NULL \
+}
+
+typedef struct {
+  void *frames[MS_MPROF_MAX_FRAMES]; // Innermost first
+  uint32_t frame_count;
+  uint64_t hash;
+  uint64_t alloc_count; // Estimated allocations since construction
+  uint64_t alloc_size; // Estimated bytes allocated since construction
+  uint64_t live_count; // Estimated live allocations
+  uint64_t live_size; // Estimated live bytes
+} ms_mprof_site;
+
+typedef struct {
+  void *ptr; // NULL = unused
+  uint32_t site; // Index of the call site
+  uint64_t size; // Estimated bytes
+  uint64_t count; // Estimated allocations
+} ms_mprof_sample;
+
+typedef struct {
+  ms_allocator allocator; // Profiled allocator - also hosts the profiler state
+  uint64_t sample_interval; // Mean bytes between samples - 0 = sample all allocations
+} ms_mprof_description;
+
+typedef struct {
+  ms_allocator allocator; // Profiled allocator - not owned
+  uint64_t sample_interval;
+  MS_ATOMIC(int64_t) bytes_until_sample;
+  MS_ATOMIC(uint32_t) sample_count; // Number of live samples
+  ms_mutex lock; // Call site and sample table access synchronization
+  uint64_t random_state;
+  ms_mprof_site *sites;
+  uint32_t *site_index; // Open addressing table of site index + 1 - 0 = unused
+  uint32_t site_count;
+  uint32_t site_capacity; // Power of two - the site index holds twice as many slots
+  ms_mprof_sample *samples; // Open addressing table of live samples
+  uint32_t sample_capacity; // Power of two
+} ms_mprof;
+
+typedef enum {
+  MS_MPROF_REPORT_LIVE_SIZE, // Estimated live bytes
+  MS_MPROF_REPORT_LIVE_COUNT, // Estimated live allocations
+  MS_MPROF_REPORT_ALLOC_SIZE, // Estimated bytes allocated since construction
+  MS_MPROF_REPORT_ALLOC_COUNT // Estimated allocations since construction
+} ms_mprof_report;
+
+typedef void (*ms_mprof_write_clbk)(void * const user, char const * const data, size_t const size); // Report output callback
+
+MSAPI ms_result ms_mprof_construct(ms_mprof *const mprof, ms_mprof_description const *const description);
+MSAPI void ms_mprof_destroy(ms_mprof *const mprof); // All profiled allocations must have been freed
+MSAPI MSUSERET void * ms_mprof_malloc(ms_mprof *const mprof, size_t const count, size_t const alignment); // Returns NULL on failure
+MSAPI MSUSERET void * ms_mprof_realloc(ms_mprof *const mprof, void *const ptr, size_t const new_count);
+MSAPI void ms_mprof_free(ms_mprof *const mprof, void *const ptr);
+
+/**
+ * Write the profile in the folded stack format.
+ *
+ * Each line lists the frames of a call site, outermost first and
+ * separated by `;`, followed by a space and the reported value.
+ * Frames are resolved to symbol names when available. Sites with
+ * a value of 0 are omitted.
+ *
+ * @param mprof The profiler.
+ * @param report The value to report.
+ * @param write The output callback, invoked once per line.
+ * @param user The user pointer passed to the output callback.
+ */
+MSAPI void ms_mprof_dump(
+  ms_mprof *const mprof,
+  ms_mprof_report const report,
+  ms_mprof_write_clbk const write,
+  void * const user
+);
+
+#endif // MS_PROFILER_H
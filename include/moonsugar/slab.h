@@ -0,0 +1,56 @@
+/**
+ * @file
+ *
+ * Small object allocator.
+ *
+ * A slab allocator serves small allocations from a set of pools,
+ * one per size class, so that allocating and freeing a small object
+ * does not search a free list. Each allocation is tagged with its
+ * size class in the pool node link, unused while the item is
+ * acquired, so that no header is added to small objects.
+ *
+ * Allocations larger than `MS_SLAB_MAX_CLASS_SIZE` or aligned to
+ * more than `MS_DEFAULT_ALIGNMENT` are served by the parent allocator.
+ *
+ * Slab allocators are not thread-safe.
+ */
+#ifndef MS_SLAB_H
+#define MS_SLAB_H
+
+#include <moonsugar/api.h>
+#include <moonsugar/memory.h>
+#include <moonsugar/containers/pool.h>
+
+#define MS_SLAB_MAX_CLASS_SIZE (1024u) // Larger allocations are served by the parent allocator
+#define MS_SLAB_CLASS_COUNT (24u) // 8 classes up to 64 bytes, then 4 classes per power of two
+#define MS_SLAB_DEFAULT_PAGE_SIZE (65536u)
+
+#define MS_ALLOCATOR_DEF_SLAB(slab) (ms_allocator) { \
+  (ms_malloc_clbk)ms_slab_malloc, \
+  (ms_free_clbk)ms_slab_free, \
+  (ms_realloc_clbk)ms_slab_realloc, \
+  &(slab), \
+  NULL, \
+  NULL, \
+  NULL \
+}
+
+typedef struct {
+  ms_allocator allocator; // Parent allocator - serves the pool pages and large allocations
+  uint32_t page_size; // Size of a pool page, in bytes
+} ms_slab_description;
+
+typedef struct {
+  ms_allocator allocator; // Parent allocator - not owned
+  ms_pool pools[MS_SLAB_CLASS_COUNT];
+} ms_slab;
+
+MSAPI ms_result ms_slab_construct(ms_slab *const slab, ms_slab_description const *const description);
+MSAPI void ms_slab_destroy(ms_slab *const slab); // Release all small allocations
+MSAPI MSUSERET void * ms_slab_malloc(ms_slab *const slab, size_t const count, size_t const alignment); // Returns NULL on failure or if count is 0
+MSAPI MSUSERET void * ms_slab_realloc(ms_slab *const slab, void *const ptr, size_t const new_count);
+MSAPI void ms_slab_free(ms_slab *const slab, void *const ptr);
+MSAPI MSUSERET size_t ms_slab_get_size(ms_slab *const slab, void *const ptr); // Usable size of a block, in bytes
+MSAPI MSUSERET size_t ms_slab_get_class_size(size_t const count); // Size of the class serving an allocation - 0 if served by the parent
+
+#endif // MS_SLAB_H
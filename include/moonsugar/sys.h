@@ -71,6 +71,34 @@ typedef struct {
    * Number of logical processors.
    */
   uint32_t proc_count;
+
+  /**
+   * Default huge page size, in bytes.
+   *
+   * This value is 0 when huge pages are unsupported.
+   */
+  uint64_t huge_page_size;
+
+  /**
+   * Supported huge page sizes.
+   *
+   * Bit N is set when pages of 2^N bytes are supported.
+   */
+  uint64_t huge_page_sizes;
+
+  /**
+   * Number of NUMA nodes.
+   *
+   * This value is 1 when NUMA is unsupported.
+   */
+  uint32_t numa_node_count;
+
+  /**
+   * Online NUMA nodes.
+   *
+   * Bit N is set when node N is online. Nodes above 63 are not reported.
+   */
+  uint64_t numa_node_mask;
 } ms_sys_info;
 
 /**
@@ -22,7 +22,7 @@ static ms_allocator g_allocator;
 
 #define MST_MEMORY_INIT() \
   do { \
-    ms_heap_construct(&g_heap, MST_HEAP_SIZE, MST_HEAP_PAGE_SIZE); \
+    ms_heap_construct(&g_heap, MST_HEAP_SIZE, MST_HEAP_PAGE_SIZE, 0); \
     g_allocator = MS_ALLOCATOR_DEF_HEAP(g_heap); \
   } while(false)
 
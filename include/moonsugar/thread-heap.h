@@ -0,0 +1,106 @@
+/**
+ * @file
+ *
+ * Thread-safe heaps.
+ *
+ * Thread-caching heap (theap): a front end to a heap shared between threads. Each thread keeps
+ * lists of free small blocks per size class, so that most small
+ * allocations and deallocations do not acquire the heap lock.
+ * Blocks move between the thread caches and the heap in batches.
+ *
+ * Cached blocks are returned to the heap when the thread calls
+ * `ms_theap_flush()` or, for threads spawned via `ms_thread_spawn()`,
+ * when the thread terminates.
+ *
+ * Blocks are tested for ownership without the heap lock, so the heap
+ * must not be growable - its `growth_size` must stay 0.
+ *
+ * Multi-arena heap (mheap): a set of heaps, each with its own lock.
+ * Threads are spread across the arenas, so that threads allocating
+ * concurrently rarely contend for the same lock. Blocks freed by a
+ * thread other than the ones bound to the owning arena are pushed
+ * onto a lock-free remote free list, released by the owning arena
+ * on its next allocation.
+ */
+#ifndef MS_THREAD_HEAP_H
+#define MS_THREAD_HEAP_H
+
+#include <moonsugar/api.h>
+#include <moonsugar/memory.h>
+#include <moonsugar/thread.h>
+
+#define MS_THEAP_MAX_INSTANCES (8u) // Max number of thread-caching heaps alive at once
+#define MS_THEAP_CLASS_GRANULARITY (16u) // Size class step, in bytes
+#define MS_THEAP_CLASS_COUNT (16u) // Number of size classes
+#define MS_THEAP_MAX_CLASS_SIZE (MS_THEAP_CLASS_GRANULARITY * MS_THEAP_CLASS_COUNT) // Larger blocks are not cached
+#define MS_THEAP_BATCH_SIZE (32u) // Number of blocks moved between a thread cache and the heap at once
+#define MS_THEAP_MAX_CACHED_BLOCKS (2u * MS_THEAP_BATCH_SIZE) // Max blocks cached per thread and size class
+
+#define MS_ALLOCATOR_DEF_THEAP(theap) (ms_allocator) { \
+  (ms_malloc_clbk)ms_theap_malloc, \
+  (ms_free_clbk)ms_theap_free, \
+  (ms_realloc_clbk)ms_theap_realloc, \
+  &(theap), \
+  NULL, \
+  NULL, \
+  NULL \
+}
+
+typedef struct {
+  ms_heap *heap; // Shared heap - not owned
+  ms_mutex lock; // Heap access synchronization
+  uint64_t generation; // Unique instance identifier
+  uint32_t slot; // Index of the thread cache of this instance
+} ms_theap;
+
+MSAPI ms_result ms_theap_construct(ms_theap *const theap, ms_heap *const heap); // The heap must not be growable - MS_RESULT_RESOURCE_LIMIT if MS_THEAP_MAX_INSTANCES are alive
+MSAPI void ms_theap_destroy(ms_theap *const theap); // Flush the calling thread - all other threads must have flushed or terminated
+MSAPI MSUSERET void * ms_theap_malloc(ms_theap *const theap, size_t const count, size_t const alignment); // Returns NULL on failure
+MSAPI MSUSERET void * ms_theap_realloc(ms_theap *const theap, void *const ptr, size_t const new_count);
+MSAPI void ms_theap_free(ms_theap *const theap, void *const ptr);
+MSAPI void ms_theap_flush(ms_theap *const theap); // Return the blocks cached by the calling thread to the heap
+
+#define MS_ALLOCATOR_DEF_MHEAP(mheap) (ms_allocator) { \
+  (ms_malloc_clbk)ms_mheap_malloc, \
+  (ms_free_clbk)ms_mheap_free, \
+  (ms_realloc_clbk)ms_mheap_realloc, \
+  &(mheap), \
+  NULL, \
+  NULL, \
+  NULL \
+}
+
+typedef struct ms_mheap_remote_block ms_mheap_remote_block;
+
+struct ms_mheap_remote_block {
+  ms_mheap_remote_block *next;
+};
+
+typedef struct {
+  MS_ALIGNED(MS_CACHE_LINE_SIZE) ms_mutex lock; // Heap access synchronization
+  ms_heap heap;
+  MS_ATOMIC(ms_mheap_remote_block*) remote_frees; // Blocks freed by threads bound to other arenas
+} ms_mheap_arena;
+
+typedef struct {
+  ms_allocator allocator; // Allocator of the arena array
+  ms_mheap_arena *arenas;
+  uint32_t arena_count;
+} ms_mheap;
+
+typedef struct {
+  ms_allocator allocator; // Allocator of the arena array
+  uint64_t arena_size; // Size of each arena - must be multiple of the page size
+  uint64_t page_size; // Arena commit page size - must be a power of two
+  ms_page_flags page_flags; // Arena OS page flags
+  uint32_t arena_count; // 0 = one arena per logical processor
+} ms_mheap_description;
+
+MSAPI ms_result ms_mheap_construct(ms_mheap *const mheap, ms_mheap_description const *const description);
+MSAPI void ms_mheap_destroy(ms_mheap *const mheap); // All threads must have stopped using the heap
+MSAPI MSUSERET void * ms_mheap_malloc(ms_mheap *const mheap, size_t const count, size_t const alignment); // Returns NULL on failure
+MSAPI MSUSERET void * ms_mheap_realloc(ms_mheap *const mheap, void *const ptr, size_t const new_count);
+MSAPI void ms_mheap_free(ms_mheap *const mheap, void *const ptr);
+MSAPI uint64_t ms_mheap_trim(ms_mheap *const mheap); // Trim all the arenas, one at a time - Returns the size of the memory reset, in bytes
+
+#endif // MS_THREAD_HEAP_H
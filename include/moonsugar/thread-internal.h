@@ -15,5 +15,6 @@ typedef struct {
 
 ms_thread_start_descriptor * ms_thread_acquire_start_descriptor(void);
 void ms_thread_release_start_descriptor(ms_thread_start_descriptor * const d);
+void ms_thread_run_exit_callbacks(void); // Invoke and unregister the exit callbacks of the current thread
 
 #endif // MS_THREAD_INTERNAL_H
@@ -15,9 +15,11 @@
 #endif
 
 #define MS_THREAD_NAME_MAX_LEN (256u)
+#define MS_THREAD_MAX_EXIT_CALLBACKS (8u)
 
 typedef void* ms_thread; // Thread handle
 typedef void (*ms_thread_main)(void * const ctx); // Thread main routine pointer
+typedef void (*ms_thread_exit_clbk)(void * const ctx); // Thread exit callback pointer
 
 typedef struct {
   ms_thread_main main; // Main routine
@@ -29,8 +31,10 @@ MSAPI ms_result ms_thread_spawn(ms_thread * const t, ms_thread_description const
 MSAPI bool ms_thread_join(ms_thread * const t); // Returns true on success
 MSAPI void ms_thread_yield(void);
 MSAPI void ms_thread_sleep(const ms_time count);
+MSAPI MSUSERET ms_time ms_get_time(void); // Monotonic time, from an unspecified origin
 MSAPI const char * ms_get_current_thread_name(void);
 MSAPI void ms_set_current_thread_name(char const * const name);
+MSAPI bool ms_thread_on_exit(ms_thread_exit_clbk const clbk, void * const ctx); // Invoke clbk when the current thread terminates, in reverse registration order. Only threads spawned via ms_thread_spawn are supported. Returns false if too many callbacks are registered
 
 #ifdef _WIN32
 	typedef CRITICAL_SECTION ms_mutex;
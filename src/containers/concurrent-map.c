@@ -0,0 +1,218 @@
+#include <memory.h>
+#include <moonsugar/assert.h>
+#include <moonsugar/sys.h>
+#include <moonsugar/util.h>
+#include <moonsugar/containers/concurrent-map.h>
+
+ms_result ms_cmap_construct(ms_cmap *const map, ms_cmap_description const *const description) {
+  MS_ASSERT(map);
+  MS_ASSERT(description);
+
+  uint32_t shard_count = description->shard_count;
+
+  if(shard_count == 0) {
+    uint32_t const proc_count = ms_get_sys_info()->proc_count;
+
+    for(shard_count = 1; shard_count < proc_count; shard_count *= 2);
+  }
+
+  if(!ms_is_power2(shard_count)) {
+    return MS_RESULT_INVALID_ARGUMENT;
+  }
+
+  *map = (ms_cmap) {
+    description->map.allocator,
+    ms_malloc(&description->map.allocator, sizeof(ms_cmap_shard) * shard_count, MS_CACHE_LINE_SIZE),
+    0 // shard_count - counts the constructed shards
+  };
+
+  if(map->shards == NULL) {
+    return MS_RESULT_MEMORY;
+  }
+
+  for(uint32_t i = 0; i < shard_count; ++i) {
+    ms_cmap_shard *const shard = &map->shards[i];
+
+    ms_result result = ms_map_construct(&shard->map, &description->map);
+
+    if(result != MS_RESULT_SUCCESS) {
+      ms_cmap_destroy(map);
+      return result;
+    }
+
+    result = ms_rwlock_construct(&shard->lock);
+
+    if(result != MS_RESULT_SUCCESS) {
+      ms_map_destroy(&shard->map);
+      ms_cmap_destroy(map);
+      return result;
+    }
+
+    map->shard_count++;
+  }
+
+  return MS_RESULT_SUCCESS;
+}
+
+void ms_cmap_destroy(ms_cmap *const map) {
+  MS_ASSERT(map);
+
+  for(uint32_t i = 0; i < map->shard_count; ++i) {
+    ms_cmap_shard *const shard = &map->shards[i];
+
+    ms_rwlock_destroy(&shard->lock);
+    ms_map_destroy(&shard->map);
+  }
+
+  ms_free(&map->allocator, map->shards);
+
+  map->shards = NULL;
+  map->shard_count = 0;
+}
+
+/**
+ * Hash a key and select its shard.
+ *
+ * The shard index is taken from the high half of the mixed hash, as
+ * the low bits select the slot within the shard.
+ */
+static ms_cmap_shard *get_shard(ms_cmap *const map, void const *const key, uint64_t *const out_h) {
+  uint64_t const h = ms_map_mix_hash(map->shards[0].map.hash_key(key));
+
+  *out_h = h;
+
+  return &map->shards[(uint32_t)(h >> 32) & (map->shard_count - 1)];
+}
+
+bool ms_cmap_get(ms_cmap *const map, void const *const key, void *const out_value) {
+  MS_ASSERT(map);
+  MS_ASSERT(key);
+  MS_ASSERT(out_value);
+
+  uint64_t h;
+  ms_cmap_shard *const shard = get_shard(map, key, &h);
+
+  ms_rwlock_lock_read(&shard->lock);
+
+  uint32_t const index = ms_map_get_index(&shard->map, key, h);
+
+  if(index != UINT32_MAX) {
+    memcpy(out_value, MS_MAP_GET_VALUE(&shard->map, index), shard->map.value_size);
+  }
+
+  ms_rwlock_unlock_read(&shard->lock);
+
+  return index != UINT32_MAX;
+}
+
+ms_result ms_cmap_set(ms_cmap *const map, void const *const key, void const *const value) {
+  MS_ASSERT(map);
+  MS_ASSERT(key);
+  MS_ASSERT(value);
+
+  uint64_t h;
+  ms_cmap_shard *const shard = get_shard(map, key, &h);
+  ms_result result = MS_RESULT_SUCCESS;
+
+  ms_rwlock_lock_write(&shard->lock);
+
+  uint32_t const index = ms_map_get_index(&shard->map, key, h);
+
+  if(index != UINT32_MAX) {
+    memcpy(MS_MAP_GET_VALUE(&shard->map, index), value, shard->map.value_size);
+  } else {
+    result = ms_map_insert_hashed(&shard->map, h, key, value);
+  }
+
+  ms_rwlock_unlock_write(&shard->lock);
+
+  return result;
+}
+
+bool ms_cmap_remove(ms_cmap *const map, void const *const key) {
+  MS_ASSERT(map);
+  MS_ASSERT(key);
+
+  uint64_t h;
+  ms_cmap_shard *const shard = get_shard(map, key, &h);
+
+  ms_rwlock_lock_write(&shard->lock);
+
+  uint32_t const index = ms_map_get_index(&shard->map, key, h);
+
+  if(index != UINT32_MAX) {
+    ms_map_remove_at(&shard->map, index);
+  }
+
+  ms_rwlock_unlock_write(&shard->lock);
+
+  return index != UINT32_MAX;
+}
+
+ms_result ms_cmap_compute_if_absent(
+  ms_cmap *const map,
+  void const *const key,
+  ms_cmap_compute_clbk const compute,
+  void *const ctx,
+  void *const out_value
+) {
+  MS_ASSERT(map);
+  MS_ASSERT(key);
+  MS_ASSERT(compute);
+  MS_ASSERT(out_value);
+
+  uint64_t h;
+  ms_cmap_shard *const shard = get_shard(map, key, &h);
+
+  // Fast path - present keys only need the read lock
+  ms_rwlock_lock_read(&shard->lock);
+
+  uint32_t index = ms_map_get_index(&shard->map, key, h);
+
+  if(index != UINT32_MAX) {
+    memcpy(out_value, MS_MAP_GET_VALUE(&shard->map, index), shard->map.value_size);
+  }
+
+  ms_rwlock_unlock_read(&shard->lock);
+
+  if(index != UINT32_MAX) {
+    return MS_RESULT_SUCCESS;
+  }
+
+  ms_rwlock_lock_write(&shard->lock);
+
+  // Another thread may have inserted the key in the meantime
+  index = ms_map_get_index(&shard->map, key, h);
+
+  ms_result result = MS_RESULT_SUCCESS;
+
+  if(index != UINT32_MAX) {
+    memcpy(out_value, MS_MAP_GET_VALUE(&shard->map, index), shard->map.value_size);
+  } else {
+    result = compute(key, out_value, ctx);
+
+    if(result == MS_RESULT_SUCCESS) {
+      result = ms_map_insert_hashed(&shard->map, h, key, out_value);
+    }
+  }
+
+  ms_rwlock_unlock_write(&shard->lock);
+
+  return result;
+}
+
+uint32_t ms_cmap_get_count(ms_cmap *const map) {
+  MS_ASSERT(map);
+
+  uint32_t count = 0;
+
+  for(uint32_t i = 0; i < map->shard_count; ++i) {
+    ms_cmap_shard *const shard = &map->shards[i];
+
+    ms_rwlock_lock_read(&shard->lock);
+    count += shard->map.count;
+    ms_rwlock_unlock_read(&shard->lock);
+  }
+
+  return count;
+}
@@ -109,7 +109,7 @@ ms_result ms_ipool_release(ms_ipool *const this, uint32_t const item) {
   MS_ASSERT(this);
 
   uint32_t const block = DIV64(item);
-  uint32_t const offset = item & 0xffffff;
+  uint32_t const offset = item & 63;
   uint64_t const set_mask = 1ull << offset;
   uint64_t const prev_state = this->state[block];
   bool const was_set = prev_state & set_mask;
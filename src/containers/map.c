@@ -3,264 +3,628 @@
 #include <moonsugar/util.h>
 #include <moonsugar/containers/map.h>
 
+// Size of the control byte array of a map
+#define CTRL_SIZE(capacity) ((capacity) + MS_MAP_GROUP_SIZE)
+
+// Number of keys hashed and prefetched at once by bulk operations
+#define BATCH_SIZE (16u)
+
+/**
+ * Allocate the arrays of a map, all slots empty.
+ */
+static ms_result allocate_slots(
+  ms_allocator const *const allocator,
+  uint32_t const capacity,
+  uint32_t const key_size,
+  uint32_t const value_size,
+  ms_none_set_clbk const set_key_none,
+  uint8_t **const out_ctrl,
+  uint8_t **const out_probes,
+  void **const out_keys,
+  void **const out_values
+) {
+  uint8_t *const ctrl = ms_malloc(allocator, CTRL_SIZE(capacity), MS_DEFAULT_ALIGNMENT);
+  uint8_t *const probes = ms_malloc(allocator, capacity, MS_DEFAULT_ALIGNMENT);
+  void *const keys = ms_malloc(allocator, key_size * capacity, MS_DEFAULT_ALIGNMENT);
+  void *const values = ms_malloc(allocator, value_size * capacity, MS_DEFAULT_ALIGNMENT);
+
+  if(ctrl == NULL || probes == NULL || (keys == NULL && key_size > 0) || (values == NULL && value_size > 0)) {
+    ms_free(allocator, values);
+    ms_free(allocator, keys);
+    ms_free(allocator, probes);
+    ms_free(allocator, ctrl);
+
+    return MS_RESULT_MEMORY;
+  }
+
+  memset(ctrl, MS_MAP_CTRL_EMPTY, CTRL_SIZE(capacity));
+
+  for(uint32_t i = 0; i < capacity; ++i) {
+    set_key_none((uint8_t*)keys + i * key_size);
+  }
+
+  *out_ctrl = ctrl;
+  *out_probes = probes;
+  *out_keys = keys;
+  *out_values = values;
+
+  return MS_RESULT_SUCCESS;
+}
+
 ms_result ms_map_construct(
-  ms_map *const map, 
+  ms_map *const map,
   ms_map_description const *const description
-) { 
-  MS_ASSERT(map); 
-  MS_ASSERT(description); 
-  MS_ASSERT(description->allocator); 
+) {
+  MS_ASSERT(map);
+  MS_ASSERT(description);
   MS_ASSERT(description->are_keys_equal);
   MS_ASSERT(description->hash_key);
   MS_ASSERT(description->is_key_none);
   MS_ASSERT(description->set_key_none);
 
-  if(!ms_is_power2(description->capacity)) { 
-    return MS_RESULT_INVALID_ARGUMENT; 
-  } 
-
-  void *const keys = ms_malloc(
-    &description->allocator, 
-    description->key_size * description->capacity,
-		MS_DEFAULT_ALIGNMENT
-  ); 
-
-  if(description->capacity > 0 && keys == NULL) { 
-    return MS_RESULT_MEMORY; 
-  } 
-
-  void *const values = ms_malloc(
-    &description->allocator, 
-    description->value_size * description->capacity,
-		MS_DEFAULT_ALIGNMENT
-  ); 
-
-  if(description->capacity > 0 && values == NULL) { 
-    ms_free(&description->allocator, keys); 
-
-    return MS_RESULT_MEMORY; 
-  } 
+  if(!ms_is_power2(description->capacity)) {
+    return MS_RESULT_INVALID_ARGUMENT;
+  }
+
+  uint8_t *ctrl;
+  uint8_t *probes;
+  void *keys;
+  void *values;
+
+  MS_CKRET(
+    allocate_slots(
+      &description->allocator,
+      description->capacity,
+      description->key_size,
+      description->value_size,
+      description->set_key_none,
+      &ctrl,
+      &probes,
+      &keys,
+      &values
+    )
+  );
 
   *map = (ms_map){
-    description->capacity, 
-    description->growth_factor, 
+    description->capacity,
+    description->growth_factor,
     description->key_size,
     description->value_size,
-    keys, 
-    values, 
+    0, // count
+    0, // max_probe
+    ctrl,
+    probes,
+    keys,
+    values,
     description->allocator,
     description->are_keys_equal,
     description->hash_key,
     description->is_key_none,
     description->set_key_none
-  }; 
+  };
 
-  for(uint32_t i = 0; i < map->capacity; ++i) { 
-    void *const key = (uint8_t*)map->keys + i * map->key_size; 
+  return MS_RESULT_SUCCESS;
+}
 
-    map->set_key_none(key);
-  } 
+void ms_map_destroy(ms_map *const map) {
+  MS_ASSERT(map);
 
-  return MS_RESULT_SUCCESS; 
-} 
+  ms_free(&map->allocator, map->values);
+  ms_free(&map->allocator, map->keys);
+  ms_free(&map->allocator, map->probes);
+  ms_free(&map->allocator, map->ctrl);
 
-void ms_map_destroy(ms_map *const map) { 
-  MS_ASSERT(map); 
+  map->ctrl = NULL;
+  map->probes = NULL;
+  map->keys = NULL;
+  map->values = NULL;
+}
 
-  ms_free(&map->allocator, map->values); 
-  ms_free(&map->allocator, map->keys); 
+uint32_t ms_map_get_index(
+  ms_map const *const map,
+  void const *const key,
+  uint64_t const h
+) {
+  uint32_t const w = map->capacity - 1;
+  uint8_t const h2 = MS_MAP_CTRL_H2(h);
 
-  map->keys = NULL; 
-  map->values = NULL; 
-} 
+  for(uint32_t offset = 0; offset <= map->max_probe; offset += MS_MAP_GROUP_SIZE) {
+    uint32_t const start = (h + offset) & w;
+    ms_map_group_mask matches = ms_map_group_match(map->ctrl + start, h2);
 
-static uint32_t ms_map_get_index( 
-  ms_map const *const map, 
-  void const *const key
-) { 
-  uint64_t const h = map->hash_key(key); 
-  uint32_t const w = map->capacity - 1; 
+    // Only candidates are compared
+    while(matches != 0) {
+      uint32_t const global_index = (start + ms_map_group_mask_first(matches)) & w;
 
-  for(uint32_t local_index = 0; local_index < MS_MAP_SLICE_SIZE; 
-    ++local_index) { 
-    uint32_t global_index = (h + local_index) & w; 
-    void const *const key2 = (uint8_t*)map->keys + global_index * map->key_size; 
-    void const *const key1 = key; 
+      if(map->are_keys_equal(key, MS_MAP_GET_KEY(map, global_index))) {
+        return global_index;
+      }
 
-    if(map->are_keys_equal(key1, key2)) { 
-      return global_index; 
-    } 
-  } 
+      matches &= matches - 1;
+    }
 
-  return UINT32_MAX; 
-} 
+    // Probe sequences never cross an empty slot
+    if(ms_map_group_match(map->ctrl + start, MS_MAP_CTRL_EMPTY) != 0) {
+      break;
+    }
+  }
+
+  return UINT32_MAX;
+}
 
 void *ms_map_get_value(
-  ms_map const *const map, 
+  ms_map const *const map,
   void const *const key
-) { 
-  MS_ASSERT(map); 
-  MS_ASSERT(key); 
+) {
+  MS_ASSERT(map);
+  MS_ASSERT(key);
 
-  uint32_t const global_index = ms_map_get_index(map, key); 
+  uint32_t const global_index = ms_map_get_index(map, key, ms_map_mix_hash(map->hash_key(key)));
 
-  if(global_index != UINT32_MAX) { 
+  if(global_index != UINT32_MAX) {
     return MS_MAP_GET_VALUE(map, global_index);
-  } 
+  }
 
-  return NULL; 
-} 
+  return NULL;
+}
 
 void *ms_map_get_key(
-  ms_map const *const map, 
+  ms_map const *const map,
   void const *const key
-) { 
-  MS_ASSERT(map); 
-  MS_ASSERT(key); 
+) {
+  MS_ASSERT(map);
+  MS_ASSERT(key);
 
-  uint32_t const global_index = ms_map_get_index(map, key); 
+  uint32_t const global_index = ms_map_get_index(map, key, ms_map_mix_hash(map->hash_key(key)));
 
-  if(global_index != UINT32_MAX) { 
+  if(global_index != UINT32_MAX) {
     return MS_MAP_GET_KEY(map, global_index);
-  } 
+  }
 
-  return NULL; 
-} 
+  return NULL;
+}
 
-static uint32_t find_empty( 
-  ms_map const *const map, 
-  void const *const key
-) { 
-  uint64_t const h = map->hash_key(key); 
-  uint32_t const w = map->capacity - 1; 
+/**
+ * Move a pair to an empty slot, probe length included.
+ */
+static void move_pair(
+  ms_map *const map,
+  uint32_t const from,
+  uint32_t const to
+) {
+  ms_map_set_ctrl(map->ctrl, map->capacity, to, map->ctrl[from]);
+  map->probes[to] = map->probes[from];
+
+  memcpy(MS_MAP_GET_KEY(map, to), MS_MAP_GET_KEY(map, from), map->key_size);
+  memcpy(MS_MAP_GET_VALUE(map, to), MS_MAP_GET_VALUE(map, from), map->value_size);
+}
+
+/**
+ * Insert a pair, Robin Hood style.
+ *
+ * The pair takes the slot of the first pair closer to its home slot,
+ * and the pairs that follow, up to the first empty slot, shift by
+ * one. The map must have an empty slot.
+ *
+ * @param h The mixed key hash.
+ *
+ * @return True on success, false if a probe length would exceed
+ *  MS_MAP_MAX_PROBE. The map is left untouched on failure.
+ */
+static bool put(
+  ms_map *const map,
+  uint64_t const h,
+  void const *const key,
+  void const *const value
+) {
+  MS_ASSERT(map->count < map->capacity);
+
+  uint32_t const w = map->capacity - 1;
+  uint32_t index = h & w;
+  uint32_t probe = 0;
+
+  while(map->ctrl[index] != MS_MAP_CTRL_EMPTY && map->probes[index] >= probe) {
+    index = (index + 1) & w;
+    ++probe;
+  }
+
+  uint32_t end = index;
+  uint32_t max_probe = probe;
+
+  while(map->ctrl[end] != MS_MAP_CTRL_EMPTY) {
+    max_probe = (uint32_t)ms_max(max_probe, map->probes[end] + 1u);
+    end = (end + 1) & w;
+  }
 
-  for(uint32_t local_index = 0; local_index < MS_MAP_SLICE_SIZE; ++local_index) { 
-    uint32_t const global_index = (h + local_index) & w; 
-    void const *const key = MS_MAP_GET_KEY(map, global_index);
+  if(max_probe > MS_MAP_MAX_PROBE) {
+    return false;
+  }
 
-    if(map->is_key_none(key)) { 
-      return global_index; 
-    } 
-  } 
+  while(end != index) {
+    uint32_t const prev = (end - 1) & w;
 
-  return UINT32_MAX; 
-} 
+    move_pair(map, prev, end);
+    map->probes[end]++;
+
+    end = prev;
+  }
+
+  ms_map_set_ctrl(map->ctrl, map->capacity, index, MS_MAP_CTRL_H2(h));
+  map->probes[index] = (uint8_t)probe;
+
+  memcpy(MS_MAP_GET_KEY(map, index), key, map->key_size);
+  memcpy(MS_MAP_GET_VALUE(map, index), value, map->value_size);
+
+  map->count++;
+  map->max_probe = (uint32_t)ms_max(map->max_probe, max_probe);
+
+  return true;
+}
 
 ms_result ms_map_resize(
-  ms_map *const map, 
+  ms_map *const map,
   uint32_t const new_capacity
-) { 
-  MS_ASSERT(map); 
+) {
+  MS_ASSERT(map);
+
+  if(!ms_is_power2(new_capacity)) {
+    return MS_RESULT_INVALID_ARGUMENT;
+  }
+
+  ms_map old_map = *map;
+
+  MS_CKRET(
+    allocate_slots(
+      &map->allocator,
+      new_capacity,
+      map->key_size,
+      map->value_size,
+      map->set_key_none,
+      &map->ctrl,
+      &map->probes,
+      &map->keys,
+      &map->values
+    )
+  );
+
+  map->capacity = new_capacity;
+  map->count = 0;
+  map->max_probe = 0;
+
+  for(uint32_t i = 0; i < old_map.capacity; ++i) {
+    if(old_map.ctrl[i] == MS_MAP_CTRL_EMPTY) {
+      continue;
+    }
+
+    void *const key = MS_MAP_GET_KEY(&old_map, i);
+    uint64_t const h = ms_map_mix_hash(map->hash_key(key));
+
+    // The pairs do not fit - keep the old slots
+    if(map->count == map->capacity || !put(map, h, key, MS_MAP_GET_VALUE(&old_map, i))) {
+      ms_map_destroy(map);
+      *map = old_map;
+
+      return MS_RESULT_FULL;
+    }
+  }
+
+  ms_map_destroy(&old_map);
+
+  return MS_RESULT_SUCCESS;
+}
 
-  if(!ms_is_power2(new_capacity)) { 
-    return MS_RESULT_INVALID_ARGUMENT; 
-  } 
+/**
+ * Resize a map to a capacity, or more if its pairs do not fit.
+ *
+ * @param factor The capacity multiplier applied while the pairs do not fit.
+ */
+static ms_result resize_to_fit(
+  ms_map *const map,
+  uint32_t new_capacity,
+  uint32_t const factor
+) {
+  ms_result result;
+
+  while((result = ms_map_resize(map, new_capacity)) == MS_RESULT_FULL) {
+    if(new_capacity > UINT32_MAX / factor) {
+      return MS_RESULT_FULL;
+    }
+
+    new_capacity *= factor;
+  }
+
+  return result;
+}
+
+/**
+ * Grow a map by its growth factor, or more if its pairs do not fit.
+ */
+static ms_result grow(ms_map *const map) {
+  if(map->capacity > UINT32_MAX / map->growth_factor) {
+    return MS_RESULT_FULL;
+  }
+
+  return resize_to_fit(map, map->capacity * map->growth_factor, map->growth_factor);
+}
 
-  void *const new_keys = ms_malloc(&map->allocator, new_capacity * map->key_size, MS_DEFAULT_ALIGNMENT); 
+ms_result ms_map_reserve(
+  ms_map *const map,
+  uint32_t const count
+) {
+  MS_ASSERT(map);
 
-  if(new_keys == NULL && new_capacity > 0) { 
-    return MS_RESULT_MEMORY; 
-  } 
+  uint32_t new_capacity = map->capacity;
 
-  void *const new_values = map->values = ms_malloc(
-    &map->allocator,
-    new_capacity * map->value_size,
-		MS_DEFAULT_ALIGNMENT
-  ); 
+  while(MS_MAP_GET_MAX_COUNT(new_capacity) < count) {
+    if(new_capacity > UINT32_MAX / 2) {
+      return MS_RESULT_FULL;
+    }
 
-  if(new_values == NULL & new_capacity > 0) { 
-    ms_free(&map->allocator, new_keys); 
+    new_capacity *= 2;
+  }
 
-    return MS_RESULT_MEMORY; 
-  } 
+  if(new_capacity == map->capacity) {
+    return MS_RESULT_SUCCESS;
+  }
 
-  for(uint32_t i = 0; i < new_capacity; ++i) { 
-    void *const key = MS_MAP_GET_KEY(map, i);
+  return resize_to_fit(map, new_capacity, 2);
+}
+
+void ms_map_clear(ms_map *const map) {
+  MS_ASSERT(map);
 
-    map->set_key_none(key); 
-  } 
+  for(uint32_t i = 0; i < map->capacity; ++i) {
+    if(map->ctrl[i] != MS_MAP_CTRL_EMPTY) {
+      map->set_key_none(MS_MAP_GET_KEY(map, i));
+    }
+  }
 
-  uint32_t const w = new_capacity - 1; 
+  memset(map->ctrl, MS_MAP_CTRL_EMPTY, CTRL_SIZE(map->capacity));
+
+  map->count = 0;
+  map->max_probe = 0;
+}
 
-  for(unsigned i = 0; i < new_capacity; ++i) { 
-    void *const key = MS_MAP_GET_KEY(map, i);
+bool ms_map_next(
+  ms_map const *const map,
+  uint32_t *const cursor,
+  void **const out_key,
+  void **const out_value
+) {
+  MS_ASSERT(map);
+  MS_ASSERT(cursor);
 
-    if(!map->is_key_none(key)) { 
-      void *const value = MS_MAP_GET_VALUE(map, i);
-      uint64_t const key_hash = map->hash_key(key); 
-      uint32_t const new_index = key_hash & w; 
-      void *const new_key = (uint8_t*)new_keys + new_index * map->key_size; 
-      void *const new_value = (uint8_t*)new_values + new_index * map->value_size; 
+  for(uint32_t i = *cursor; i < map->capacity; ++i) {
+    if(map->ctrl[i] != MS_MAP_CTRL_EMPTY) {
+      if(out_key) {
+        *out_key = MS_MAP_GET_KEY(map, i);
+      }
 
-      memcpy(new_key, key, map->key_size);
-      memcpy(new_value, value, map->value_size);
-    } 
-  } 
+      if(out_value) {
+        *out_value = MS_MAP_GET_VALUE(map, i);
+      }
 
-  ms_free(&map->allocator, map->values); 
-  ms_free(&map->allocator, map->keys); 
+      *cursor = i + 1;
 
-  map->keys = new_keys; 
-  map->values = new_values; 
-  map->capacity = new_capacity; 
+      return true;
+    }
+  }
 
-  return MS_RESULT_SUCCESS; 
-} 
+  *cursor = map->capacity;
+
+  return false;
+}
+
+/**
+ * Hash a batch of keys and prefetch their home slots.
+ *
+ * @param keys The first key of the batch.
+ * @param out_hashes The mixed hashes of the keys.
+ */
+static void hash_batch(
+  ms_map const *const map,
+  uint32_t const count,
+  uint8_t const *const keys,
+  uint64_t *const out_hashes
+) {
+  uint32_t const w = map->capacity - 1;
+
+  for(uint32_t i = 0; i < count; ++i) {
+    out_hashes[i] = ms_map_mix_hash(map->hash_key(keys + i * map->key_size));
+  }
+
+  for(uint32_t i = 0; i < count; ++i) {
+    uint32_t const home = out_hashes[i] & w;
+
+    MS_PREFETCH(map->ctrl + home);
+    MS_PREFETCH(MS_MAP_GET_KEY(map, home));
+  }
+}
+
+ms_result ms_map_set_many(
+  ms_map *const map,
+  uint32_t const count,
+  void const *const keys,
+  void const *const values
+) {
+  MS_ASSERT(map);
+  MS_ASSERT(keys || count == 0);
+  MS_ASSERT(values || count == 0);
+
+  uint64_t hashes[BATCH_SIZE];
+
+  for(uint32_t batch = 0; batch < count; batch += BATCH_SIZE) {
+    uint32_t const batch_count = (uint32_t)ms_min(count - batch, BATCH_SIZE);
+    uint8_t const *const batch_keys = (uint8_t const*)keys + batch * map->key_size;
+    uint8_t const *const batch_values = (uint8_t const*)values + batch * map->value_size;
+
+    hash_batch(map, batch_count, batch_keys, hashes);
+
+    for(uint32_t i = 0; i < batch_count; ++i) {
+      void const *const key = batch_keys + i * map->key_size;
+      void const *const value = batch_values + i * map->value_size;
+      uint32_t const index = ms_map_get_index(map, key, hashes[i]);
+
+      if(index != UINT32_MAX) {
+        memcpy(MS_MAP_GET_VALUE(map, index), value, map->value_size);
+      } else {
+        MS_CKRET(ms_map_insert_hashed(map, hashes[i], key, value));
+      }
+    }
+  }
+
+  return MS_RESULT_SUCCESS;
+}
+
+uint32_t ms_map_get_many(
+  ms_map const *const map,
+  uint32_t const count,
+  void const *const keys,
+  void **const out_values
+) {
+  MS_ASSERT(map);
+  MS_ASSERT(keys || count == 0);
+  MS_ASSERT(out_values || count == 0);
+
+  uint64_t hashes[BATCH_SIZE];
+  uint32_t found_count = 0;
+
+  for(uint32_t batch = 0; batch < count; batch += BATCH_SIZE) {
+    uint32_t const batch_count = (uint32_t)ms_min(count - batch, BATCH_SIZE);
+    uint8_t const *const batch_keys = (uint8_t const*)keys + batch * map->key_size;
+
+    hash_batch(map, batch_count, batch_keys, hashes);
+
+    for(uint32_t i = 0; i < batch_count; ++i) {
+      uint32_t const index = ms_map_get_index(map, batch_keys + i * map->key_size, hashes[i]);
+
+      if(index != UINT32_MAX) {
+        out_values[batch + i] = MS_MAP_GET_VALUE(map, index);
+        ++found_count;
+      } else {
+        out_values[batch + i] = NULL;
+      }
+    }
+  }
+
+  return found_count;
+}
 
 ms_result ms_map_set(
-  ms_map *const map, 
-  void const *const key, 
+  ms_map *const map,
+  void const *const key,
+  void const *const value
+) {
+  MS_ASSERT(map);
+  MS_ASSERT(key);
+  MS_ASSERT(value);
+
+  uint64_t const h = ms_map_mix_hash(map->hash_key(key));
+  uint32_t const index = ms_map_get_index(map, key, h);
+
+  if(index != UINT32_MAX) {
+    memcpy(MS_MAP_GET_VALUE(map, index), value, map->value_size);
+
+    return MS_RESULT_SUCCESS;
+  }
+
+  return ms_map_insert_hashed(map, h, key, value);
+}
+
+ms_result ms_map_insert_hashed(
+  ms_map *const map,
+  uint64_t const h,
+  void const *const key,
   void const *const value
-) { 
-  MS_ASSERT(map); 
-  MS_ASSERT(key); 
-  MS_ASSERT(value); 
+) {
+  MS_ASSERT(map);
+  MS_ASSERT(key);
+  MS_ASSERT(value);
+
+  bool const is_growable = map->growth_factor > 1;
 
-  uint32_t index = ms_map_get_index(map, key); 
+  while(true) {
+    uint32_t const max_count = is_growable ? MS_MAP_GET_MAX_COUNT(map->capacity) : map->capacity;
 
-  if(index == UINT32_MAX) { 
-    index = find_empty(map, key); 
-  } 
+    if(map->count < max_count && put(map, h, key, value)) {
+      return MS_RESULT_SUCCESS;
+    }
 
-  if(index != UINT32_MAX) { 
-    void *const dest_key = MS_MAP_GET_KEY(map, index);
-    void *const dest_value = MS_MAP_GET_VALUE(map, index);
+    if(!is_growable) {
+      return MS_RESULT_FULL;
+    }
 
-    memcpy(dest_key, key, map->key_size);
-    memcpy(dest_value, value, map->value_size);
+    MS_CKRET(grow(map));
+  }
+}
 
-    return MS_RESULT_SUCCESS; 
-  } 
+void ms_map_remove_at(
+  ms_map *const map,
+  uint32_t const index
+) {
+  MS_ASSERT(map);
+  MS_ASSERT(index < map->capacity);
+  MS_ASSERT(map->ctrl[index] != MS_MAP_CTRL_EMPTY);
 
-  if(map->growth_factor > 0) { 
-    ms_result const resize_result = ms_map_resize(
-      map, 
-      ms_max(1, map->capacity) * map->growth_factor
-    ); 
+  uint32_t const w = map->capacity - 1;
+  uint32_t hole = index;
+  uint32_t next = (hole + 1) & w;
 
-    if(resize_result == MS_RESULT_SUCCESS) { 
-      return ms_map_set(map, key, value); 
-    } 
+  // Shift back the following pairs not in their home slot
+  while(next != index && map->ctrl[next] != MS_MAP_CTRL_EMPTY && map->probes[next] > 0) {
+    move_pair(map, next, hole);
+    map->probes[hole]--;
 
-    return resize_result; 
-  } 
+    hole = next;
+    next = (next + 1) & w;
+  }
 
-  return MS_RESULT_FULL; 
-} 
+  ms_map_set_ctrl(map->ctrl, map->capacity, hole, MS_MAP_CTRL_EMPTY);
+  map->set_key_none(MS_MAP_GET_KEY(map, hole));
+
+  map->count--;
+}
 
 bool ms_map_remove(
-  ms_map const *const map, 
+  ms_map *const map,
   void const *const key
-) { 
-  uint32_t const index = ms_map_get_index(map, key); 
+) {
+  MS_ASSERT(map);
+  MS_ASSERT(key);
+
+  uint32_t const index = ms_map_get_index(map, key, ms_map_mix_hash(map->hash_key(key)));
 
-  if(index != UINT32_MAX) { 
-    void *const key = MS_MAP_GET_KEY(map, index);
-    map->set_key_none(key);
+  if(index != UINT32_MAX) {
+    ms_map_remove_at(map, index);
 
-    return true; 
-  } 
+    return true;
+  }
 
-  return false; 
+  return false;
 }
 
+void ms_map_get_stats(
+  ms_map const *const map,
+  ms_map_stats *const out_stats
+) {
+  MS_ASSERT(map);
+  MS_ASSERT(out_stats);
+
+  uint64_t total_probe = 0;
+  uint32_t max_probe = 0;
+
+  for(uint32_t i = 0; i < map->capacity; ++i) {
+    if(map->ctrl[i] != MS_MAP_CTRL_EMPTY) {
+      total_probe += map->probes[i];
+      max_probe = (uint32_t)ms_max(max_probe, map->probes[i]);
+    }
+  }
+
+  *out_stats = (ms_map_stats) {
+    map->count, // count
+    map->capacity, // capacity
+    max_probe, // max_probe
+    map->count > 0 ? (double)total_probe / map->count : 0.0, // mean_probe
+    (double)map->count / map->capacity // load_factor
+  };
+}
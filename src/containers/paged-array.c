@@ -31,7 +31,19 @@ ms_result ms_parray_construct(
 void ms_parray_destroy(ms_parray *const this) {
   MS_ASSERT(this);
 
-  MS_PVECTOR_FOREACH_PAGE(this, ms_free(&this->allocator, page));
+  void *batch[MS_FREE_BATCH_SIZE];
+  uint32_t batch_size = 0;
+
+  MS_PVECTOR_FOREACH_PAGE(this, {
+    batch[batch_size++] = page;
+
+    if(batch_size == MS_FREE_BATCH_SIZE) {
+      ms_free_n(&this->allocator, batch, batch_size);
+      batch_size = 0;
+    }
+  });
+
+  ms_free_n(&this->allocator, batch, batch_size);
   this->first = this->last = NULL;
   this->page_count = 0;
 }
@@ -29,10 +29,7 @@ void ms_pool_destroy(ms_pool *const this) {
 
   unsigned const page_count = this->item_count / this->items_per_page;
 
-  for(unsigned i = 0; i < page_count; ++i) {
-    ms_free(&this->allocator, this->pages[i]);
-  }
-
+  ms_free_n(&this->allocator, this->pages, page_count);
   ms_free(&this->allocator, this->pages);
 
   this->item_count = 0;
@@ -40,15 +37,32 @@ void ms_pool_destroy(ms_pool *const this) {
   this->pages = NULL;
 }
 
-static void append_page(ms_pool *const this) {
+/**
+ * Append a page of available nodes to a pool.
+ *
+ * @return False if memory allocation failed, leaving the pool untouched.
+ */
+static bool append_page(ms_pool *const this) {
   MS_ASSERT(this->items == NULL); // This function assumes no available nodes
 
   uint32_t const node_size = sizeof(ms_pool_node) + this->item_size;
   uint32_t const size = node_size * this->items_per_page;
-  ms_pool_node * const page = ms_malloc(&this->allocator, size, MS_DEFAULT_ALIGNMENT);
   uint32_t const page_count = this->item_count / this->items_per_page;
+  void **const pages = ms_realloc(&this->allocator, this->pages, sizeof(void*) * (page_count + 1));
+
+  if(pages == NULL) {
+    return false;
+  }
+
+  // A larger page array is harmless if the page allocation fails
+  this->pages = pages;
+
+  ms_pool_node * const page = ms_malloc(&this->allocator, size, MS_DEFAULT_ALIGNMENT);
+
+  if(page == NULL) {
+    return false;
+  }
 
-  this->pages = ms_realloc(&this->allocator, this->pages, sizeof(void*) * (page_count + 1));
   this->pages[page_count] = page;
   this->item_count += this->items_per_page;
 
@@ -66,13 +80,15 @@ static void append_page(ms_pool *const this) {
 
   last->next = NULL;
   this->items = page;
+
+  return true;
 }
 
 void* ms_pool_acquire(ms_pool *const this) {
   MS_ASSERT(this);
 
-  if(this->items == NULL) {
-    append_page(this);
+  if(this->items == NULL && !append_page(this)) {
+    return NULL;
   }
 
   void* const ptr = this->items->data;
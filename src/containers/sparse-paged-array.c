@@ -32,12 +32,16 @@ ms_result ms_sparray_construct(
 void ms_sparray_destroy(ms_sparray * const restrict array) {
   MS_ASSERT(array);
 
-  for(uint32_t i = 0; i < array->page_count; ++i) {
-    ms_sparray_page const p = array->pages[i];
+  void *batch[MS_FREE_BATCH_SIZE];
+
+  for(uint32_t i = 0; i < array->page_count; i += MS_FREE_BATCH_SIZE) {
+    uint32_t const batch_size = ms_min(array->page_count - i, MS_FREE_BATCH_SIZE);
 
-    if(p.items != NULL) {
-      ms_free(&array->allocator, p.items);
+    for(uint32_t j = 0; j < batch_size; ++j) {
+      batch[j] = array->pages[i + j].items; // Unallocated pages are skipped
     }
+
+    ms_free_n(&array->allocator, batch, batch_size);
   }
 
   ms_free(&array->allocator, array->pages);
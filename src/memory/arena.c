@@ -12,6 +12,12 @@
 #define DOES_PTR_BELONG(arena, ptr) \
   ((uint8_t*)ptr > arena->base && (uint8_t *)ptr < (arena->base + arena->total_size))
 
+// Owner node slot, stored right before the header of an allocation
+#define OWNER_SLOT(hdr) ((ms_arena_node **)(hdr) - 1)
+
+// Usable size of an allocation
+#define USABLE_SIZE(hdr) ((hdr)->size - (hdr)->padding - sizeof(ms_header))
+
 ms_header *ms_arena_get_header(void *const ptr) { return (ms_header *)(ptr)-1; }
 
 static void on_before_node_create(
@@ -51,155 +57,294 @@ void ms_arena_construct(ms_arena *const arena, ms_arena_description const * cons
 
   *arena = (ms_arena){
       description->base_size,
-      NULL,
+      NULL, // first
+      NULL, // current
       description->allocator,
-      description->flags
+      description->flags,
+      description->page_flags,
+      { 0, 0, 0, 0 } // counters
   };
 }
 
-void ms_arena_destroy(ms_arena *const arena) {
-  // Destroy internally allocated arenas
-  for(ms_arena_node * a = arena->first, *b; a != NULL; a = b) {
+/**
+ * Release a node and all the nodes chained after it.
+ */
+static void release_nodes(ms_arena *const arena, ms_arena_node *const first) {
+  for(ms_arena_node * a = first, *b; a != NULL; a = b) {
     b = a->next;
     ms_free(&arena->allocator, a);
   }
+}
+
+void ms_arena_destroy(ms_arena *const arena) {
+  // Destroy internally allocated arenas
+  release_nodes(arena, arena->first);
 
   arena->first = NULL;
+  arena->current = NULL;
 }
 
 static ms_arena_node* create_arena_node(ms_arena * const arena, uint64_t const size) {
   ms_arena_node * const next = ms_malloc(&arena->allocator, size + sizeof(ms_arena_node), MS_DEFAULT_ALIGNMENT);
 
+  if(next == NULL) {
+    return NULL;
+  }
+
   *next = (ms_arena_node) {
-    { NULL, NULL, on_before_node_create, on_before_alloc_from_node },
+    { NULL, NULL, NULL, on_before_node_create, on_before_alloc_from_node, 0, {0}, {{NULL}} },
     size,
     0,
-    NULL
+    arena,
+    NULL, // prev
+    NULL // next
   };
 
+  // The parent allocator has no notion of placement
+  if(arena->page_flags & MS_PAGE_NUMA_MASK) {
+    ms_place(next, size + sizeof(ms_arena_node), arena->page_flags);
+  }
+
+  // Linear nodes are bumped through allocated_size
+  if(ms_test(arena->flags, MS_ARENA_LINEAR_BIT)) {
+    return next;
+  }
+
   // Create first chunk
   ms_free_list_create_node(&next->free_list, (ms_free_list_node*)next->base, NULL, NULL, size);
 
   return next;
 }
 
+/**
+ * Chain a new node after the given one.
+ */
+static void append_node(ms_arena *const arena, ms_arena_node *const prev, ms_arena_node *const node) {
+  node->prev = prev;
+
+  if(prev) {
+    prev->next = node;
+  } else {
+    arena->first = node;
+  }
+}
+
 static void* allocate_from_node(ms_arena_node * const node, size_t const count, size_t const alignment) {
-  // Add header
+  // Add header and owner slot
   size_t chunk_size;
-  uint8_t *const unaligned_ptr = ms_free_list_malloc(&node->free_list, count, alignment, &chunk_size);
+  uint8_t *const unaligned_ptr = ms_free_list_malloc(&node->free_list, count + sizeof(ms_arena_node *), alignment, &chunk_size);
 
   // Not enough continguous memory
   if(unaligned_ptr == NULL) {
     return NULL;
   }
-  uint8_t *const aligned_min_ptr = unaligned_ptr + sizeof(ms_header); // Assumes 0 padding
+  uint8_t *const aligned_min_ptr = unaligned_ptr + sizeof(ms_arena_node *) + sizeof(ms_header);
   uint8_t *const aligned_ptr = ms_align_ptr(aligned_min_ptr, alignment);
-  uint32_t const padding = aligned_ptr - aligned_min_ptr;
   ms_header *const hdr = (ms_header *)aligned_ptr - 1;
 
   hdr->size = chunk_size;
   hdr->alignment = alignment;
-  hdr->padding = padding;
+  hdr->padding = (uint8_t *)hdr - unaligned_ptr; // Includes the owner slot
+  *OWNER_SLOT(hdr) = node;
 
   node->allocated_size += chunk_size;
 
   return aligned_ptr;
 }
 
-void * ms_arena_malloc(ms_arena *const arena, size_t const count, size_t alignment) {
-  // Minimum alignment requirement
-  alignment = ms_max(alignment, MS_DEFAULT_ALIGNMENT);
+static void* bump_from_node(ms_arena_node * const node, size_t const count, size_t const alignment) {
+  uint8_t * const ptr = ms_align_ptr(node->base + node->allocated_size, alignment);
 
-  if(count > 0) {
-    ms_arena_node *prev = NULL;
+  if(ptr + count > node->base + node->total_size) {
+    return NULL;
+  }
 
-    for(ms_arena_node * node = arena->first; node != NULL; prev = node, node = node->next) {
-      uint64_t node_free_size = node->total_size - node->allocated_size;
+  node->allocated_size = (ptr + count) - node->base;
 
-      // Preliminary size check
-      if(node_free_size < count) {
-        continue;
-      }
+  return ptr;
+}
 
-      void * const ptr = allocate_from_node(node, count, alignment);
+/**
+ * Compute the size of the node chained to accommodate an allocation.
+ */
+static uint64_t get_new_node_size(ms_arena const * const arena, ms_arena_node const * const prev, size_t const count) {
+  // When allocating a new node we want to either store
+  // a minimum of 16 items if they are too large or
+  // increase the capacity to twice the amount of memory
+  // of the last available node.
+  return 2 * ms_align_sz(
+    ms_max(count * 8, prev ? prev->total_size : arena->base_size),
+    arena->base_size
+  );
+}
 
-      if(ptr != NULL) {
-        return ptr;
-      }
+static void* malloc_linear(ms_arena *const arena, size_t const count, size_t const alignment) {
+  ms_arena_node *prev = NULL;
+
+  for(ms_arena_node * node = arena->current; node != NULL; prev = node, node = node->next) {
+    // Nodes past the current one only hold released allocations
+    if(node != arena->current) {
+      node->allocated_size = 0;
     }
 
-    // Unable to allocate to any of the available nodes
-    // When allocating a new node we want to either store
-    // a minimum of 16 items if they are too large or
-    // increase the capacity to twice the amount of memory
-    // of the last available node.
-    uint64_t const new_node_size = 2 * ms_align_sz(
-      ms_max(count * 8, prev ? prev->total_size : arena->base_size),
-      arena->base_size
-    );
+    void * const ptr = bump_from_node(node, count, alignment);
 
-    ms_arena_node * const new_node = create_arena_node(arena, new_node_size);
+    if(ptr != NULL) {
+      arena->current = node;
 
-    if(prev) {
-      prev->next = new_node;
-    } else {
-      arena->first = new_node;
+      return ptr;
     }
+  }
 
-    return allocate_from_node(new_node, count, alignment);
+  ms_arena_node * const new_node = create_arena_node(arena, get_new_node_size(arena, prev, count));
+
+  if(new_node == NULL) {
+    return NULL;
+  }
+
+  append_node(arena, prev, new_node);
+  arena->current = new_node;
+
+  return bump_from_node(new_node, count, alignment);
+}
+
+static void* malloc_free_list(ms_arena *const arena, size_t const count, size_t const alignment) {
+  ms_arena_node *prev = NULL;
+
+  for(ms_arena_node * node = arena->first; node != NULL; prev = node, node = node->next) {
+    uint64_t node_free_size = node->total_size - node->allocated_size;
+
+    // Preliminary size check
+    if(node_free_size < count) {
+      continue;
+    }
+
+    void * const ptr = allocate_from_node(node, count, alignment);
+
+    if(ptr != NULL) {
+      return ptr;
+    }
+  }
+
+  // Unable to allocate to any of the available nodes
+  ms_arena_node * const new_node = create_arena_node(arena, get_new_node_size(arena, prev, count));
+
+  if(new_node == NULL) {
+    return NULL;
+  }
+
+  append_node(arena, prev, new_node);
+
+  return allocate_from_node(new_node, count, alignment);
+}
+
+void * ms_arena_malloc(ms_arena *const arena, size_t const count, size_t alignment) {
+  // Minimum alignment requirement
+  alignment = ms_max(alignment, MS_DEFAULT_ALIGNMENT);
+
+  if(count > 0) {
+    bool const is_linear = ms_test(arena->flags, MS_ARENA_LINEAR_BIT);
+    void * const ptr = is_linear
+      ? malloc_linear(arena, count, alignment)
+      : malloc_free_list(arena, count, alignment);
+
+    if(ptr != NULL) {
+      ms_memory_counters_on_malloc(&arena->counters, is_linear ? count : ms_arena_get_header(ptr)->size);
+    }
+
+    return ptr;
   }
 
   return NULL;
 }
 
 void ms_arena_free(ms_arena *const arena, void *const ptr) {
-  ms_arena_node *prev = NULL;
+  // Linear allocations are released by clearing or rolling back
+  if(ptr == NULL || ms_test(arena->flags, MS_ARENA_LINEAR_BIT)) {
+    return;
+  }
 
-  if(ptr == NULL) {
+  ms_header *const head = ms_arena_get_header(ptr);
+  ms_arena_node *const node = *OWNER_SLOT(head);
+
+  if(node == NULL || node->arena != arena || !DOES_PTR_BELONG(node, ptr)) {
+    ms_error("Attempting to free pointer not mallocd via this arena.");
     return;
   }
 
-  for(ms_arena_node * node = arena->first; node != NULL; prev = node, node = node->next) {
-    if(DOES_PTR_BELONG(node, ptr)) {
-      ms_header *const head = ms_arena_get_header(ptr);
-      ms_free_list_node * const chunk = (ms_free_list_node *)((uint8_t *)head - head->padding);
-      size_t const chunk_size = chunk->size;
+  ms_free_list_node * const chunk = (ms_free_list_node *)((uint8_t *)head - head->padding);
+  size_t const chunk_size = head->size;
 
-      ms_free_list_free(&node->free_list, chunk, head->size);
+  ms_free_list_free(&node->free_list, chunk, chunk_size);
+  ms_memory_counters_on_free(&arena->counters, chunk_size);
 
-      MS_ASSERT(node->allocated_size >= chunk_size);
-      node->allocated_size -= chunk_size;
+  MS_ASSERT(node->allocated_size >= chunk_size);
+  node->allocated_size -= chunk_size;
+
+  if(node->allocated_size == 0 && !ms_test(arena->flags, MS_ARENA_STICKY_BIT)) {
+    if(node->prev) {
+      node->prev->next = node->next;
+    } else {
+      arena->first = node->next;
+    }
 
-      if(node->allocated_size == 0 && !ms_test(arena->flags, MS_ARENA_STICKY_BIT)) {
-        ms_free(&arena->allocator, node);
+    if(node->next) {
+      node->next->prev = node->prev;
+    }
 
-        if(prev) {
-          prev->next = NULL;
-        } else {
-          arena->first = NULL;
-        }
+    ms_free(&arena->allocator, node);
+  }
+}
+
+/**
+ * Reallocate a linear allocation.
+ *
+ * The allocation size is not recorded, so up to the end of the
+ * used memory of the owning node is copied.
+ */
+static void *realloc_linear(ms_arena *const arena, void *const ptr, size_t const new_count) {
+  for(ms_arena_node * node = arena->first; node != NULL; node = node->next) {
+    if((uint8_t *)ptr >= node->base && (uint8_t *)ptr < node->base + node->allocated_size) {
+      size_t const available_size = (node->base + node->allocated_size) - (uint8_t *)ptr;
+      void * const new_ptr = ms_arena_malloc(arena, new_count, MS_DEFAULT_ALIGNMENT); // Counted as a new allocation
+
+      if(new_ptr) {
+        memcpy(new_ptr, ptr, ms_min(available_size, new_count));
       }
 
-      return;
+      return new_ptr;
+    }
+
+    if(node == arena->current) {
+      break;
     }
   }
 
-  ms_error("Attempting to free pointer not mallocd via this arena.");
+  ms_error("Attempting to reallocate pointer not mallocd via this arena.");
+
+  return NULL;
 }
 
 void *ms_arena_realloc(ms_arena *const arena, void *const ptr, size_t const new_count) {
+  if(ptr && new_count > 0 && ms_test(arena->flags, MS_ARENA_LINEAR_BIT)) {
+    return realloc_linear(arena, ptr, new_count);
+  }
+
   if(ptr) {
     if(new_count > 0) {
       ms_header * const hdr = ms_arena_get_header(ptr);
+      size_t const usable_size = USABLE_SIZE(hdr);
 
-      if(new_count <= hdr->size) {
+      if(new_count <= usable_size) {
         return ptr;
       }
 
       void * const new_ptr = ms_arena_malloc(arena, new_count, hdr->alignment);
 
-      memcpy(new_ptr, ptr, hdr->size);
-      ms_arena_free(arena, ptr);
+      if(new_ptr) {
+        memcpy(new_ptr, ptr, usable_size);
+        ms_arena_free(arena, ptr);
+      }
 
       return new_ptr;
     } else {
@@ -212,23 +357,104 @@ void *ms_arena_realloc(ms_arena *const arena, void *const ptr, size_t const new_
 }
 
 void ms_arena_clear(ms_arena *const arena) {
-  for(
-    ms_arena_node * node = arena->first, *prev = NULL;
-    node != NULL;
-    prev = node, node = node->next
-  ) {
+  arena->counters.live_size = 0;
+
+  if(!ms_test(arena->flags, MS_ARENA_STICKY_BIT)) {
+    release_nodes(arena, arena->first);
+
+    arena->first = NULL;
+    arena->current = NULL;
+
+    return;
+  }
+
+  if(ms_test(arena->flags, MS_ARENA_LINEAR_BIT)) {
+    // Following nodes are reset as allocation reaches them
+    arena->current = arena->first;
+
+    if(arena->first) {
+      arena->first->allocated_size = 0;
+    }
+
+    return;
+  }
+
+  for(ms_arena_node * node = arena->first; node != NULL; node = node->next) {
     node->allocated_size = 0;
 
-    if(!ms_test(arena->flags, MS_ARENA_STICKY_BIT)) {
-      ms_free(&arena->allocator, node);
+    ms_free_list_clear(&node->free_list);
+    ms_free_list_create_node(&node->free_list, (ms_free_list_node*)node->base, NULL, NULL, node->total_size);
+  }
+}
+
+ms_arena_savepoint ms_arena_save(ms_arena const *const arena) {
+  MS_ASSERT(ms_test(arena->flags, MS_ARENA_LINEAR_BIT));
+
+  return (ms_arena_savepoint) {
+    arena->current,
+    arena->current ? arena->current->allocated_size : 0,
+    arena->counters.live_size
+  };
+}
+
+void ms_arena_rollback(ms_arena *const arena, ms_arena_savepoint const *const savepoint) {
+  MS_ASSERT(ms_test(arena->flags, MS_ARENA_LINEAR_BIT));
+
+  if(savepoint->node == NULL) {
+    ms_arena_clear(arena);
 
-      if(prev) {
-        prev->next = NULL;
-      } else {
-        arena->first = NULL;
+    return;
+  }
+
+  if(!ms_test(arena->flags, MS_ARENA_STICKY_BIT)) {
+    release_nodes(arena, savepoint->node->next);
+    savepoint->node->next = NULL;
+  }
+
+  arena->current = savepoint->node;
+  arena->current->allocated_size = savepoint->allocated_size;
+  arena->counters.live_size = savepoint->live_size;
+}
+
+void ms_arena_get_stats(ms_arena const *const arena, ms_memory_stats *const out_stats) {
+  *out_stats = (ms_memory_stats) {
+    0, // reserved_size
+    0, // committed_size
+    0, // live_size
+    arena->counters.peak_live_size,
+    arena->counters.alloc_count,
+    arena->counters.free_count,
+    0, // free_node_count
+    0, // free_size
+    0, // largest_free_size
+    0.0 // fragmentation
+  };
+
+  bool const is_linear = ms_test(arena->flags, MS_ARENA_LINEAR_BIT);
+  bool is_past_current = false; // Linear mode - nodes past the current one are empty
+
+  for(ms_arena_node const * node = arena->first; node != NULL; node = node->next) {
+    uint64_t const allocated_size = is_past_current ? 0 : node->allocated_size;
+
+    out_stats->reserved_size += node->total_size + sizeof(ms_arena_node);
+    out_stats->live_size += allocated_size;
+
+    if(is_linear) {
+      uint64_t const free_size = node->total_size - allocated_size;
+
+      if(free_size > 0) {
+        out_stats->free_node_count++;
+        out_stats->free_size += free_size;
+        out_stats->largest_free_size = ms_max(out_stats->largest_free_size, free_size);
       }
+
+      is_past_current = is_past_current || node == arena->current;
     } else {
-      ms_free_list_create_node(&node->free_list, (ms_free_list_node*)node->base, NULL, NULL, node->total_size);
+      ms_free_list_get_stats(&node->free_list, out_stats);
     }
   }
+
+  // Node memory is drawn from the arena allocator, whole
+  out_stats->committed_size = out_stats->reserved_size;
+  out_stats->fragmentation = ms_memory_stats_get_fragmentation(out_stats);
 }
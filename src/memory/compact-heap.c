@@ -0,0 +1,257 @@
+#include <string.h>
+#include <moonsugar/assert.h>
+#include <moonsugar/log.h>
+#include <moonsugar/util.h>
+#include <moonsugar/sys.h>
+#include <moonsugar/thread.h>
+#include <moonsugar/compact-heap.h>
+
+// Must be a multiple of MS_COMPACT_HEAP_ALIGNMENT in size
+typedef struct {
+  uint64_t size; // Block size, header included
+  ms_handle handle; // MS_HINVALID when free
+  uint32_t reserved;
+} block_header;
+
+ms_result ms_compact_heap_construct(ms_compact_heap *const heap, ms_compact_heap_description const *const description) {
+  MS_ASSERT(heap);
+  MS_ASSERT(description);
+
+  if(!ms_is_multiple(description->size, ms_get_sys_info()->page_size) || description->handle_capacity % 64 != 0) {
+    ms_error("Invalid compacting heap size or handle capacity.");
+    return MS_RESULT_INVALID_ARGUMENT;
+  }
+
+  uint8_t *const base = ms_reserve(description->size, 0);
+
+  if(base == NULL) {
+    ms_error("Unable to reserve memory.");
+    return MS_RESULT_MEMORY;
+  }
+
+  *heap = (ms_compact_heap) {
+    base,
+    description->size,
+    0, // committed_size
+    base, // top
+    0, // free_size
+    NULL, // scan
+    NULL, // dest
+    { 0 }, // handles
+    NULL, // blocks
+    description->allocator
+  };
+
+  ms_result const result = ms_ipool_construct(
+    &heap->handles,
+    &(ms_ipool_description) { description->allocator, description->handle_capacity }
+  );
+
+  if(result != MS_RESULT_SUCCESS) {
+    ms_release(base, description->size, 0);
+    return result;
+  }
+
+  if(description->handle_capacity > 0) {
+    heap->blocks = ms_malloc(&heap->allocator, description->handle_capacity * sizeof(void*), MS_DEFAULT_ALIGNMENT);
+
+    if(heap->blocks == NULL) {
+      ms_ipool_destroy(&heap->handles);
+      ms_release(base, description->size, 0);
+      return MS_RESULT_MEMORY;
+    }
+  }
+
+  return MS_RESULT_SUCCESS;
+}
+
+void ms_compact_heap_destroy(ms_compact_heap *const heap) {
+  MS_ASSERT(heap);
+
+  ms_free(&heap->allocator, heap->blocks);
+  ms_ipool_destroy(&heap->handles);
+  ms_release(heap->base, heap->size, 0);
+
+  heap->base = heap->top = NULL;
+  heap->blocks = NULL;
+}
+
+/**
+ * Commit the memory up to an address.
+ *
+ * @return True on success, false on failure.
+ */
+static bool commit_to(ms_compact_heap *const heap, uint8_t const *const end) {
+  uint64_t const required_size = end - heap->base;
+
+  if(required_size <= heap->committed_size) {
+    return true;
+  }
+
+  uint64_t const new_committed_size = ms_min(ms_align_sz(required_size, ms_get_sys_info()->page_size), heap->size);
+
+  if(!ms_commit(heap->base + heap->committed_size, new_committed_size - heap->committed_size, 0)) {
+    return false;
+  }
+
+  heap->committed_size = new_committed_size;
+
+  return true;
+}
+
+/**
+ * Decommit the whole pages past the heap top.
+ */
+static void decommit_top(ms_compact_heap *const heap) {
+  uint64_t const new_committed_size = ms_align_sz(heap->top - heap->base, ms_get_sys_info()->page_size);
+
+  if(new_committed_size < heap->committed_size) {
+    ms_decommit(heap->base + new_committed_size, heap->committed_size - new_committed_size, 0);
+
+    heap->committed_size = new_committed_size;
+  }
+}
+
+/**
+ * Acquire a handle, growing the handle table when full.
+ *
+ * @return The raw handle or MS_HINVALID on failure.
+ */
+static ms_handle acquire_handle(ms_compact_heap *const heap) {
+  uint32_t const handle = ms_ipool_acquire(&heap->handles);
+
+  if(handle != UINT32_MAX) {
+    return handle;
+  }
+
+  uint32_t const old_capacity = heap->handles.item_count;
+  uint32_t const new_capacity = old_capacity > 0 ? old_capacity * 2 : 64;
+
+  if(new_capacity <= old_capacity) {
+    return MS_HINVALID;
+  }
+
+  void **const new_blocks = ms_realloc(&heap->allocator, heap->blocks, new_capacity * sizeof(void*));
+
+  if(new_blocks == NULL) {
+    return MS_HINVALID;
+  }
+
+  heap->blocks = new_blocks;
+
+  if(ms_ipool_resize(&heap->handles, new_capacity) != MS_RESULT_SUCCESS) {
+    return MS_HINVALID;
+  }
+
+  return ms_ipool_acquire(&heap->handles);
+}
+
+ms_compact_handle ms_compact_heap_malloc(ms_compact_heap *const heap, size_t const count) {
+  MS_ASSERT(heap);
+
+  if(count == 0 || count > heap->size) {
+    return (ms_compact_handle) { MS_HINVALID };
+  }
+
+  uint64_t const block_size = ms_align_sz(sizeof(block_header) + count, MS_COMPACT_HEAP_ALIGNMENT);
+  uint8_t *const end = heap->base + heap->size;
+
+  if(block_size > (uint64_t)(end - heap->top) && heap->free_size > 0) {
+    ms_compact_heap_compact(heap, MS_TIME_INFINITY);
+  }
+
+  if(block_size > (uint64_t)(end - heap->top) || !commit_to(heap, heap->top + block_size)) {
+    return (ms_compact_handle) { MS_HINVALID };
+  }
+
+  ms_handle const handle = acquire_handle(heap);
+
+  if(!ms_hraw_is_valid(handle)) {
+    return (ms_compact_handle) { MS_HINVALID };
+  }
+
+  block_header *const hdr = (block_header*)heap->top;
+
+  *hdr = (block_header) { block_size, handle, 0 };
+  heap->top += block_size;
+  heap->blocks[handle] = hdr + 1;
+
+  return (ms_compact_handle) { handle };
+}
+
+void ms_compact_heap_free(ms_compact_heap *const heap, ms_compact_handle const handle) {
+  MS_ASSERT(heap);
+
+  if(!ms_his_valid(handle)) {
+    return;
+  }
+
+  block_header *const hdr = (block_header*)heap->blocks[handle.raw] - 1;
+
+  MS_ASSERT(hdr->handle == handle.raw);
+
+  hdr->handle = MS_HINVALID;
+  ms_result const result MSUNUSED = ms_ipool_release(&heap->handles, handle.raw);
+  MS_ASSERT(result == MS_RESULT_SUCCESS);
+
+  // The top can only move while no compaction is in progress
+  if(heap->scan == NULL && (uint8_t*)hdr + hdr->size == heap->top) {
+    heap->top = (uint8_t*)hdr;
+  } else {
+    heap->free_size += hdr->size;
+  }
+}
+
+size_t ms_compact_heap_get_size(ms_compact_heap const *const heap, ms_compact_handle const handle) {
+  MS_ASSERT(heap);
+  MS_ASSERT(ms_his_valid(handle));
+
+  block_header const *const hdr = (block_header*)heap->blocks[handle.raw] - 1;
+
+  return hdr->size - sizeof(block_header);
+}
+
+bool ms_compact_heap_compact(ms_compact_heap *const heap, ms_time const budget) {
+  MS_ASSERT(heap);
+
+  if(heap->scan == NULL) {
+    if(heap->free_size == 0) {
+      return true;
+    }
+
+    heap->scan = heap->dest = heap->base;
+  }
+
+  ms_time const now = budget != MS_TIME_INFINITY ? ms_get_time() : 0;
+  ms_time const deadline = budget < MS_TIME_INFINITY - now ? now + budget : MS_TIME_INFINITY;
+
+  while(heap->scan < heap->top) {
+    block_header const *const hdr = (block_header*)heap->scan;
+    uint64_t const size = hdr->size;
+    ms_handle const handle = hdr->handle;
+
+    if(ms_hraw_is_valid(handle)) {
+      if(heap->dest != heap->scan) {
+        memmove(heap->dest, heap->scan, size);
+        heap->blocks[handle] = (block_header*)heap->dest + 1;
+      }
+
+      heap->dest += size;
+    }
+
+    heap->scan += size;
+
+    if(deadline != MS_TIME_INFINITY && heap->scan < heap->top && ms_get_time() >= deadline) {
+      return false;
+    }
+  }
+
+  // Holes freed behind the destination during compaction are left for the next one
+  heap->free_size -= heap->top - heap->dest;
+  heap->top = heap->dest;
+  heap->scan = heap->dest = NULL;
+
+  decommit_top(heap);
+
+  return true;
+}
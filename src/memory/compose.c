@@ -0,0 +1,261 @@
+#include <memory.h>
+#include <moonsugar/assert.h>
+#include <moonsugar/log.h>
+#include <moonsugar/util.h>
+#include <moonsugar/compose.h>
+
+static bool owns(ms_routed_allocator const *const routed, void *const ptr) {
+  return routed->owns(routed->allocator.user, ptr);
+}
+
+/**
+ * Get the allocator owning a block, out of two.
+ *
+ * One of the allocators must test ownership.
+ */
+static ms_routed_allocator const * get_pair_owner(
+  ms_routed_allocator const *const a,
+  ms_routed_allocator const *const b,
+  void *const ptr
+) {
+  if(a->owns != NULL) {
+    return owns(a, ptr) ? a : b;
+  }
+
+  return owns(b, ptr) ? b : a;
+}
+
+/**
+ * Move a block to another allocator.
+ *
+ * @param from The allocator owning the block. Must report block sizes.
+ * @param to The allocator to move the block to.
+ * @param ptr The block.
+ * @param new_count The new block size, in bytes. Must not be 0.
+ *
+ * @return The moved block, or NULL on failure, leaving the block untouched.
+ */
+static void * move(
+  ms_routed_allocator const *const from,
+  ms_routed_allocator const *const to,
+  void *const ptr,
+  size_t const new_count
+) {
+  void *const new_ptr = ms_malloc(&to->allocator, new_count, MS_DEFAULT_ALIGNMENT);
+
+  if(new_ptr != NULL) {
+    memcpy(new_ptr, ptr, ms_min(from->get_size(from->allocator.user, ptr), new_count));
+    ms_free(&from->allocator, ptr);
+  }
+
+  return new_ptr;
+}
+
+ms_result ms_fallback_construct(ms_fallback *const fallback, ms_fallback_description const *const description) {
+  MS_ASSERT(fallback);
+  MS_ASSERT(description);
+
+  if(description->primary.owns == NULL && description->secondary.owns == NULL) {
+    ms_error("Fallback allocator ownership cannot be tested.");
+    return MS_RESULT_INVALID_ARGUMENT;
+  }
+
+  *fallback = (ms_fallback) {
+    description->primary,
+    description->secondary
+  };
+
+  return MS_RESULT_SUCCESS;
+}
+
+void * ms_fallback_malloc(ms_fallback *const fallback, size_t const count, size_t const alignment) {
+  MS_ASSERT(fallback);
+
+  void *const ptr = ms_malloc(&fallback->primary.allocator, count, alignment);
+
+  if(ptr != NULL || count == 0) {
+    return ptr;
+  }
+
+  return ms_malloc(&fallback->secondary.allocator, count, alignment);
+}
+
+void * ms_fallback_realloc(ms_fallback *const fallback, void *const ptr, size_t const new_count) {
+  MS_ASSERT(fallback);
+
+  if(ptr == NULL) {
+    return ms_fallback_malloc(fallback, new_count, MS_DEFAULT_ALIGNMENT);
+  }
+
+  ms_routed_allocator const *const owner = get_pair_owner(&fallback->primary, &fallback->secondary, ptr);
+  void *const new_ptr = ms_realloc(&owner->allocator, ptr, new_count);
+
+  if(new_ptr != NULL || new_count == 0 || owner != &fallback->primary || owner->get_size == NULL) {
+    return new_ptr;
+  }
+
+  return move(owner, &fallback->secondary, ptr, new_count);
+}
+
+void ms_fallback_free(ms_fallback *const fallback, void *const ptr) {
+  MS_ASSERT(fallback);
+
+  if(ptr != NULL) {
+    ms_free(&get_pair_owner(&fallback->primary, &fallback->secondary, ptr)->allocator, ptr);
+  }
+}
+
+ms_result ms_segregator_construct(ms_segregator *const segregator, ms_segregator_description const *const description) {
+  MS_ASSERT(segregator);
+  MS_ASSERT(description);
+
+  if(description->small.owns == NULL && description->large.owns == NULL) {
+    ms_error("Segregator allocator ownership cannot be tested.");
+    return MS_RESULT_INVALID_ARGUMENT;
+  }
+
+  *segregator = (ms_segregator) {
+    description->threshold,
+    description->small,
+    description->large
+  };
+
+  return MS_RESULT_SUCCESS;
+}
+
+void * ms_segregator_malloc(ms_segregator *const segregator, size_t const count, size_t const alignment) {
+  MS_ASSERT(segregator);
+
+  ms_routed_allocator const *const target = count <= segregator->threshold ? &segregator->small : &segregator->large;
+
+  return ms_malloc(&target->allocator, count, alignment);
+}
+
+void * ms_segregator_realloc(ms_segregator *const segregator, void *const ptr, size_t const new_count) {
+  MS_ASSERT(segregator);
+
+  if(ptr == NULL) {
+    return ms_segregator_malloc(segregator, new_count, MS_DEFAULT_ALIGNMENT);
+  }
+
+  ms_routed_allocator const *const owner = get_pair_owner(&segregator->small, &segregator->large, ptr);
+  ms_routed_allocator const *const target = new_count <= segregator->threshold ? &segregator->small : &segregator->large;
+
+  if(owner == target || new_count == 0 || owner->get_size == NULL) {
+    return ms_realloc(&owner->allocator, ptr, new_count);
+  }
+
+  return move(owner, target, ptr, new_count);
+}
+
+void ms_segregator_free(ms_segregator *const segregator, void *const ptr) {
+  MS_ASSERT(segregator);
+
+  if(ptr != NULL) {
+    ms_free(&get_pair_owner(&segregator->small, &segregator->large, ptr)->allocator, ptr);
+  }
+}
+
+ms_result ms_bucketizer_construct(ms_bucketizer *const bucketizer, ms_bucketizer_description const *const description) {
+  MS_ASSERT(bucketizer);
+  MS_ASSERT(description);
+
+  uint32_t const bucket_count = description->bucket_count;
+  uint32_t default_owner = bucket_count;
+
+  if(bucket_count == 0 || bucket_count > MS_BUCKETIZER_MAX_BUCKETS) {
+    ms_error("Invalid bucket count.");
+    return MS_RESULT_INVALID_ARGUMENT;
+  }
+
+  for(uint32_t i = 0; i < bucket_count; ++i) {
+    ms_bucket const *const bucket = &description->buckets[i];
+
+    if(i > 0 && bucket->max_size <= description->buckets[i - 1].max_size) {
+      ms_error("Buckets must be sorted by max size.");
+      return MS_RESULT_INVALID_ARGUMENT;
+    }
+
+    if(bucket->allocator.owns == NULL) {
+      if(default_owner != bucket_count) {
+        ms_error("Bucketizer allocator ownership cannot be tested.");
+        return MS_RESULT_INVALID_ARGUMENT;
+      }
+
+      default_owner = i;
+    }
+
+    bucketizer->max_sizes[i] = bucket->max_size;
+    bucketizer->allocators[i] = bucket->allocator;
+  }
+
+  bucketizer->bucket_count = bucket_count;
+  bucketizer->default_owner = default_owner; // Past the last bucket if all test ownership
+
+  return MS_RESULT_SUCCESS;
+}
+
+/**
+ * Get the allocator owning a block.
+ *
+ * @return The owner or NULL if no bucket claims the block.
+ */
+static ms_routed_allocator const * get_bucket_owner(ms_bucketizer const *const bucketizer, void *const ptr) {
+  for(uint32_t i = 0; i < bucketizer->bucket_count; ++i) {
+    ms_routed_allocator const *const routed = &bucketizer->allocators[i];
+
+    if(routed->owns != NULL && owns(routed, ptr)) {
+      return routed;
+    }
+  }
+
+  return bucketizer->default_owner < bucketizer->bucket_count
+    ? &bucketizer->allocators[bucketizer->default_owner]
+    : NULL;
+}
+
+void * ms_bucketizer_malloc(ms_bucketizer *const bucketizer, size_t const count, size_t const alignment) {
+  MS_ASSERT(bucketizer);
+
+  for(uint32_t i = 0; i < bucketizer->bucket_count; ++i) {
+    if(count <= bucketizer->max_sizes[i]) {
+      return ms_malloc(&bucketizer->allocators[i].allocator, count, alignment);
+    }
+  }
+
+  return NULL;
+}
+
+void * ms_bucketizer_realloc(ms_bucketizer *const bucketizer, void *const ptr, size_t const new_count) {
+  MS_ASSERT(bucketizer);
+
+  if(ptr == NULL) {
+    return ms_bucketizer_malloc(bucketizer, new_count, MS_DEFAULT_ALIGNMENT);
+  }
+
+  ms_routed_allocator const *const owner = get_bucket_owner(bucketizer, ptr);
+
+  if(owner == NULL) {
+    ms_fatalf("Attempting to reallocate a pointer (%p) not allocated via this bucketizer.", ptr);
+    return NULL;
+  }
+
+  return ms_realloc(&owner->allocator, ptr, new_count);
+}
+
+void ms_bucketizer_free(ms_bucketizer *const bucketizer, void *const ptr) {
+  MS_ASSERT(bucketizer);
+
+  if(ptr == NULL) {
+    return;
+  }
+
+  ms_routed_allocator const *const owner = get_bucket_owner(bucketizer, ptr);
+
+  if(owner == NULL) {
+    ms_fatalf("Attempting to free a pointer (%p) not allocated via this bucketizer.", ptr);
+    return;
+  }
+
+  ms_free(&owner->allocator, ptr);
+}
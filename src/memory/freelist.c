@@ -11,11 +11,377 @@
 // End pointer of chunk
 #define NODE_END(chunk) ((void *)((uint8_t *)(chunk) + (chunk)->size))
 
-static uint64_t compute_free_list_node_size(uint64_t const alloc_size, uint32_t const alignment) {
-  return ms_align_sz(alloc_size + sizeof(ms_header) + alignment - 1, alignment);
+uint64_t ms_free_list_get_node_size(uint64_t const alloc_size, uint32_t const alignment) {
+  // Allocated chunks must be able to host a node once freed
+  return ms_max(
+    ms_align_sz(alloc_size + sizeof(ms_header) + alignment - 1, alignment),
+    ms_align_sz(sizeof(ms_free_list_node), alignment)
+  );
 }
 
-void ms_free_list_create_node(
+/**
+ * Compute the bin indices of a size.
+ *
+ * @param size The size. Must be at least `sizeof(ms_free_list_node)`.
+ * @param out_fl The first level index.
+ * @param out_sl The second level index.
+ */
+static void get_bin_index(uint64_t const size, uint32_t *const out_fl, uint32_t *const out_sl) {
+  MS_ASSERT(size >= sizeof(ms_free_list_node));
+
+  uint32_t const fl = 63 - __builtin_clzll(size);
+
+  *out_fl = fl;
+  *out_sl = (size >> (fl - MS_FREE_LIST_SL_BITS)) & (MS_FREE_LIST_SL_COUNT - 1);
+}
+
+static void bin_insert(ms_free_list *const list, ms_free_list_node *const node) {
+  uint32_t fl, sl;
+
+  get_bin_index(node->size, &fl, &sl);
+
+  ms_free_list_node *const head = list->bins[fl][sl];
+
+  node->bin_prev = NULL;
+  node->bin_next = head;
+
+  if(head) {
+    head->bin_prev = node;
+  }
+
+  list->bins[fl][sl] = node;
+  list->fl_bitmap |= 1ull << fl;
+  list->sl_bitmaps[fl] |= 1u << sl;
+}
+
+static void bin_remove(ms_free_list *const list, ms_free_list_node *const node) {
+  uint32_t fl, sl;
+
+  get_bin_index(node->size, &fl, &sl);
+
+  if(node->bin_prev) {
+    node->bin_prev->bin_next = node->bin_next;
+  } else {
+    MS_ASSERT(list->bins[fl][sl] == node);
+
+    list->bins[fl][sl] = node->bin_next;
+
+    if(list->bins[fl][sl] == NULL) {
+      list->sl_bitmaps[fl] &= ~(1u << sl);
+
+      if(list->sl_bitmaps[fl] == 0) {
+        list->fl_bitmap &= ~(1ull << fl);
+      }
+    }
+  }
+
+  if(node->bin_next) {
+    node->bin_next->bin_prev = node->bin_prev;
+  }
+}
+
+/*
+ * Address index
+ *
+ * Intrusive red-black tree of the free nodes, keyed by address,
+ * used to locate the neighbours of a freed chunk in O(log n).
+ */
+
+static bool is_red(ms_free_list_node const *const node) {
+  return node != NULL && node->is_red;
+}
+
+static void tree_set_child(
+  ms_free_list *const list,
+  ms_free_list_node *const parent,
+  ms_free_list_node *const old_child,
+  ms_free_list_node *const new_child
+) {
+  if(parent == NULL) {
+    list->root = new_child;
+  } else if(parent->left == old_child) {
+    parent->left = new_child;
+  } else {
+    parent->right = new_child;
+  }
+
+  if(new_child) {
+    new_child->parent = parent;
+  }
+}
+
+static void tree_rotate_left(ms_free_list *const list, ms_free_list_node *const x) {
+  ms_free_list_node *const y = x->right;
+
+  x->right = y->left;
+
+  if(y->left) {
+    y->left->parent = x;
+  }
+
+  tree_set_child(list, x->parent, x, y);
+  y->left = x;
+  x->parent = y;
+}
+
+static void tree_rotate_right(ms_free_list *const list, ms_free_list_node *const x) {
+  ms_free_list_node *const y = x->left;
+
+  x->left = y->right;
+
+  if(y->right) {
+    y->right->parent = x;
+  }
+
+  tree_set_child(list, x->parent, x, y);
+  y->right = x;
+  x->parent = y;
+}
+
+static void tree_insert(ms_free_list *const list, ms_free_list_node *node) {
+  ms_free_list_node *parent = NULL;
+  ms_free_list_node **link = &list->root;
+
+  while(*link) {
+    parent = *link;
+    link = node < parent ? &parent->left : &parent->right;
+  }
+
+  node->parent = parent;
+  node->left = NULL;
+  node->right = NULL;
+  node->is_red = true;
+  *link = node;
+
+  while(is_red(node->parent)) {
+    ms_free_list_node *p = node->parent;
+    ms_free_list_node *const g = p->parent; // Never NULL, the root is black
+
+    if(p == g->left) {
+      ms_free_list_node *const u = g->right;
+
+      if(is_red(u)) {
+        p->is_red = false;
+        u->is_red = false;
+        g->is_red = true;
+        node = g;
+      } else {
+        if(node == p->right) {
+          node = p;
+          tree_rotate_left(list, node);
+          p = node->parent;
+        }
+
+        p->is_red = false;
+        g->is_red = true;
+        tree_rotate_right(list, g);
+      }
+    } else {
+      ms_free_list_node *const u = g->left;
+
+      if(is_red(u)) {
+        p->is_red = false;
+        u->is_red = false;
+        g->is_red = true;
+        node = g;
+      } else {
+        if(node == p->left) {
+          node = p;
+          tree_rotate_right(list, node);
+          p = node->parent;
+        }
+
+        p->is_red = false;
+        g->is_red = true;
+        tree_rotate_left(list, g);
+      }
+    }
+  }
+
+  list->root->is_red = false;
+}
+
+static void tree_remove_fixup(
+  ms_free_list *const list,
+  ms_free_list_node *x,
+  ms_free_list_node *parent
+) {
+  while(x != list->root && !is_red(x)) {
+    if(x == parent->left) {
+      ms_free_list_node *w = parent->right;
+
+      if(is_red(w)) {
+        w->is_red = false;
+        parent->is_red = true;
+        tree_rotate_left(list, parent);
+        w = parent->right;
+      }
+
+      if(!is_red(w->left) && !is_red(w->right)) {
+        w->is_red = true;
+        x = parent;
+        parent = x->parent;
+      } else {
+        if(!is_red(w->right)) {
+          w->left->is_red = false;
+          w->is_red = true;
+          tree_rotate_right(list, w);
+          w = parent->right;
+        }
+
+        w->is_red = parent->is_red;
+        parent->is_red = false;
+        w->right->is_red = false;
+        tree_rotate_left(list, parent);
+        x = list->root;
+      }
+    } else {
+      ms_free_list_node *w = parent->left;
+
+      if(is_red(w)) {
+        w->is_red = false;
+        parent->is_red = true;
+        tree_rotate_right(list, parent);
+        w = parent->left;
+      }
+
+      if(!is_red(w->left) && !is_red(w->right)) {
+        w->is_red = true;
+        x = parent;
+        parent = x->parent;
+      } else {
+        if(!is_red(w->left)) {
+          w->right->is_red = false;
+          w->is_red = true;
+          tree_rotate_left(list, w);
+          w = parent->left;
+        }
+
+        w->is_red = parent->is_red;
+        parent->is_red = false;
+        w->left->is_red = false;
+        tree_rotate_right(list, parent);
+        x = list->root;
+      }
+    }
+  }
+
+  if(x) {
+    x->is_red = false;
+  }
+}
+
+static void tree_remove(ms_free_list *const list, ms_free_list_node *const node) {
+  ms_free_list_node *x;
+  ms_free_list_node *x_parent;
+  bool removed_red = node->is_red;
+
+  if(node->left == NULL) {
+    x = node->right;
+    x_parent = node->parent;
+    tree_set_child(list, node->parent, node, node->right);
+  } else if(node->right == NULL) {
+    x = node->left;
+    x_parent = node->parent;
+    tree_set_child(list, node->parent, node, node->left);
+  } else {
+    // Replace with the successor
+    ms_free_list_node *y = node->right;
+
+    while(y->left) {
+      y = y->left;
+    }
+
+    removed_red = y->is_red;
+    x = y->right;
+
+    if(y->parent == node) {
+      x_parent = y;
+    } else {
+      x_parent = y->parent;
+      tree_set_child(list, y->parent, y, y->right);
+      y->right = node->right;
+      y->right->parent = y;
+    }
+
+    tree_set_child(list, node->parent, node, y);
+    y->left = node->left;
+    y->left->parent = y;
+    y->is_red = node->is_red;
+  }
+
+  if(!removed_red) {
+    tree_remove_fixup(list, x, x_parent);
+  }
+}
+
+/**
+ * Make a node take the place of another one in the address index.
+ *
+ * The replacement must keep the address ordering of the tree.
+ */
+static void tree_replace(
+  ms_free_list *const list,
+  ms_free_list_node *const old_node,
+  ms_free_list_node *const new_node
+) {
+  new_node->left = old_node->left;
+  new_node->right = old_node->right;
+  new_node->is_red = old_node->is_red;
+
+  tree_set_child(list, old_node->parent, old_node, new_node);
+
+  if(new_node->left) {
+    new_node->left->parent = new_node;
+  }
+
+  if(new_node->right) {
+    new_node->right->parent = new_node;
+  }
+}
+
+void ms_free_list_clear(ms_free_list *const list) {
+  list->first = NULL;
+  list->root = NULL;
+  list->fl_bitmap = 0;
+
+  memset(list->sl_bitmaps, 0, sizeof(list->sl_bitmaps));
+  memset(list->bins, 0, sizeof(list->bins));
+}
+
+/**
+ * Offset a node pointer, leaving NULL as is.
+ */
+static ms_free_list_node * offset_node(ms_free_list_node *const node, intptr_t const offset) {
+  return node != NULL ? (ms_free_list_node *)((uint8_t *)node + offset) : NULL;
+}
+
+void ms_free_list_relocate(ms_free_list *const list, intptr_t const offset) {
+  list->first = offset_node(list->first, offset);
+  list->root = offset_node(list->root, offset);
+
+  for(uint32_t i = 0; i < MS_FREE_LIST_FL_COUNT; ++i) {
+    for(uint32_t j = 0; j < MS_FREE_LIST_SL_COUNT; ++j) {
+      list->bins[i][j] = offset_node(list->bins[i][j], offset);
+    }
+  }
+
+  // Links are relocated before being followed
+  for(ms_free_list_node *node = list->first; node != NULL; node = node->next) {
+    node->next = offset_node(node->next, offset);
+    node->prev = offset_node(node->prev, offset);
+    node->bin_next = offset_node(node->bin_next, offset);
+    node->bin_prev = offset_node(node->bin_prev, offset);
+    node->left = offset_node(node->left, offset);
+    node->right = offset_node(node->right, offset);
+    node->parent = offset_node(node->parent, offset);
+  }
+}
+
+/**
+ * Initialise a node and link it in the address-ordered list and its bin.
+ */
+static void init_node(
   ms_free_list* const list,
   ms_free_list_node *const chunk,
   ms_free_list_node *const prev,
@@ -41,6 +407,19 @@ void ms_free_list_create_node(
     MS_ASSERT(next > chunk);
     next->prev = chunk;
   }
+
+  bin_insert(list, chunk);
+}
+
+void ms_free_list_create_node(
+  ms_free_list* const list,
+  ms_free_list_node *const chunk,
+  ms_free_list_node *const prev,
+  ms_free_list_node *const next,
+  uint64_t const size
+) {
+  init_node(list, chunk, prev, next, size);
+  tree_insert(list, chunk);
 }
 
 static void detach_node(ms_free_list *const list, ms_free_list_node *const chunk) {
@@ -57,34 +436,71 @@ static void detach_node(ms_free_list *const list, ms_free_list_node *const chunk
   if(chunk->next) {
     chunk->next->prev = chunk->prev;
   }
+
+  bin_remove(list, chunk);
+  tree_remove(list, chunk);
 }
 
-static ms_free_list_node * find_smallest_node(
+/**
+ * Find a node large enough to host the given size.
+ *
+ * The head of the bin containing the size is tried first, so that
+ * freed chunks are reused by allocations of the same size. Otherwise
+ * the size is rounded up to the next bin boundary, so that any node
+ * in the first non-empty bin at or above it is guaranteed to fit. When
+ * no such bin exists, the bin containing the size itself is searched,
+ * as it can still host a node large enough.
+ *
+ * @param list The free list.
+ * @param aligned_count The minimum node size.
+ *
+ * @return A suitable node or NULL if none is found.
+ */
+static ms_free_list_node * find_suitable_node(
   ms_free_list *const list,
   size_t const aligned_count
 ) {
-  ms_free_list_node *smallest = NULL;
-  ms_free_list_node *chunk;
+  uint32_t fl, sl;
 
-  // Find first chunk that can at least cover the requirement
-  for(chunk = list->first; chunk != NULL; chunk = chunk->next) {
-    if(chunk->size >= aligned_count) {
-      smallest = chunk;
-      break;
+  get_bin_index(aligned_count, &fl, &sl);
+
+  uint32_t const exact_fl = fl;
+  uint32_t const exact_sl = sl;
+  ms_free_list_node *const exact_head = list->bins[exact_fl][exact_sl];
+
+  if(exact_head && exact_head->size >= aligned_count) {
+    return exact_head;
+  }
+
+  uint64_t const rounded_count = aligned_count + (1ull << (fl - MS_FREE_LIST_SL_BITS)) - 1;
+
+  get_bin_index(rounded_count, &fl, &sl);
+
+  uint32_t sl_bitmap = list->sl_bitmaps[fl] & (~0u << sl);
+
+  if(sl_bitmap == 0) {
+    uint64_t const fl_bitmap = fl + 1 < MS_FREE_LIST_FL_COUNT
+      ? list->fl_bitmap & (~0ull << (fl + 1))
+      : 0;
+
+    if(fl_bitmap != 0) {
+      fl = __builtin_ctzll(fl_bitmap);
+      sl_bitmap = list->sl_bitmaps[fl];
     }
   }
 
-  // Refine to see if there is any smaller chunk satisfying the
-  // requirement
-  if(chunk && smallest) {
-    for(chunk = chunk->next; chunk != NULL && chunk->size < smallest->size; chunk = chunk->next) {
-      if(chunk->size >= aligned_count) {
-        smallest = chunk;
-      }
+  if(sl_bitmap != 0) {
+    return list->bins[fl][__builtin_ctz(sl_bitmap)];
+  }
+
+  // Last resort - nodes sharing the bin of the requested size
+  for(ms_free_list_node *chunk = exact_head; chunk != NULL; chunk = chunk->bin_next) {
+    if(chunk->size >= aligned_count) {
+      return chunk;
     }
   }
 
-  return smallest;
+  return NULL;
 }
 
 static size_t malloc_node(
@@ -101,7 +517,10 @@ static size_t malloc_node(
   if(remaining_size >= sizeof(ms_free_list_node)) { // Can be split
     ms_free_list_node *const remaining_free_list_node = (ms_free_list_node *)((uint8_t *)chunk + total_alloc_size);
 
-    ms_free_list_create_node(list, remaining_free_list_node, chunk, chunk->next, remaining_size);
+    // The remaining node takes the place of the chunk in the address index
+    bin_remove(list, chunk);
+    init_node(list, remaining_free_list_node, chunk->prev, chunk->next, remaining_size);
+    tree_replace(list, chunk, remaining_free_list_node);
 
     MS_ASSERT(chunk->size > remaining_size);
     MS_ASSERT(!remaining_free_list_node->next || remaining_free_list_node < remaining_free_list_node->next);
@@ -109,9 +528,9 @@ static size_t malloc_node(
     chunk->size -= remaining_size;
   } else { // Cannot be split, take the whole chunk
     new_total_alloc_size = chunk->size;
+    detach_node(list, chunk);
   }
 
-  detach_node(list, chunk);
   MS_ASSERT(!chunk->next || NODE_END(chunk) <= (void *)chunk->next);
 
   return new_total_alloc_size;
@@ -123,8 +542,8 @@ void *ms_free_list_malloc(
   uint32_t const alignment,
   size_t *const out_total_size
 ) {
-  size_t total_size = compute_free_list_node_size(count, alignment);
-  ms_free_list_node *const chunk = find_smallest_node(list, total_size);
+  size_t total_size = ms_free_list_get_node_size(count, alignment);
+  ms_free_list_node *const chunk = find_suitable_node(list, total_size);
 
   if(chunk) {
     list->on_before_alloc_from_node(list, chunk, total_size, list->user);
@@ -141,7 +560,9 @@ static void coalesce(ms_free_list *const list, ms_free_list_node *const left, ms
   MS_ASSERT(right);
 
   detach_node(list, right);
+  bin_remove(list, left);
   left->size += right->size;
+  bin_insert(list, left);
 }
 
 /**
@@ -175,26 +596,67 @@ static ms_free_list_node * try_coalesce_neighbors(ms_free_list *const list, ms_f
   return chunk;
 }
 
+/**
+ * Find the last node preceding the given address.
+ *
+ * @param list The free list.
+ * @param subject The address.
+ *
+ * @return The node preceding the address or NULL if none does.
+ */
 static ms_free_list_node *find_prev_node(ms_free_list *const list, ms_free_list_node *const subject) {
-  for(ms_free_list_node *c = list->first; c != NULL; c = c->next) {
-    if(NODE_END(c) <= (void*)subject) { // c is a previous chunk
-      if(
-        (c->next == NULL) // c is last chunk of list
-        || ((void*)c->next >= NODE_END(subject)) // subject is in between c and next
-      ) {
-        return c;
-      }
+  ms_free_list_node *prev = NULL;
+
+  for(ms_free_list_node *c = list->root; c != NULL; ) {
+    if(c < subject) {
+      prev = c;
+      c = c->right;
     } else {
-      break; // All remaining chunks > subject
+      c = c->left;
     }
   }
 
+  return prev;
+}
+
+/**
+ * Find the node starting at the given address.
+ *
+ * @return The node or NULL if no node starts at the address.
+ */
+static ms_free_list_node *find_node_at(ms_free_list *const list, void *const addr) {
+  for(ms_free_list_node *c = list->root; c != NULL; ) {
+    if((void *)c == addr) {
+      return c;
+    }
+
+    c = (void *)c < addr ? c->right : c->left;
+  }
+
   return NULL;
 }
 
+size_t ms_free_list_grow(ms_free_list *const list, void *const ptr, size_t const size, size_t const new_size) {
+  MS_ASSERT(new_size > size);
+
+  ms_free_list_node *const chunk = find_node_at(list, (uint8_t *)ptr + size);
+  // The split must leave room for the node header of the remaining chunk
+  size_t const extra_size = ms_max(new_size - size, MS_ALIGN_SZ_STATIC(sizeof(ms_free_list_node), MS_DEFAULT_ALIGNMENT));
+
+  if(chunk == NULL || chunk->size < extra_size) {
+    return 0;
+  }
+
+  list->on_before_alloc_from_node(list, chunk, extra_size, list->user);
+
+  return size + malloc_node(list, chunk, extra_size);
+}
+
 void ms_free_list_free(ms_free_list *const list, void * const ptr, size_t const size) {
   ms_free_list_node * node = ptr;
 
+  node->size = size;
+
   if(list->first) {
     ms_free_list_node *const prev = find_prev_node(list, node);
     MS_ASSERT(!prev || (NODE_END(prev) <= (void *)node));
@@ -204,7 +666,15 @@ void ms_free_list_free(ms_free_list *const list, void * const ptr, size_t const
     node = try_coalesce_neighbors(list, node);
   } else {
     // Only chunk of list
-    ms_free_list_create_node(list, node, NULL, NULL, node->size);
+    ms_free_list_create_node(list, node, NULL, NULL, size);
   }
 }
 
+
+void ms_free_list_get_stats(ms_free_list const *const list, ms_memory_stats *const stats) {
+  for(ms_free_list_node const *node = list->first; node != NULL; node = node->next) {
+    stats->free_node_count++;
+    stats->free_size += node->size;
+    stats->largest_free_size = ms_max(stats->largest_free_size, node->size);
+  }
+}
@@ -3,6 +3,7 @@
 #include <moonsugar/log.h>
 #include <moonsugar/util.h>
 #include <moonsugar/memory.h>
+#include <moonsugar/sys.h>
 
 // End pointer of mallocd memory
 #define HEAP_COMMITTED_END(heap) ((void *)((uint8_t *)(heap->base) + (heap)->committed_size))
@@ -11,8 +12,11 @@
 #define DOES_PTR_BELONG(heap, ptr) \
   (ptr > heap->base && (uint8_t *)ptr < ((uint8_t *)heap->base + heap->size))
 
+// Offset of the first chunk of a region, past the region state
+#define REGION_HEADER_SIZE MS_ALIGN_SZ_STATIC(sizeof(ms_heap), MS_CACHE_LINE_SIZE)
+
 static inline void commit(ms_heap *restrict const heap, void *const commit_start, size_t const size) {
-  bool const committed = ms_commit(commit_start, size);
+  bool const committed = ms_commit(commit_start, size, heap->page_flags);
 
   if(committed) {
     heap->committed_size += size;
@@ -25,12 +29,52 @@ static inline void commit(ms_heap *restrict const heap, void *const commit_start
 static inline void decommit(ms_heap *restrict const heap, void *const decommit_start, size_t const size) {
   MS_ASSERT(heap->committed_size >= size);
 
-  ms_decommit(decommit_start, size);
+  ms_decommit(decommit_start, size, heap->page_flags);
   heap->committed_size -= size;
 }
 
 ms_header *ms_heap_get_header(void *const ptr) { return (ms_header *)(ptr)-1; }
 
+size_t ms_heap_get_usable_size(void *const ptr) {
+  ms_header const *const hdr = ms_heap_get_header(ptr);
+
+  return hdr->size - hdr->padding - sizeof(ms_header);
+}
+
+size_t ms_heap_get_block_size(ms_heap *const heap, void *const ptr) {
+  MS_ASSERT(heap);
+  ((void)heap); // Blocks carry their size
+
+  return ms_heap_get_usable_size(ptr);
+}
+
+void * ms_heap_realloc_via(ms_allocator const *const allocator, void *const ptr, size_t const new_count) {
+  if(ptr == NULL) {
+    return ms_malloc(allocator, new_count, MS_DEFAULT_ALIGNMENT);
+  }
+
+  if(new_count == 0) {
+    ms_free(allocator, ptr);
+
+    return NULL;
+  }
+
+  size_t const usable_size = ms_heap_get_usable_size(ptr);
+
+  if(new_count <= usable_size) {
+    return ptr;
+  }
+
+  void *const new_ptr = ms_malloc(allocator, new_count, ms_heap_get_header(ptr)->alignment);
+
+  if(new_ptr) {
+    memcpy(new_ptr, ptr, usable_size);
+    ms_free(allocator, ptr);
+  }
+
+  return new_ptr;
+}
+
 /**
  * Commit chunk memory if necessary.
  *
@@ -48,9 +92,10 @@ static void commit_free_list_node_memory(
 
   // Commit more memory if necessary
   if(chunk_commit_end_ptr > heap_commit_end_ptr) {
-    size_t const unmallocd_sz = (
-      (uint8_t *)chunk_commit_end_ptr
-      - (uint8_t *)heap_commit_end_ptr
+    // Whole commit pages, so that pages are never committed twice
+    size_t const unmallocd_sz = ms_min(
+      ms_align_sz((uint8_t *)chunk_commit_end_ptr - (uint8_t *)heap_commit_end_ptr, heap->commit_page_size),
+      heap->size - heap->committed_size
     );
 
     commit(heap, heap_commit_end_ptr, unmallocd_sz);
@@ -83,11 +128,55 @@ static void on_before_alloc_from_node(
   commit_free_list_node_memory(heap, node, size);
 }
 
-ms_result ms_heap_construct(ms_heap *const heap, uint64_t const size, uint64_t const page_size) {
+/**
+ * Initialise the heap state, with an empty free list.
+ */
+static void init_heap(
+  ms_heap *const heap,
+  void *const base,
+  uint64_t const size,
+  uint64_t const commit_page_size,
+  ms_page_flags const page_flags
+) {
+  *heap = (ms_heap){
+    base,
+    size,
+    commit_page_size,
+    0, // committed_size
+    page_flags,
+    MS_DECOMMIT_POLICY_DEFAULT,
+    (ms_free_list) {
+      NULL, // first
+      NULL, // root
+      heap,
+      on_before_node_create,
+      on_before_alloc_from_node,
+      0, // fl_bitmap
+      {0}, // sl_bitmaps
+      {{NULL}} // bins
+    },
+    { 0, 0, 0, 0 }, // counters
+    0, // growth_size
+    { NULL }, // regions
+    0 // region_count
+  };
+}
+
+ms_result ms_heap_construct(
+  ms_heap *const heap,
+  uint64_t const size,
+  uint64_t const page_size,
+  ms_page_flags const page_flags
+) {
   MS_ASSERT(ms_is_multiple(size, page_size));
   MS_ASSERT(ms_is_power2(page_size));
 
-  void *const base_ptr = ms_reserve(size);
+  ms_sys_info const *const si = ms_get_sys_info();
+  uint64_t const os_page_size = ms_test(page_flags, MS_PAGE_HUGE_BIT) && si->huge_page_size > 0
+    ? si->huge_page_size
+    : si->page_size;
+
+  void *const base_ptr = ms_reserve(size, page_flags);
 
   if(base_ptr == NULL) {
     ms_error("Unable to reserve memory.");
@@ -95,112 +184,512 @@ ms_result ms_heap_construct(ms_heap *const heap, uint64_t const size, uint64_t c
     return MS_RESULT_MEMORY;
   }
 
-  *heap = (ms_heap){
-    base_ptr,
-    size,
-    page_size,
-    0, // committed_size
-    (ms_free_list) {
-      NULL,
-      heap,
-      on_before_node_create,
-      on_before_alloc_from_node
-    }
-  };
+  init_heap(heap, base_ptr, size, ms_max(page_size, os_page_size), page_flags); // The OS commits whole pages
 
   // Create first chunk
-  ms_free_list_node *const chunk = base_ptr;
-  ms_free_list_create_node(&heap->free_list, chunk, NULL, NULL, size);
+  ms_free_list_create_node(&heap->free_list, base_ptr, NULL, NULL, size);
 
   return MS_RESULT_SUCCESS;
 }
 
+ms_result ms_heap_construct_at(
+  ms_heap *const heap,
+  void *const base,
+  uint64_t const size,
+  ms_page_flags const page_flags
+) {
+  bool const is_base_aligned = ms_is_multiple((uintptr_t)base, MS_DEFAULT_ALIGNMENT);
+  MS_ASSERT(is_base_aligned);
+
+  if(!is_base_aligned) {
+    ms_error("Heap base not aligned.");
+    return MS_RESULT_INVALID_ARGUMENT;
+  }
+
+  init_heap(heap, base, size, ms_get_sys_info()->page_size, page_flags);
+
+  // The memory is never committed nor decommitted by the heap
+  heap->committed_size = size;
+  heap->decommit_policy = (ms_decommit_policy) { MS_DECOMMIT_DELAYED, 0 };
+
+  ms_free_list_create_node(&heap->free_list, base, NULL, NULL, size);
+
+  return MS_RESULT_SUCCESS;
+}
+
+void ms_heap_attach(ms_heap *const heap, void *const base) {
+  intptr_t const offset = (uint8_t *)base - (uint8_t *)heap->base;
+
+  // Callbacks and owner are only valid within the process that stored them
+  heap->base = base;
+  heap->free_list.user = heap;
+  heap->free_list.on_before_node_create = on_before_node_create;
+  heap->free_list.on_before_alloc_from_node = on_before_alloc_from_node;
+
+  if(offset != 0) {
+    ms_free_list_relocate(&heap->free_list, offset);
+  }
+}
+
+/**
+ * Reserve a region and add it to the heap index.
+ *
+ * @param count The size of the first allocation the region must host, in bytes.
+ * @param alignment The alignment of the first allocation.
+ * @param out_index The index of the region.
+ *
+ * @return The region or NULL on failure.
+ */
+static ms_heap * add_region(ms_heap *const heap, size_t const count, size_t const alignment, uint32_t *const out_index) {
+  if(heap->region_count == MS_HEAP_MAX_REGIONS) {
+    ms_error("Too many heap regions.");
+    return NULL;
+  }
+
+  // The first node starts past the region header, at any alignment
+  uint64_t const min_size = ms_free_list_get_node_size(count, alignment) + alignment;
+  uint64_t const size = ms_max(
+    ms_align_sz(heap->growth_size, heap->commit_page_size),
+    ms_align_sz(REGION_HEADER_SIZE + min_size, heap->commit_page_size)
+  );
+  uint64_t const header_commit_size = ms_align_sz(REGION_HEADER_SIZE + sizeof(ms_free_list_node), heap->commit_page_size);
+  uint8_t *const base = ms_reserve(size, heap->page_flags);
+
+  if(base == NULL) {
+    ms_error("Unable to reserve memory.");
+    return NULL;
+  }
+
+  if(!ms_commit(base, header_commit_size, heap->page_flags)) {
+    ms_error("Unable to commit memory.");
+    ms_release(base, size, heap->page_flags);
+    return NULL;
+  }
+
+  // The region hosts its own state
+  ms_heap *const region = (ms_heap *)base;
+
+  init_heap(region, base, size, heap->commit_page_size, heap->page_flags);
+  region->committed_size = header_commit_size;
+
+  ms_free_list_create_node(
+    &region->free_list,
+    (ms_free_list_node *)(base + REGION_HEADER_SIZE),
+    NULL,
+    NULL,
+    size - REGION_HEADER_SIZE
+  );
+
+  // Keep the index sorted by address
+  uint32_t i = heap->region_count;
+
+  for(; i > 0 && (uint8_t *)heap->regions[i - 1]->base > base; --i) {
+    heap->regions[i] = heap->regions[i - 1];
+  }
+
+  heap->regions[i] = region;
+  heap->region_count++;
+
+  *out_index = i;
+
+  return region;
+}
+
+/**
+ * Remove a region from the heap index and release it to the OS.
+ */
+static void release_region(ms_heap *const heap, uint32_t const index) {
+  ms_heap *const region = heap->regions[index];
+  void *const base = region->base; // The region state lives in the released memory
+  uint64_t const size = region->size;
+
+  memmove(&heap->regions[index], &heap->regions[index + 1], (heap->region_count - index - 1) * sizeof(ms_heap *));
+  heap->region_count--;
+
+  ms_release(base, size, heap->page_flags);
+}
+
+static bool is_region_empty(ms_heap const *const region) {
+  ms_free_list_node const *const first = region->free_list.first;
+
+  return first != NULL && first->size == region->size - REGION_HEADER_SIZE;
+}
+
+/**
+ * Get the heap or region owning a block.
+ *
+ * @param out_index Set to the index of the owning region, or to the
+ *  region count when the block is owned by the heap itself.
+ *
+ * @return The owner or NULL if the block is not owned by the heap.
+ */
+static ms_heap * get_owner(ms_heap *const heap, void *const ptr, uint32_t *const out_index) {
+  *out_index = heap->region_count;
+
+  if(DOES_PTR_BELONG(heap, ptr)) {
+    return heap;
+  }
+
+  // Binary search the index
+  uint32_t low = 0;
+  uint32_t high = heap->region_count;
+
+  while(low < high) {
+    uint32_t const mid = low + (high - low) / 2;
+    ms_heap *const region = heap->regions[mid];
+
+    if((uint8_t *)ptr <= (uint8_t *)region->base) {
+      high = mid;
+    } else if((uint8_t *)ptr >= (uint8_t *)region->base + region->size) {
+      low = mid + 1;
+    } else {
+      *out_index = mid;
+      return region;
+    }
+  }
+
+  return NULL;
+}
+
 void ms_heap_destroy(ms_heap *const heap) {
-  if(heap->free_list.first->size != heap->size) {
-    ms_warn("Memory leak detected.");
+  bool is_leaking = heap->free_list.first == NULL || heap->free_list.first->size != heap->size;
+
+  for(uint32_t i = 0; i < heap->region_count; ++i) {
+    is_leaking |= !is_region_empty(heap->regions[i]);
+  }
+
+  if(is_leaking) {
+    ms_memory_stats stats;
+    ms_heap_get_stats(heap, &stats);
+
+    ms_warnf("Memory leak detected: %llu bytes still allocated.", (unsigned long long)stats.live_size);
+  }
+
+  while(heap->region_count > 0) {
+    release_region(heap, heap->region_count - 1);
   }
 
-  ms_release(heap->base, heap->size);
+  ms_release(heap->base, heap->size, heap->page_flags);
 
   heap->free_list.first = NULL;
   heap->committed_size = 0;
   heap->base = NULL;
 }
 
+/**
+ * Allocate from the free list of the heap itself or of one of its regions.
+ *
+ * @param heap The heap - its counters are updated.
+ * @param owner The heap or region to allocate from.
+ */
+static void * malloc_from_free_list(ms_heap *const heap, ms_heap *const owner, size_t const count, size_t const alignment) {
+  // Add header
+  size_t chunk_size;
+  // This accounts for max padding + header
+  uint8_t *const unaligned_ptr = ms_free_list_malloc(&owner->free_list, count, alignment, &chunk_size);
+
+  if(unaligned_ptr == NULL) {
+    return NULL;
+  }
+
+  uint8_t *const aligned_min_ptr = unaligned_ptr + sizeof(ms_header); // Assumes 0 padding
+  uint8_t *const aligned_ptr = ms_align_ptr(aligned_min_ptr, alignment);
+  uint32_t const padding = aligned_ptr - aligned_min_ptr;
+  ms_header *const hdr = (ms_header *)aligned_ptr - 1;
+
+  hdr->size = chunk_size;
+  hdr->alignment = alignment;
+  hdr->padding = padding;
+
+  ms_memory_counters_on_malloc(&heap->counters, chunk_size);
+
+  return aligned_ptr;
+}
+
 void * ms_heap_malloc(ms_heap *const heap, size_t const count, size_t alignment) {
   // Minimum alignment requirement
   alignment = ms_max(alignment, MS_DEFAULT_ALIGNMENT);
 
-  if(count > 0) {
-    // Add header
-    size_t chunk_size;
-    // This accounts for max padding + header
-    uint8_t *const unaligned_ptr = ms_free_list_malloc(&heap->free_list, count, alignment, &chunk_size);
+  if(count == 0) {
+    return NULL;
+  }
 
-    if(unaligned_ptr == NULL) {
-      return NULL;
+  void *ptr = malloc_from_free_list(heap, heap, count, alignment);
+
+  for(uint32_t i = 0; ptr == NULL && i < heap->region_count; ++i) {
+    ptr = malloc_from_free_list(heap, heap->regions[i], count, alignment);
+  }
+
+  if(ptr == NULL && heap->growth_size > 0) {
+    uint32_t index;
+    ms_heap *const region = add_region(heap, count, alignment, &index);
+
+    if(region != NULL) {
+      ptr = malloc_from_free_list(heap, region, count, alignment);
+
+      if(ptr == NULL) {
+        release_region(heap, index);
+      }
     }
+  }
 
-    uint8_t *const aligned_min_ptr = unaligned_ptr + sizeof(ms_header); // Assumes 0 padding
-    uint8_t *const aligned_ptr = ms_align_ptr(aligned_min_ptr, alignment);
-    uint32_t const padding = aligned_ptr - aligned_min_ptr;
-    ms_header *const hdr = (ms_header *)aligned_ptr - 1;
+  return ptr;
+}
 
-    hdr->size = chunk_size;
-    hdr->alignment = alignment;
-    hdr->padding = padding;
+/**
+ * Get the free chunk at the end of the heap.
+ *
+ * @return The chunk or NULL if the end of the heap is allocated.
+ */
+static ms_free_list_node * get_trailing_chunk(ms_heap *const heap) {
+  ms_free_list_node *node = heap->free_list.root;
 
-    return aligned_ptr;
+  if(node == NULL) {
+    return NULL;
   }
 
-  return NULL;
+  while(node->right != NULL) {
+    node = node->right;
+  }
+
+  return (uint8_t *)node + node->size == (uint8_t *)heap->base + heap->size ? node : NULL;
 }
 
-void ms_heap_free(ms_heap *const heap, void *const ptr) {
-  if(DOES_PTR_BELONG(heap, ptr)) {
-    ms_header * const head = ms_heap_get_header(ptr);
-    ms_free_list_node *chunk = (ms_free_list_node *)((uint8_t *)head - head->padding);
+/**
+ * Decommit the free memory at the end of the heap, as allowed by a policy.
+ */
+static void decommit_trailing_memory(ms_heap *const heap, ms_decommit_policy const *const policy) {
+  ms_free_list_node *const chunk = get_trailing_chunk(heap);
 
-    ms_free_list_free(&heap->free_list, chunk, head->size);
+  if(chunk == NULL) {
+    return;
+  }
 
-    if(chunk->next == NULL && chunk->size > MS_HEAP_DEALLOC_THR) {
-      uint8_t *const chunk_start = (uint8_t *)chunk;
-      uint8_t *const committed_end = HEAP_COMMITTED_END(heap);
+  uint8_t *const free_start = (uint8_t *)(chunk + 1); // The node stays committed
+  uint8_t *const committed_end = HEAP_COMMITTED_END(heap);
 
-      if(committed_end > chunk_start + MS_HEAP_DEALLOC_THR) {
-        size_t const extra_mallocd_mem = committed_end - chunk_start - MS_HEAP_DEALLOC_THR;
-        void *const dealloc_ptr = chunk_start + MS_HEAP_DEALLOC_THR;
-        decommit(heap, dealloc_ptr, extra_mallocd_mem);
-        heap->committed_size -= extra_mallocd_mem;
-      }
-    }
+  if(committed_end <= free_start) {
+    return;
+  }
+
+  uint64_t const size = ms_decommit_policy_get_size(policy, committed_end - free_start);
+
+  // Keep the committed end on a commit page boundary
+  uint8_t *const dealloc_ptr = ms_align_ptr(committed_end - size, heap->commit_page_size);
+
+  if(committed_end > dealloc_ptr) {
+    decommit(heap, dealloc_ptr, committed_end - dealloc_ptr);
+  }
+}
+
+/**
+ * Return a block to the free list of its owner, without decommitting.
+ *
+ * @param heap The heap - its counters are updated.
+ * @param owner The heap or region owning the block.
+ */
+static void release_block(ms_heap *const heap, ms_heap *const owner, void *const ptr) {
+  ms_header * const head = ms_heap_get_header(ptr);
+  ms_free_list_node *chunk = (ms_free_list_node *)((uint8_t *)head - head->padding);
+
+  ms_memory_counters_on_free(&heap->counters, head->size);
+  ms_free_list_free(&owner->free_list, chunk, head->size);
+}
+
+/**
+ * Return the memory of a region to the OS after a block was freed to it.
+ */
+static void on_region_block_released(ms_heap *const heap, uint32_t const index) {
+  ms_heap *const region = heap->regions[index];
+
+  if(is_region_empty(region)) {
+    release_region(heap, index);
   } else {
+    decommit_trailing_memory(region, &heap->decommit_policy);
+  }
+}
+
+void ms_heap_free(ms_heap *const heap, void *const ptr) {
+  uint32_t index;
+  ms_heap *const owner = get_owner(heap, ptr, &index);
+
+  if(owner == NULL) {
     if(ptr != NULL) {
       ms_error("Attempting to free pointer not mallocd via this heap.");
     }
+
+    return;
+  }
+
+  release_block(heap, owner, ptr);
+
+  if(owner == heap) {
+    decommit_trailing_memory(heap, &heap->decommit_policy);
+  } else {
+    on_region_block_released(heap, index);
+  }
+}
+
+void ms_heap_free_n(ms_heap *const heap, void *const *const ptrs, size_t const ptr_count) {
+  bool is_any_released = false;
+
+  for(size_t i = 0; i < ptr_count; ++i) {
+    if(ptrs[i] == NULL) {
+      continue;
+    }
+
+    uint32_t index;
+    ms_heap *const owner = get_owner(heap, ptrs[i], &index);
+
+    if(owner == NULL) {
+      ms_error("Attempting to free pointer not mallocd via this heap.");
+    } else if(owner == heap) {
+      release_block(heap, heap, ptrs[i]);
+      is_any_released = true;
+    } else {
+      release_block(heap, owner, ptrs[i]);
+      on_region_block_released(heap, index);
+    }
+  }
+
+  // Blocks freed at the end of the heap coalesce before a single decommit
+  if(is_any_released) {
+    decommit_trailing_memory(heap, &heap->decommit_policy);
+  }
+}
+
+void ms_heap_purge(ms_heap *const heap) {
+  ms_decommit_policy const policy = { MS_DECOMMIT_IMMEDIATE, 0 };
+
+  decommit_trailing_memory(heap, &policy);
+
+  for(uint32_t i = 0; i < heap->region_count; ++i) {
+    decommit_trailing_memory(heap->regions[i], &policy);
+  }
+}
+
+/**
+ * Reset the whole commit pages within the free chunks of a heap or region.
+ *
+ * @return The size of the memory reset, in bytes.
+ */
+static uint64_t reset_free_memory(ms_heap *const heap) {
+  uint8_t *const committed_end = HEAP_COMMITTED_END(heap);
+  uint64_t reset_size = 0;
+
+  for(ms_free_list_node *node = heap->free_list.first; node != NULL; node = node->next) {
+    uint8_t *const node_end = (uint8_t *)node + node->size;
+    uint8_t *const start = ms_align_ptr((uint8_t *)(node + 1), heap->commit_page_size); // The node stays intact
+    uint8_t *const end = ms_align_back_ptr(node_end < committed_end ? node_end : committed_end, heap->commit_page_size);
+
+    if(end > start) {
+      ms_reset(start, end - start, heap->page_flags);
+      reset_size += end - start;
+    }
+  }
+
+  return reset_size;
+}
+
+uint64_t ms_heap_trim(ms_heap *const heap) {
+  ms_heap_purge(heap);
+
+  uint64_t reset_size = reset_free_memory(heap);
+
+  for(uint32_t i = 0; i < heap->region_count; ++i) {
+    reset_size += reset_free_memory(heap->regions[i]);
   }
+
+  return reset_size;
+}
+
+bool ms_heap_owns(ms_heap *const heap, void *const ptr) {
+  uint32_t index;
+
+  return get_owner(heap, ptr, &index) != NULL;
 }
 
-bool ms_heap_owns(ms_heap *const heap, void *const ptr) { return DOES_PTR_BELONG(heap, ptr); }
+void ms_heap_get_stats(ms_heap const *const heap, ms_memory_stats *const out_stats) {
+  *out_stats = (ms_memory_stats) {
+    heap->size, // reserved_size
+    heap->committed_size,
+    0, // live_size
+    heap->counters.peak_live_size,
+    heap->counters.alloc_count,
+    heap->counters.free_count,
+    0, // free_node_count
+    0, // free_size
+    0, // largest_free_size
+    0.0 // fragmentation
+  };
+
+  ms_free_list_get_stats(&heap->free_list, out_stats);
+
+  for(uint32_t i = 0; i < heap->region_count; ++i) {
+    ms_heap const *const region = heap->regions[i];
+
+    out_stats->reserved_size += region->size;
+    out_stats->committed_size += region->committed_size;
 
-static void * realloc_from_free_list(ms_heap *const heap, void *restrict const ptr, size_t const new_count) {
+    ms_free_list_get_stats(&region->free_list, out_stats);
+  }
+
+  // The region state is not live memory
+  out_stats->live_size = out_stats->reserved_size - heap->region_count * REGION_HEADER_SIZE - out_stats->free_size;
+  out_stats->fragmentation = ms_memory_stats_get_fragmentation(out_stats);
+}
+
+/**
+ * Compute the chunk size needed to host an allocation in place.
+ */
+static size_t compute_in_place_chunk_size(ms_header const *const hdr, size_t const count) {
+  // Chunks must be able to host a node once freed
+  return ms_max(
+    ms_align_sz(hdr->padding + sizeof(ms_header) + count, MS_DEFAULT_ALIGNMENT),
+    MS_ALIGN_SZ_STATIC(sizeof(ms_free_list_node), MS_DEFAULT_ALIGNMENT)
+  );
+}
+
+/**
+ * Reallocate a block in place within its owner, relocating it within the heap otherwise.
+ */
+static void * realloc_from_free_list(ms_heap *const heap, ms_heap *const owner, void *restrict const ptr, size_t const new_count) {
   ms_header *const hdr = ms_heap_get_header(ptr);
+  uint8_t *const chunk = (uint8_t *)hdr - hdr->padding;
   size_t const available_size = hdr->size - hdr->padding - sizeof(ms_header);
+  size_t const new_chunk_size = compute_in_place_chunk_size(hdr, new_count);
 
   if(new_count > available_size) { // Not enough room for expansion
+    // Grow into the free chunk that follows, if any
+    size_t const grown_chunk_size = ms_free_list_grow(&owner->free_list, chunk, hdr->size, new_chunk_size);
+
+    if(grown_chunk_size > 0) {
+      ms_memory_counters_on_resize(&heap->counters, hdr->size, grown_chunk_size);
+      hdr->size = grown_chunk_size;
+
+      return ptr;
+    }
+
     void *const new_ptr = ms_heap_malloc(heap, new_count, hdr->alignment);
 
-    // Copy the old data and free the existing allocation
+    // Copy the old data and free the existing allocation - the block is left untouched on failure
     if(new_ptr) {
       memcpy(new_ptr, ptr, available_size);
       ms_heap_free(heap, ptr);
-
-      return new_ptr;
-    } else {
-      ms_fatal("Unable to relocate memory.");
     }
+
+    return new_ptr;
   } else {
     MS_ASSERT(new_count > 0);
+
+    // Return the tail to the free list
+    if(hdr->size - new_chunk_size >= MS_ALIGN_SZ_STATIC(sizeof(ms_free_list_node), MS_DEFAULT_ALIGNMENT)) {
+      ms_free_list_free(&owner->free_list, chunk + new_chunk_size, hdr->size - new_chunk_size);
+      ms_memory_counters_on_resize(&heap->counters, hdr->size, new_chunk_size);
+      hdr->size = new_chunk_size;
+
+      decommit_trailing_memory(owner, &heap->decommit_policy);
+    }
   }
 
   return ptr;
@@ -209,8 +698,11 @@ static void * realloc_from_free_list(ms_heap *const heap, void *restrict const p
 void *ms_heap_realloc(ms_heap *const heap, void *const ptr, size_t const new_count) {
   if(ptr) {
     if(new_count > 0) {
-      if(DOES_PTR_BELONG(heap, ptr)) {
-        return realloc_from_free_list(heap, ptr, new_count);
+      uint32_t index;
+      ms_heap *const owner = get_owner(heap, ptr, &index);
+
+      if(owner != NULL) {
+        return realloc_from_free_list(heap, owner, ptr, new_count);
       } else {
         ms_fatalf("Attempting to reallocate a pointer (%p) not allocated via this heap.", ptr);
       }
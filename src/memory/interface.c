@@ -12,3 +12,46 @@ void ms_free(ms_allocator const * const allocator, void * const ptr) {
   allocator->deallocate(allocator->user, ptr);
 }
 
+
+void ms_free_sized(ms_allocator const * const allocator, void * const ptr, size_t const size) {
+  if(allocator->deallocate_sized != NULL) {
+    allocator->deallocate_sized(allocator->user, ptr, size);
+  } else {
+    allocator->deallocate(allocator->user, ptr);
+  }
+}
+
+size_t ms_malloc_n(
+  ms_allocator const * const allocator,
+  size_t const size,
+  size_t const alignment,
+  void ** const ptrs,
+  size_t const ptr_count
+) {
+  if(allocator->allocate_n != NULL) {
+    return allocator->allocate_n(allocator->user, size, alignment, ptrs, ptr_count);
+  }
+
+  for(size_t i = 0; i < ptr_count; ++i) {
+    ptrs[i] = allocator->allocate(allocator->user, size, alignment);
+
+    if(ptrs[i] == NULL) {
+      return i;
+    }
+  }
+
+  return ptr_count;
+}
+
+void ms_free_n(ms_allocator const * const allocator, void * const * const ptrs, size_t const ptr_count) {
+  if(allocator->deallocate_n != NULL) {
+    allocator->deallocate_n(allocator->user, ptrs, ptr_count);
+    return;
+  }
+
+  for(size_t i = 0; i < ptr_count; ++i) {
+    if(ptrs[i] != NULL) {
+      allocator->deallocate(allocator->user, ptrs[i]);
+    }
+  }
+}
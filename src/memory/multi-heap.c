@@ -0,0 +1,204 @@
+#include <memory.h>
+#include <moonsugar/assert.h>
+#include <moonsugar/log.h>
+#include <moonsugar/sys.h>
+#include <moonsugar/util.h>
+#include <moonsugar/thread-heap.h>
+
+static MS_ATOMIC(uint32_t) last_thread_index;
+static MS_THREAD_LOCAL uint32_t thread_index; // 0 = not assigned yet
+
+/**
+ * Get the index of the arena the calling thread is bound to.
+ *
+ * Threads are assigned round-robin on first use.
+ */
+static uint32_t get_home_index(ms_mheap const *const mheap) {
+  if(thread_index == 0) {
+    thread_index = ms_atomic_add_fetch(&last_thread_index, 1, MS_MEMORY_ORDER_RELAXED);
+  }
+
+  return (thread_index - 1) % mheap->arena_count;
+}
+
+/**
+ * Get the index of the arena owning a block.
+ *
+ * @return The arena index or `arena_count` if the block is not owned by the heap.
+ */
+static uint32_t get_owner_index(ms_mheap const *const mheap, void *const ptr, uint32_t const home_index) {
+  if(ms_heap_owns(&mheap->arenas[home_index].heap, ptr)) {
+    return home_index;
+  }
+
+  for(uint32_t i = 0; i < mheap->arena_count; ++i) {
+    if(ms_heap_owns(&mheap->arenas[i].heap, ptr)) {
+      return i;
+    }
+  }
+
+  return mheap->arena_count;
+}
+
+/**
+ * Free the blocks deferred by other threads - the arena lock must be held.
+ */
+static void release_remote_frees(ms_mheap_arena *const arena) {
+  ms_mheap_remote_block *b = ms_atomic_exchange(&arena->remote_frees, NULL, MS_MEMORY_ORDER_ACQUIRE);
+
+  while(b != NULL) {
+    ms_mheap_remote_block *const next = b->next;
+
+    ms_heap_free(&arena->heap, b);
+    b = next;
+  }
+}
+
+ms_result ms_mheap_construct(ms_mheap *const mheap, ms_mheap_description const *const description) {
+  MS_ASSERT(mheap);
+  MS_ASSERT(description);
+
+  uint32_t const arena_count = description->arena_count > 0
+    ? description->arena_count
+    : ms_max(ms_get_sys_info()->proc_count, 1u);
+
+  *mheap = (ms_mheap) {
+    description->allocator,
+    ms_malloc(&description->allocator, sizeof(ms_mheap_arena) * arena_count, MS_CACHE_LINE_SIZE),
+    0 // arena_count - counts the constructed arenas
+  };
+
+  if(mheap->arenas == NULL) {
+    return MS_RESULT_MEMORY;
+  }
+
+  for(uint32_t i = 0; i < arena_count; ++i) {
+    ms_mheap_arena *const arena = &mheap->arenas[i];
+
+    ms_result const result = ms_heap_construct(&arena->heap, description->arena_size, description->page_size, description->page_flags);
+
+    if(result != MS_RESULT_SUCCESS) {
+      ms_mheap_destroy(mheap);
+      return result;
+    }
+
+    ms_mutex_construct(&arena->lock);
+    ms_atomic_store(&arena->remote_frees, NULL, MS_MEMORY_ORDER_RELAXED);
+
+    mheap->arena_count++;
+  }
+
+  return MS_RESULT_SUCCESS;
+}
+
+void ms_mheap_destroy(ms_mheap *const mheap) {
+  MS_ASSERT(mheap);
+
+  for(uint32_t i = 0; i < mheap->arena_count; ++i) {
+    ms_mheap_arena *const arena = &mheap->arenas[i];
+
+    release_remote_frees(arena);
+    ms_mutex_destroy(&arena->lock);
+    ms_heap_destroy(&arena->heap);
+  }
+
+  ms_free(&mheap->allocator, mheap->arenas);
+
+  mheap->arenas = NULL;
+  mheap->arena_count = 0;
+}
+
+void * ms_mheap_malloc(ms_mheap *const mheap, size_t const count, size_t const alignment) {
+  MS_ASSERT(mheap);
+
+  if(count == 0) {
+    return NULL;
+  }
+
+  uint32_t const home_index = get_home_index(mheap);
+
+  // Fall back to the other arenas when the home arena is exhausted
+  for(uint32_t i = 0; i < mheap->arena_count; ++i) {
+    ms_mheap_arena *const arena = &mheap->arenas[(home_index + i) % mheap->arena_count];
+
+    ms_mutex_lock(&arena->lock);
+
+    release_remote_frees(arena);
+    void *const ptr = ms_heap_malloc(&arena->heap, count, alignment);
+
+    ms_mutex_unlock(&arena->lock);
+
+    if(ptr != NULL) {
+      return ptr;
+    }
+  }
+
+  return NULL;
+}
+
+void ms_mheap_free(ms_mheap *const mheap, void *const ptr) {
+  MS_ASSERT(mheap);
+
+  if(ptr == NULL) {
+    return;
+  }
+
+  uint32_t const home_index = get_home_index(mheap);
+  uint32_t const owner_index = get_owner_index(mheap, ptr, home_index);
+
+  if(owner_index == mheap->arena_count) {
+    ms_error("Attempting to free pointer not mallocd via this heap.");
+    return;
+  }
+
+  ms_mheap_arena *const arena = &mheap->arenas[owner_index];
+
+  if(owner_index == home_index) {
+    ms_mutex_lock(&arena->lock);
+    ms_heap_free(&arena->heap, ptr);
+    ms_mutex_unlock(&arena->lock);
+
+    return;
+  }
+
+  // Defer to the owning arena instead of contending for its lock
+  ms_mheap_remote_block *const b = ptr;
+
+  b->next = ms_atomic_load(&arena->remote_frees, MS_MEMORY_ORDER_RELAXED);
+
+  while(
+    !ms_atomic_compare_exchange_weak(
+      &arena->remote_frees,
+      &b->next,
+      b,
+      MS_MEMORY_ORDER_RELEASE,
+      MS_MEMORY_ORDER_RELAXED
+    )
+  ) {}
+}
+
+void * ms_mheap_realloc(ms_mheap *const mheap, void *const ptr, size_t const new_count) {
+  MS_ASSERT(mheap);
+
+  return ms_heap_realloc_via(&MS_ALLOCATOR_DEF_MHEAP(*mheap), ptr, new_count);
+}
+
+uint64_t ms_mheap_trim(ms_mheap *const mheap) {
+  MS_ASSERT(mheap);
+
+  uint64_t reset_size = 0;
+
+  // Only one arena is blocked at a time
+  for(uint32_t i = 0; i < mheap->arena_count; ++i) {
+    ms_mheap_arena *const arena = &mheap->arenas[i];
+
+    ms_mutex_lock(&arena->lock);
+
+    release_remote_frees(arena);
+    reset_size += ms_heap_trim(&arena->heap);
+
+    ms_mutex_unlock(&arena->lock);
+  }
+
+  return reset_size;
+}
@@ -1,11 +1,189 @@
 #include <sys/mman.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+
+#ifdef __linux__
+  #include <sys/syscall.h>
+#endif // __linux__
+
 #include <moonsugar/memory.h>
 #include <moonsugar/util.h>
 #include <moonsugar/assert.h>
 #include <moonsugar/sys.h>
 
-void* ms_reserve(size_t count) {
-  count = ms_align_sz(count, ms_get_sys_info()->page_size);
+/**
+ * Get the size of the pages backing memory allocated with the given flags.
+ */
+static uint64_t get_page_size(ms_page_flags const flags) {
+  ms_sys_info const *const si = ms_get_sys_info();
+
+  if(ms_test(flags, MS_PAGE_HUGE_BIT) && si->huge_page_size > 0) {
+    return si->huge_page_size;
+  }
+
+  return si->page_size;
+}
+
+#ifdef __linux__
+// Memory policies, as in linux/mempolicy.h - libnuma is not required
+#define NUMA_MPOL_DEFAULT (0)
+#define NUMA_MPOL_PREFERRED (1)
+#define NUMA_MPOL_BIND (2)
+#define NUMA_MPOL_INTERLEAVE (3)
+#define NUMA_MPOL_MF_MOVE (1u << 1)
+#define NUMA_MAX_NODE (sizeof(uint64_t) * 8 + 1) // The kernel reads one bit less than the given count
+
+/**
+ * Get the memory policy requested by the given flags.
+ *
+ * @param flags The page flags.
+ * @param out_mode The policy mode.
+ * @param out_node_mask The policy node mask.
+ *
+ * @return False if no policy must be applied.
+ */
+static bool get_numa_policy(ms_page_flags const flags, int *const out_mode, uint64_t *const out_node_mask) {
+  ms_sys_info const *const si = ms_get_sys_info();
+  uint32_t const node = MS_PAGE_GET_NUMA_NODE(flags);
+  uint64_t const node_mask = node < 64 ? (1ull << node) & si->numa_node_mask : 0;
+
+  if(si->numa_node_count <= 1) {
+    return false;
+  }
+
+  if(ms_test(flags, MS_PAGE_NUMA_INTERLEAVE_BIT)) {
+    *out_mode = NUMA_MPOL_INTERLEAVE;
+    *out_node_mask = si->numa_node_mask;
+  } else if(ms_test(flags, MS_PAGE_NUMA_BIND_BIT) && node_mask != 0) {
+    *out_mode = NUMA_MPOL_BIND;
+    *out_node_mask = node_mask;
+  } else if(ms_test(flags, MS_PAGE_NUMA_PREFERRED_BIT) && node_mask != 0) {
+    *out_mode = NUMA_MPOL_PREFERRED;
+    *out_node_mask = node_mask;
+  } else {
+    return false;
+  }
+
+  return true;
+}
+#endif // __linux__
+
+/**
+ * Apply the NUMA policy of the given flags to a range.
+ *
+ * Failures are ignored, so that memory remains usable where
+ * memory policies are not permitted. Pages already faulted in
+ * are migrated only if `move` is true.
+ */
+static void apply_numa_policy(void * const ptr, size_t const count, ms_page_flags const flags, bool const move) {
+#ifdef __linux__
+  int mode;
+  uint64_t node_mask;
+
+  if(ptr != NULL && get_numa_policy(flags, &mode, &node_mask)) {
+    syscall(SYS_mbind, ptr, count, mode, &node_mask, NUMA_MAX_NODE, move ? NUMA_MPOL_MF_MOVE : 0u);
+  }
+#else
+  ((void)ptr);
+  ((void)count);
+  ((void)flags);
+  ((void)move);
+#endif // __linux__
+}
+
+/**
+ * Get the mmap flags requesting explicit huge pages.
+ */
+static int get_huge_map_flags(ms_page_flags const flags) {
+#ifdef MAP_HUGETLB
+  if(get_page_size(flags) != ms_get_sys_info()->page_size) {
+    return MAP_HUGETLB;
+  }
+#else
+  ((void)flags);
+#endif // MAP_HUGETLB
+
+  return 0;
+}
+
+/**
+ * Ask for transparent huge pages, used when explicit huge pages are unavailable.
+ */
+static void advise_huge_pages(void * const ptr, size_t const count, ms_page_flags const flags) {
+#ifdef MADV_HUGEPAGE
+  if(get_page_size(flags) != ms_get_sys_info()->page_size) {
+    madvise(ptr, count, MADV_HUGEPAGE);
+  }
+#else
+  ((void)ptr);
+  ((void)count);
+  ((void)flags);
+#endif // MADV_HUGEPAGE
+}
+
+/**
+ * Reserve a range aligned to the huge page size, so that it can be
+ * backed by transparent huge pages.
+ */
+static void* reserve_aligned(size_t const count, uint64_t const page_size) {
+  uint8_t * const result = mmap(
+    NULL, // addr
+    count + page_size, // length
+    PROT_NONE, // prot
+    MAP_PRIVATE | MAP_ANONYMOUS, // flags
+    -1, // fd
+    0 // offset
+  );
+
+  if(result == MAP_FAILED) {
+    return NULL;
+  }
+
+  uint8_t * const aligned_result = ms_align_ptr(result, page_size);
+  uint8_t * const aligned_end = aligned_result + count;
+
+  // Trim the unaligned head and tail
+  if(aligned_result > result) {
+    munmap(result, aligned_result - result);
+  }
+
+  if(result + count + page_size > aligned_end) {
+    munmap(aligned_end, result + count + page_size - aligned_end);
+  }
+
+  return aligned_result;
+}
+
+/**
+ * Reserve a range backed by pages of the given size.
+ */
+static void* reserve(size_t const count, ms_page_flags const flags, uint64_t const page_size) {
+  if(page_size != ms_get_sys_info()->page_size) {
+    // Explicit huge pages, reserved up front - fails if the pool cannot back the whole range
+    void * const result = mmap(
+      NULL, // addr
+      count, // length
+      PROT_NONE, // prot
+      MAP_PRIVATE | MAP_ANONYMOUS | get_huge_map_flags(flags), // flags
+      -1, // fd
+      0 // offset
+    );
+
+    if(result != MAP_FAILED) {
+      return result;
+    }
+
+    void * const aligned_result = reserve_aligned(count, page_size);
+
+    if(aligned_result != NULL) {
+      advise_huge_pages(aligned_result, count, flags);
+    }
+
+    return aligned_result;
+  }
 
   void * const result = mmap(
     NULL, // addr
@@ -16,13 +194,23 @@ void* ms_reserve(size_t count) {
     0 // offset
   );
 
-   MS_ASSERT(result != MAP_FAILED);
+  return result != MAP_FAILED ? result : NULL;
+}
+
+void* ms_reserve(size_t count, ms_page_flags const flags) {
+  uint64_t const page_size = get_page_size(flags);
 
-   return result;
+  count = ms_align_sz(count, page_size);
+
+  // Pages follow the policy of their range when first touched
+  void * const result = reserve(count, flags, page_size);
+  apply_numa_policy(result, count, flags, false);
+
+  return result;
 }
 
-void ms_release(void * ptr, size_t count) {
-  uint64_t const page_size = ms_get_sys_info()->page_size;
+void ms_release(void * ptr, size_t count, ms_page_flags const flags) {
+  uint64_t const page_size = get_page_size(flags);
   uint8_t* const ptr_end = ms_align_ptr((uint8_t*)ptr + count, page_size);
 
   ptr = ms_align_back_ptr(ptr, page_size);
@@ -31,68 +219,162 @@ void ms_release(void * ptr, size_t count) {
   munmap(ptr, count);
 }
 
-bool ms_commit(void * ptr, size_t count) {
-  uint64_t const page_size = ms_get_sys_info()->page_size;
+bool ms_commit(void * ptr, size_t count, ms_page_flags const flags) {
+  uint64_t const page_size = get_page_size(flags);
   uint8_t* const ptr_end = ms_align_ptr((uint8_t*)ptr + count, page_size);
 
   ptr = ms_align_back_ptr(ptr, page_size);
   count = ptr_end - (uint8_t*)ptr;
 
-#ifdef HAS_REMAP
-  // TODO: Implement this correctly - good luck
-  void * const result = mremap(
-    ptr, // addr
-    count, // length
-    PROT_READ | PROT_WRITE, // prot
-    MAP_PRIVATE | MAP_ANONYMOUS, // flags
-    -1, // fd
-    0 // offset
-  );
-#else
-  munmap(ptr, count);
+  // Pages are faulted in on first access - committing twice is harmless
+  return mprotect(ptr, count, PROT_READ | PROT_WRITE) == 0;
+}
 
-  void * const result = mmap(
-    ptr, // addr
-    count, // length
-    PROT_READ | PROT_WRITE, // prot
-    MAP_PRIVATE | MAP_ANONYMOUS, // flags
-    -1, // fd
-    0 // offset
-  );
-#endif // HAS_REMAP
+void ms_decommit(void * ptr, size_t count, ms_page_flags const flags) {
+  uint64_t const page_size = get_page_size(flags);
+  uint8_t* const ptr_end = ms_align_back_ptr((uint8_t*)ptr + count, page_size);
+
+  // Only whole pages within the range are decommitted
+  ptr = ms_align_ptr(ptr, page_size);
+
+  if(ptr_end <= (uint8_t*)ptr) {
+    return;
+  }
+
+  count = ptr_end - (uint8_t*)ptr;
+
+  ms_reset(ptr, count, flags);
 
-  return result != MAP_FAILED;
+  int const result MSUNUSED = mprotect(ptr, count, PROT_NONE);
+  MS_ASSERT(result == 0);
 }
 
-void ms_decommit(void * ptr, size_t count) {
-  uint64_t const page_size = ms_get_sys_info()->page_size;
-  uint8_t* const ptr_end = ms_align_ptr((uint8_t*)ptr + count, page_size);
+void ms_reset(void * ptr, size_t count, ms_page_flags const flags) {
+  uint64_t const page_size = get_page_size(flags);
+  uint8_t* const ptr_end = ms_align_back_ptr((uint8_t*)ptr + count, page_size);
+
+  // Only whole pages within the range are reset
+  ptr = ms_align_ptr(ptr, page_size);
+
+  if(ptr_end <= (uint8_t*)ptr) {
+    return;
+  }
 
-  ptr = ms_align_back_ptr(ptr, page_size);
   count = ptr_end - (uint8_t*)ptr;
 
-#ifdef HAS_REMAP
-  // TODO: Implement this correctly - good luck
-  void * const result = mremap(
-    ptr, // addr
-    count, // length
-    PROT_NONE, // prot
-    MAP_PRIVATE | MAP_ANONYMOUS, // flags
-    -1, // fd
-    0 // offset
-  );
+#ifdef MADV_FREE
+  // Pages are reclaimed lazily - not supported by explicit huge pages
+  int const advice_result = madvise(ptr, count, MADV_FREE);
 #else
-  munmap(ptr, count);
+  int const advice_result = -1;
+#endif // MADV_FREE
 
-  void * const result = mmap(
-    ptr, // addr
-    count, // length
-    PROT_NONE, // prot
-    MAP_PRIVATE | MAP_ANONYMOUS, // flags
-    -1, // fd
-    0 // offset
-  );
-#endif // HAS_REMAP
+  if(advice_result != 0) {
+    madvise(ptr, count, MADV_DONTNEED);
+  }
+}
+
+void ms_place(void * ptr, size_t count, ms_page_flags const flags) {
+  uint64_t const page_size = get_page_size(flags);
+  uint8_t* const ptr_end = ms_align_back_ptr((uint8_t*)ptr + count, page_size);
+
+  // Only whole pages within the range are placed
+  ptr = ms_align_ptr(ptr, page_size);
+
+  if(ptr_end > (uint8_t*)ptr) {
+    apply_numa_policy(ptr, ptr_end - (uint8_t*)ptr, flags, true);
+  }
+}
+
+bool ms_set_thread_numa_policy(ms_page_flags const flags) {
+#ifdef __linux__
+  int mode = NUMA_MPOL_DEFAULT;
+  uint64_t node_mask = 0;
+
+  if(!get_numa_policy(flags, &mode, &node_mask) && ms_get_sys_info()->numa_node_count <= 1) {
+    return true;
+  }
+
+  return syscall(SYS_set_mempolicy, mode, mode != NUMA_MPOL_DEFAULT ? &node_mask : NULL, NUMA_MAX_NODE) == 0;
+#else
+  ((void)flags);
+
+  return true;
+#endif // __linux__
+}
+
+ms_result ms_map_file(
+  char const * const path,
+  uint64_t const size,
+  void * const base_hint,
+  ms_file_mapping * const out_mapping
+) {
+  MS_ASSERT(path);
+  MS_ASSERT(out_mapping);
+
+  int const fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+
+  if(fd < 0) {
+    return errno == ENOENT ? MS_RESULT_NOT_FOUND : MS_RESULT_ACCESS;
+  }
+
+  struct stat st;
+  ms_result result = MS_RESULT_SUCCESS;
+
+  if(fstat(fd, &st) != 0) {
+    result = MS_RESULT_ACCESS;
+  } else if(st.st_size == 0) {
+    // New or empty file - extended sparsely
+    if(size == 0) {
+      result = MS_RESULT_INVALID_ARGUMENT;
+    } else if(ftruncate(fd, (off_t)size) != 0) {
+      result = MS_RESULT_MEMORY;
+    } else {
+      st.st_size = (off_t)size;
+    }
+  }
+
+  if(result == MS_RESULT_SUCCESS) {
+    void * const base = mmap(base_hint, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+
+    if(base != MAP_FAILED) {
+      *out_mapping = (ms_file_mapping) {
+        base,
+        st.st_size, // size
+        fd, // file
+        0 // mapping
+      };
+
+      return MS_RESULT_SUCCESS;
+    }
+
+    result = MS_RESULT_MEMORY;
+  }
+
+  close(fd);
+
+  return result;
+}
+
+void ms_unmap_file(ms_file_mapping * const mapping) {
+  MS_ASSERT(mapping);
+
+  munmap(mapping->base, mapping->size);
+  close((int)mapping->file);
+
+  mapping->base = NULL;
+  mapping->size = 0;
+}
+
+bool ms_sync_file(ms_file_mapping const * const mapping) {
+  MS_ASSERT(mapping);
+
+  return msync(mapping->base, mapping->size, MS_SYNC) == 0;
+}
+
+bool ms_lock_file(ms_file_mapping const * const mapping) {
+  MS_ASSERT(mapping);
 
-  MS_ASSERT(result != MAP_FAILED);
+  // Advisory lock, owned by the open file and so released when closed, even by a crashed process
+  return flock((int)mapping->file, LOCK_EX | LOCK_NB) == 0;
 }
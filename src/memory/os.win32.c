@@ -3,18 +3,50 @@
 #include <moonsugar/memory.h>
 #include <moonsugar/sys.h>
 
-void* ms_reserve(size_t count) {
+// Large pages must be committed on reservation and require the
+// SeLockMemoryPrivilege, so MS_PAGE_HUGE_BIT is ignored.
+//
+// NUMA placement is requested per allocation, so only the preferred
+// node is honored - binding falls back to preferring the node and
+// interleaving is left to the system.
+
+/**
+ * Get the preferred NUMA node of the given flags.
+ *
+ * @return The node, or NUMA_NO_PREFERRED_NODE.
+ */
+static DWORD get_numa_node(ms_page_flags const flags) {
+  ms_sys_info const *const si = ms_get_sys_info();
+  uint32_t const node = MS_PAGE_GET_NUMA_NODE(flags);
+
+  if(
+    si->numa_node_count <= 1
+    || !(flags & (MS_PAGE_NUMA_PREFERRED_BIT | MS_PAGE_NUMA_BIND_BIT))
+    || node >= 64
+    || !(si->numa_node_mask & (1ull << node))
+  ) {
+    return NUMA_NO_PREFERRED_NODE;
+  }
+
+  return node;
+}
+
+void* ms_reserve(size_t count, ms_page_flags const flags) {
   count = ms_align_sz(count, ms_get_sys_info()->page_size);
 
-  return VirtualAlloc(
+  return VirtualAllocExNuma(
+    GetCurrentProcess(),
     NULL,
     count,
     MEM_RESERVE,
-    PAGE_READWRITE
+    PAGE_READWRITE,
+    get_numa_node(flags)
   );
 }
 
-void ms_release(void * ptr, size_t count) {
+void ms_release(void * ptr, size_t count, ms_page_flags const flags) {
+  ((void)flags);
+
   uint64_t const page_size = ms_get_sys_info()->page_size;
   uint8_t* const ptr_end = ms_align_ptr((uint8_t*)ptr + count, page_size);
 
@@ -24,21 +56,159 @@ void ms_release(void * ptr, size_t count) {
   VirtualFree(ptr, (SIZE_T)count, MEM_RELEASE);
 }
 
-bool ms_commit(void * ptr, size_t count) {
-  return VirtualAlloc(
+bool ms_commit(void * ptr, size_t count, ms_page_flags const flags) {
+  return VirtualAllocExNuma(
+    GetCurrentProcess(),
     ptr,
     count,
     MEM_COMMIT,
-    PAGE_READWRITE
+    PAGE_READWRITE,
+    get_numa_node(flags)
   ) != NULL;
 }
 
-void ms_decommit(void * ptr, size_t count) {
+void ms_decommit(void * ptr, size_t count, ms_page_flags const flags) {
+  ((void)flags);
+
   uint64_t const page_size = ms_get_sys_info()->page_size;
-  uint8_t* const ptr_end = ms_align_ptr((uint8_t*)ptr + count, page_size);
+  uint8_t* const ptr_end = ms_align_back_ptr((uint8_t*)ptr + count, page_size);
+
+  // Only whole pages within the range are decommitted
+  ptr = ms_align_ptr(ptr, page_size);
+
+  if(ptr_end <= (uint8_t*)ptr) {
+    return;
+  }
 
-  ptr = ms_align_back_ptr(ptr, page_size);
   count = ptr_end - (uint8_t*)ptr;
 
   VirtualFree(ptr, count, MEM_DECOMMIT);
 }
+
+void ms_reset(void * ptr, size_t count, ms_page_flags const flags) {
+  ((void)flags);
+
+  uint64_t const page_size = ms_get_sys_info()->page_size;
+  uint8_t* const ptr_end = ms_align_back_ptr((uint8_t*)ptr + count, page_size);
+
+  // Only whole pages within the range are reset
+  ptr = ms_align_ptr(ptr, page_size);
+
+  if(ptr_end <= (uint8_t*)ptr) {
+    return;
+  }
+
+  count = ptr_end - (uint8_t*)ptr;
+
+  // The pages stay committed but are not written to the page file, and leave the working set
+  VirtualAlloc(ptr, count, MEM_RESET, PAGE_READWRITE);
+  VirtualUnlock(ptr, count);
+}
+
+void ms_place(void * ptr, size_t count, ms_page_flags const flags) {
+  // Committed pages cannot be migrated
+  ((void)ptr);
+  ((void)count);
+  ((void)flags);
+}
+
+bool ms_set_thread_numa_policy(ms_page_flags const flags) {
+  // No per-thread policy - placement is requested per allocation
+  return ms_get_sys_info()->numa_node_count <= 1 || !(flags & MS_PAGE_NUMA_MASK);
+}
+
+ms_result ms_map_file(
+  char const * const path,
+  uint64_t const size,
+  void * const base_hint,
+  ms_file_mapping * const out_mapping
+) {
+  HANDLE const file = CreateFileA(
+    path,
+    GENERIC_READ | GENERIC_WRITE,
+    0, // share mode
+    NULL,
+    OPEN_ALWAYS,
+    FILE_ATTRIBUTE_NORMAL,
+    NULL
+  );
+
+  if(file == INVALID_HANDLE_VALUE) {
+    return GetLastError() == ERROR_PATH_NOT_FOUND ? MS_RESULT_NOT_FOUND : MS_RESULT_ACCESS;
+  }
+
+  LARGE_INTEGER file_size;
+  ms_result result = MS_RESULT_SUCCESS;
+
+  if(!GetFileSizeEx(file, &file_size)) {
+    result = MS_RESULT_ACCESS;
+  } else if(file_size.QuadPart == 0) {
+    // New or empty file - extended by the mapping
+    if(size == 0) {
+      result = MS_RESULT_INVALID_ARGUMENT;
+    } else {
+      file_size.QuadPart = (LONGLONG)size;
+    }
+  }
+
+  if(result == MS_RESULT_SUCCESS) {
+    HANDLE const mapping = CreateFileMappingA(
+      file,
+      NULL,
+      PAGE_READWRITE,
+      (DWORD)(file_size.QuadPart >> 32),
+      (DWORD)file_size.QuadPart,
+      NULL
+    );
+
+    if(mapping != NULL) {
+      void *base = MapViewOfFileEx(mapping, FILE_MAP_ALL_ACCESS, 0, 0, 0, base_hint);
+
+      if(base == NULL && base_hint != NULL) {
+        base = MapViewOfFileEx(mapping, FILE_MAP_ALL_ACCESS, 0, 0, 0, NULL);
+      }
+
+      if(base != NULL) {
+        *out_mapping = (ms_file_mapping) {
+          base,
+          (uint64_t)file_size.QuadPart, // size
+          (intptr_t)file, // file
+          (intptr_t)mapping // mapping
+        };
+
+        return MS_RESULT_SUCCESS;
+      }
+
+      CloseHandle(mapping);
+    }
+
+    result = MS_RESULT_MEMORY;
+  }
+
+  CloseHandle(file);
+
+  return result;
+}
+
+void ms_unmap_file(ms_file_mapping * const mapping) {
+  UnmapViewOfFile(mapping->base);
+  CloseHandle((HANDLE)mapping->mapping);
+  CloseHandle((HANDLE)mapping->file);
+
+  mapping->base = NULL;
+  mapping->size = 0;
+}
+
+bool ms_sync_file(ms_file_mapping const * const mapping) {
+  return FlushViewOfFile(mapping->base, 0) && FlushFileBuffers((HANDLE)mapping->file);
+}
+
+bool ms_lock_file(ms_file_mapping const * const mapping) {
+  OVERLAPPED overlapped = { 0 };
+
+  // Lock a range past any file content, so that the lock only guards against other mappings
+  overlapped.Offset = MAXDWORD;
+  overlapped.OffsetHigh = MAXDWORD;
+
+  return LockFileEx((HANDLE)mapping->file, LOCKFILE_EXCLUSIVE_LOCK | LOCKFILE_FAIL_IMMEDIATELY, 0, 1, 0, &overlapped);
+}
@@ -0,0 +1,197 @@
+#include <moonsugar/assert.h>
+#include <moonsugar/log.h>
+#include <moonsugar/util.h>
+#include <moonsugar/sys.h>
+#include <moonsugar/persistent-heap.h>
+
+#define PHEAP_MAGIC (0x5041454850534dull) // "MSPHEAP", little endian
+
+// File header, followed by the heap memory
+typedef struct {
+  uint64_t magic; // Written last on creation - 0 = incomplete
+  uint32_t version;
+  uint32_t is_dirty; // Set when opened, cleared when synced
+  uint64_t header_size; // Offset of the heap memory from the mapping base
+  void *base; // Mapping base address when last opened
+  void *root;
+  ms_heap heap;
+} pheap_header;
+
+static pheap_header * get_header(ms_pheap const *const pheap) {
+  return pheap->mapping.base;
+}
+
+static ms_result create_heap(ms_pheap *const pheap, uint64_t const size) {
+  pheap_header *const hdr = get_header(pheap);
+  uint64_t const header_size = ms_align_sz(sizeof(pheap_header), ms_get_sys_info()->page_size);
+
+  if(size == 0 || header_size + size > pheap->mapping.size) {
+    ms_error("Persistent heap file too small.");
+    return MS_RESULT_INVALID_ARGUMENT;
+  }
+
+  hdr->version = MS_PHEAP_VERSION;
+  hdr->is_dirty = true;
+  hdr->header_size = header_size;
+  hdr->base = hdr;
+  hdr->root = NULL;
+
+  MS_CKRET(ms_heap_construct_at(&hdr->heap, (uint8_t*)hdr + header_size, size, 0));
+
+  hdr->magic = PHEAP_MAGIC;
+  pheap->is_new = true;
+
+  return MS_RESULT_SUCCESS;
+}
+
+static ms_result validate_heap(ms_pheap const *const pheap, ms_pheap_flags const flags) {
+  pheap_header const *const hdr = get_header(pheap);
+
+  if(hdr->magic != PHEAP_MAGIC || hdr->version != MS_PHEAP_VERSION) {
+    ms_error("Not a persistent heap file.");
+    return MS_RESULT_INVALID_ARGUMENT;
+  }
+
+  if(hdr->header_size + hdr->heap.size > pheap->mapping.size) {
+    ms_error("Persistent heap file truncated.");
+    return MS_RESULT_INVALID_ARGUMENT;
+  }
+
+  if(hdr->is_dirty) {
+    if(!ms_test(flags, MS_PHEAP_RECOVER_BIT)) {
+      ms_error("Persistent heap neither closed nor synced.");
+      return MS_RESULT_ACCESS;
+    }
+
+    ms_warn("Recovering persistent heap neither closed nor synced.");
+  }
+
+  return MS_RESULT_SUCCESS;
+}
+
+/**
+ * Lock a heap file for this process.
+ */
+static ms_result lock_heap(ms_pheap const *const pheap) {
+  if(!ms_lock_file(&pheap->mapping)) {
+    ms_error("Persistent heap in use.");
+    return MS_RESULT_ACCESS;
+  }
+
+  return MS_RESULT_SUCCESS;
+}
+
+/**
+ * Bind the heap found in the mapping to this process.
+ */
+static void attach_heap(ms_pheap *const pheap) {
+  pheap_header *const hdr = get_header(pheap);
+
+  pheap->relocation_offset = (uint8_t*)hdr - (uint8_t*)hdr->base;
+
+  if(hdr->root != NULL) {
+    hdr->root = (uint8_t*)hdr->root + pheap->relocation_offset;
+  }
+
+  hdr->is_dirty = true;
+  hdr->base = hdr;
+
+  ms_heap_attach(&hdr->heap, (uint8_t*)hdr + hdr->header_size);
+}
+
+ms_result ms_pheap_open(ms_pheap *const pheap, ms_pheap_description const *const description) {
+  MS_ASSERT(pheap);
+  MS_ASSERT(description);
+
+  uint64_t const header_size = ms_align_sz(sizeof(pheap_header), ms_get_sys_info()->page_size);
+  ms_result result = ms_map_file(description->path, header_size + description->size, description->base, &pheap->mapping);
+
+  if(result != MS_RESULT_SUCCESS) {
+    ms_error("Unable to map persistent heap file.");
+    return result;
+  }
+
+  pheap->relocation_offset = 0;
+  pheap->is_new = false;
+
+  result = lock_heap(pheap); // Released when unmapped
+
+  if(result != MS_RESULT_SUCCESS) {
+    ms_unmap_file(&pheap->mapping);
+    return result;
+  }
+
+  pheap_header *hdr = get_header(pheap);
+
+  if(hdr->magic == 0) {
+    result = create_heap(pheap, description->size);
+  } else {
+    result = validate_heap(pheap, description->flags);
+
+    // Map again at the previous base
+    if(result == MS_RESULT_SUCCESS && hdr->base != (void*)hdr) {
+      void *const previous_base = hdr->base;
+
+      ms_unmap_file(&pheap->mapping);
+      result = ms_map_file(description->path, 0, previous_base, &pheap->mapping);
+
+      if(result != MS_RESULT_SUCCESS) {
+        ms_error("Unable to map persistent heap file.");
+        return result;
+      }
+
+      hdr = get_header(pheap);
+      result = lock_heap(pheap);
+
+      if(result == MS_RESULT_SUCCESS && hdr->base != (void*)hdr && !ms_test(description->flags, MS_PHEAP_RELOCATABLE_BIT)) {
+        ms_error("Persistent heap base address not available.");
+        result = MS_RESULT_MEMORY;
+      }
+    }
+
+    if(result == MS_RESULT_SUCCESS) {
+      attach_heap(pheap);
+    }
+  }
+
+  if(result != MS_RESULT_SUCCESS) {
+    ms_unmap_file(&pheap->mapping);
+    return result;
+  }
+
+  pheap->heap = &hdr->heap;
+
+  return MS_RESULT_SUCCESS;
+}
+
+void ms_pheap_close(ms_pheap *const pheap) {
+  MS_ASSERT(pheap);
+
+  if(!ms_pheap_sync(pheap)) {
+    ms_error("Unable to sync persistent heap.");
+  }
+
+  ms_unmap_file(&pheap->mapping);
+  pheap->heap = NULL;
+}
+
+bool ms_pheap_sync(ms_pheap *const pheap) {
+  MS_ASSERT(pheap);
+
+  get_header(pheap)->is_dirty = false;
+
+  return ms_sync_file(&pheap->mapping);
+}
+
+void * ms_pheap_get_root(ms_pheap const *const pheap) {
+  MS_ASSERT(pheap);
+
+  return get_header(pheap)->root;
+}
+
+void ms_pheap_set_root(ms_pheap *const pheap, void *const root) {
+  MS_ASSERT(pheap);
+  MS_ASSERT(root == NULL || ms_heap_owns(pheap->heap, root));
+
+  get_header(pheap)->root = root;
+}
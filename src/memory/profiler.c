@@ -0,0 +1,494 @@
+#ifndef _WIN32
+  #ifndef _GNU_SOURCE
+    #define _GNU_SOURCE // dladdr
+  #endif
+
+  #include <dlfcn.h>
+  #include <execinfo.h>
+#endif
+
+#include <stdio.h>
+#include <memory.h>
+#include <moonsugar/assert.h>
+#include <moonsugar/log.h>
+#include <moonsugar/util.h>
+#include <moonsugar/profiler.h>
+
+#define SKIPPED_FRAME_COUNT (2u) // Frames of the profiler itself: record_sample() and its caller
+#define INITIAL_SITE_CAPACITY (64u)
+#define INITIAL_SAMPLE_CAPACITY (256u)
+#define MAX_SYMBOL_LEN (128u) // Max length of a frame in a report line
+
+static uint32_t capture_frames(void **const frames) {
+#ifdef _WIN32
+  return RtlCaptureStackBackTrace(SKIPPED_FRAME_COUNT, MS_MPROF_MAX_FRAMES, frames, NULL);
+#else
+  void *all_frames[MS_MPROF_MAX_FRAMES + SKIPPED_FRAME_COUNT];
+  int const count = backtrace(all_frames, MS_MPROF_MAX_FRAMES + SKIPPED_FRAME_COUNT);
+
+  if(count <= (int)SKIPPED_FRAME_COUNT) {
+    return 0;
+  }
+
+  memcpy(frames, all_frames + SKIPPED_FRAME_COUNT, (count - SKIPPED_FRAME_COUNT) * sizeof(void*));
+
+  return count - SKIPPED_FRAME_COUNT;
+#endif
+}
+
+static uint64_t hash_frames(void *const *const frames, uint32_t const frame_count) {
+  uint64_t hash = 14695981039346656037ull; // FNV-1a
+
+  for(uint32_t i = 0; i < frame_count; ++i) {
+    hash = (hash ^ (uint64_t)(uintptr_t)frames[i]) * 1099511628211ull;
+  }
+
+  return hash;
+}
+
+static uint32_t hash_ptr(void const *const ptr) {
+  return (uint32_t)((((uint64_t)(uintptr_t)ptr >> 4) * 11400714819323198485ull) >> 32);
+}
+
+/**
+ * Get the number of bytes until the next sample.
+ *
+ * Intervals are uniformly distributed around the sample interval,
+ * so that allocation patterns repeating at a fixed stride are not
+ * systematically missed.
+ */
+static int64_t get_next_interval(ms_mprof *const mprof) {
+  // xorshift64*
+  mprof->random_state ^= mprof->random_state >> 12;
+  mprof->random_state ^= mprof->random_state << 25;
+  mprof->random_state ^= mprof->random_state >> 27;
+
+  uint64_t const random = mprof->random_state * 2685821657736338717ull;
+
+  return (int64_t)(1 + random % (2 * mprof->sample_interval));
+}
+
+ms_result ms_mprof_construct(ms_mprof *const mprof, ms_mprof_description const *const description) {
+  mprof->allocator = description->allocator;
+  mprof->sample_interval = description->sample_interval;
+  mprof->bytes_until_sample = 0;
+  mprof->sample_count = 0;
+  mprof->random_state = (uint64_t)(uintptr_t)mprof | 1; // Must not be 0
+  mprof->site_count = 0;
+  mprof->site_capacity = INITIAL_SITE_CAPACITY;
+  mprof->sample_capacity = INITIAL_SAMPLE_CAPACITY;
+
+  mprof->sites = ms_malloc(&mprof->allocator, INITIAL_SITE_CAPACITY * sizeof(ms_mprof_site), MS_DEFAULT_ALIGNMENT);
+  mprof->site_index = ms_malloc(&mprof->allocator, 2 * INITIAL_SITE_CAPACITY * sizeof(uint32_t), MS_DEFAULT_ALIGNMENT);
+  mprof->samples = ms_malloc(&mprof->allocator, INITIAL_SAMPLE_CAPACITY * sizeof(ms_mprof_sample), MS_DEFAULT_ALIGNMENT);
+
+  if(mprof->sites == NULL || mprof->site_index == NULL || mprof->samples == NULL) {
+    ms_free(&mprof->allocator, mprof->sites);
+    ms_free(&mprof->allocator, mprof->site_index);
+    ms_free(&mprof->allocator, mprof->samples);
+
+    return MS_RESULT_MEMORY;
+  }
+
+  memset(mprof->site_index, 0, 2 * INITIAL_SITE_CAPACITY * sizeof(uint32_t));
+  memset(mprof->samples, 0, INITIAL_SAMPLE_CAPACITY * sizeof(ms_mprof_sample));
+
+  if(mprof->sample_interval > 0) {
+    mprof->bytes_until_sample = get_next_interval(mprof);
+  }
+
+  ms_mutex_construct(&mprof->lock);
+
+  return MS_RESULT_SUCCESS;
+}
+
+void ms_mprof_destroy(ms_mprof *const mprof) {
+  if(ms_atomic_load(&mprof->sample_count, MS_MEMORY_ORDER_RELAXED) > 0) {
+    ms_warn("Memory leak detected.");
+  }
+
+  ms_mutex_destroy(&mprof->lock);
+
+  ms_free(&mprof->allocator, mprof->sites);
+  ms_free(&mprof->allocator, mprof->site_index);
+  ms_free(&mprof->allocator, mprof->samples);
+
+  mprof->sites = NULL;
+  mprof->site_index = NULL;
+  mprof->samples = NULL;
+}
+
+/**
+ * Insert a site in the site index.
+ */
+static void index_site(uint32_t *const site_index, uint32_t const index_capacity, uint64_t const hash, uint32_t const site) {
+  uint32_t const mask = index_capacity - 1;
+
+  for(uint32_t i = (uint32_t)hash & mask; ; i = (i + 1) & mask) {
+    if(site_index[i] == 0) {
+      site_index[i] = site + 1;
+      return;
+    }
+  }
+}
+
+static bool grow_sites(ms_mprof *const mprof) {
+  uint32_t const new_capacity = 2 * mprof->site_capacity;
+  ms_mprof_site *const new_sites = ms_realloc(&mprof->allocator, mprof->sites, new_capacity * sizeof(ms_mprof_site));
+
+  if(new_sites == NULL) {
+    return false;
+  }
+
+  mprof->sites = new_sites;
+
+  uint32_t *const new_site_index = ms_malloc(&mprof->allocator, 2 * new_capacity * sizeof(uint32_t), MS_DEFAULT_ALIGNMENT);
+
+  if(new_site_index == NULL) {
+    return false;
+  }
+
+  memset(new_site_index, 0, 2 * new_capacity * sizeof(uint32_t));
+
+  for(uint32_t i = 0; i < mprof->site_count; ++i) {
+    index_site(new_site_index, 2 * new_capacity, new_sites[i].hash, i);
+  }
+
+  ms_free(&mprof->allocator, mprof->site_index);
+
+  mprof->site_index = new_site_index;
+  mprof->site_capacity = new_capacity;
+
+  return true;
+}
+
+/**
+ * Find the site of a call stack, creating it if necessary.
+ *
+ * @return The site index or `UINT32_MAX` on failure.
+ */
+static uint32_t get_site(ms_mprof *const mprof, void *const *const frames, uint32_t const frame_count) {
+  uint64_t const hash = hash_frames(frames, frame_count);
+  uint32_t const mask = 2 * mprof->site_capacity - 1;
+
+  for(uint32_t i = (uint32_t)hash & mask; mprof->site_index[i] != 0; i = (i + 1) & mask) {
+    ms_mprof_site const *const site = &mprof->sites[mprof->site_index[i] - 1];
+
+    if(
+      site->hash == hash
+      && site->frame_count == frame_count
+      && memcmp(site->frames, frames, frame_count * sizeof(void*)) == 0
+    ) {
+      return mprof->site_index[i] - 1;
+    }
+  }
+
+  if(mprof->site_count == mprof->site_capacity && !grow_sites(mprof)) {
+    return UINT32_MAX;
+  }
+
+  uint32_t const site_index = mprof->site_count++;
+  ms_mprof_site *const site = &mprof->sites[site_index];
+
+  memset(site, 0, sizeof(ms_mprof_site));
+  memcpy(site->frames, frames, frame_count * sizeof(void*));
+  site->frame_count = frame_count;
+  site->hash = hash;
+
+  index_site(mprof->site_index, 2 * mprof->site_capacity, hash, site_index);
+
+  return site_index;
+}
+
+static void insert_sample(ms_mprof_sample *const samples, uint32_t const capacity, ms_mprof_sample const *const sample) {
+  uint32_t const mask = capacity - 1;
+
+  for(uint32_t i = hash_ptr(sample->ptr) & mask; ; i = (i + 1) & mask) {
+    if(samples[i].ptr == NULL) {
+      samples[i] = *sample;
+      return;
+    }
+  }
+}
+
+static bool grow_samples(ms_mprof *const mprof) {
+  uint32_t const new_capacity = 2 * mprof->sample_capacity;
+  ms_mprof_sample *const new_samples = ms_malloc(&mprof->allocator, new_capacity * sizeof(ms_mprof_sample), MS_DEFAULT_ALIGNMENT);
+
+  if(new_samples == NULL) {
+    return false;
+  }
+
+  memset(new_samples, 0, new_capacity * sizeof(ms_mprof_sample));
+
+  for(uint32_t i = 0; i < mprof->sample_capacity; ++i) {
+    if(mprof->samples[i].ptr != NULL) {
+      insert_sample(new_samples, new_capacity, &mprof->samples[i]);
+    }
+  }
+
+  ms_free(&mprof->allocator, mprof->samples);
+
+  mprof->samples = new_samples;
+  mprof->sample_capacity = new_capacity;
+
+  return true;
+}
+
+/**
+ * Record the call stack of a sampled allocation.
+ *
+ * Must not be inlined, the caller frames are skipped by count.
+ */
+static MSNOINLINE void record_sample(ms_mprof *const mprof, void *const ptr, size_t const count) {
+  void *frames[MS_MPROF_MAX_FRAMES];
+  uint32_t const frame_count = capture_frames(frames);
+
+  // Each sample stands for the bytes allocated since the last one
+  uint64_t const estimated_count = ms_max(mprof->sample_interval / count, 1);
+  uint64_t const estimated_size = estimated_count * count;
+
+  ms_mutex_lock(&mprof->lock);
+
+  if(mprof->sample_interval > 0) {
+    ms_atomic_store(&mprof->bytes_until_sample, get_next_interval(mprof), MS_MEMORY_ORDER_RELAXED);
+  }
+
+  uint32_t const site_index = get_site(mprof, frames, frame_count);
+
+  // Keep the sample table at most 3/4 full
+  bool const has_room = 4 * (mprof->sample_count + 1) <= 3 * mprof->sample_capacity || grow_samples(mprof);
+
+  if(site_index != UINT32_MAX && has_room) {
+    ms_mprof_site *const site = &mprof->sites[site_index];
+    ms_mprof_sample const sample = { ptr, site_index, estimated_size, estimated_count };
+
+    site->alloc_count += estimated_count;
+    site->alloc_size += estimated_size;
+    site->live_count += estimated_count;
+    site->live_size += estimated_size;
+
+    insert_sample(mprof->samples, mprof->sample_capacity, &sample);
+    ms_atomic_add_fetch(&mprof->sample_count, 1, MS_MEMORY_ORDER_RELAXED);
+  }
+
+  ms_mutex_unlock(&mprof->lock);
+}
+
+/**
+ * Remove the sample of an allocation, if it was sampled.
+ *
+ * @param out_sample The removed sample - can be NULL.
+ *
+ * @return True if the allocation was sampled.
+ */
+static bool forget_sample(ms_mprof *const mprof, void *const ptr, ms_mprof_sample *const out_sample) {
+  if(ms_atomic_load(&mprof->sample_count, MS_MEMORY_ORDER_RELAXED) == 0) {
+    return false;
+  }
+
+  ms_mutex_lock(&mprof->lock);
+
+  uint32_t const mask = mprof->sample_capacity - 1;
+  uint32_t i = hash_ptr(ptr) & mask;
+
+  while(mprof->samples[i].ptr != NULL && mprof->samples[i].ptr != ptr) {
+    i = (i + 1) & mask;
+  }
+
+  bool const is_sampled = mprof->samples[i].ptr != NULL;
+
+  if(is_sampled) {
+    ms_mprof_sample const *const sample = &mprof->samples[i];
+
+    if(out_sample != NULL) {
+      *out_sample = *sample;
+    }
+    ms_mprof_site *const site = &mprof->sites[sample->site];
+
+    site->live_count -= sample->count;
+    site->live_size -= sample->size;
+
+    // Backward shift deletion - move back the samples displaced past the removed one
+    for(uint32_t j = (i + 1) & mask; mprof->samples[j].ptr != NULL; j = (j + 1) & mask) {
+      uint32_t const home = hash_ptr(mprof->samples[j].ptr) & mask;
+
+      // Can move if the home slot is not within (i, j]
+      if(((j - home) & mask) >= ((j - i) & mask)) {
+        mprof->samples[i] = mprof->samples[j];
+        i = j;
+      }
+    }
+
+    mprof->samples[i].ptr = NULL;
+    ms_atomic_sub_fetch(&mprof->sample_count, 1, MS_MEMORY_ORDER_RELAXED);
+  }
+
+  ms_mutex_unlock(&mprof->lock);
+
+  return is_sampled;
+}
+
+/**
+ * Put back a sample removed by `forget_sample()`, its block still being live.
+ */
+static void restore_sample(ms_mprof *const mprof, ms_mprof_sample const *const sample) {
+  ms_mutex_lock(&mprof->lock);
+
+  ms_mprof_site *const site = &mprof->sites[sample->site];
+
+  site->live_count += sample->count;
+  site->live_size += sample->size;
+
+  // The table had room for the sample before its removal
+  insert_sample(mprof->samples, mprof->sample_capacity, sample);
+  ms_atomic_add_fetch(&mprof->sample_count, 1, MS_MEMORY_ORDER_RELAXED);
+
+  ms_mutex_unlock(&mprof->lock);
+}
+
+/**
+ * Test whether an allocation must be sampled.
+ */
+static bool should_sample(ms_mprof *const mprof, size_t const count) {
+  return mprof->sample_interval == 0
+    || ms_atomic_sub_fetch(&mprof->bytes_until_sample, (int64_t)count, MS_MEMORY_ORDER_RELAXED) <= 0;
+}
+
+void * ms_mprof_malloc(ms_mprof *const mprof, size_t const count, size_t const alignment) {
+  void *const ptr = ms_malloc(&mprof->allocator, count, alignment);
+
+  if(ptr != NULL && should_sample(mprof, count)) {
+    record_sample(mprof, ptr, count);
+  }
+
+  return ptr;
+}
+
+void * ms_mprof_realloc(ms_mprof *const mprof, void *const ptr, size_t const new_count) {
+  // The sample is removed first, as another thread may reuse the address once released
+  ms_mprof_sample sample;
+  bool const was_sampled = ptr != NULL && forget_sample(mprof, ptr, &sample);
+
+  void *const new_ptr = ms_realloc(&mprof->allocator, ptr, new_count);
+
+  if(new_ptr == NULL) {
+    // The block is left untouched on failure
+    if(was_sampled && new_count > 0) {
+      restore_sample(mprof, &sample);
+    }
+
+    return NULL;
+  }
+
+  // Moved blocks are sampled as new allocations, blocks resized in place keep their sample
+  if(should_sample(mprof, new_count)) {
+    record_sample(mprof, new_ptr, new_count);
+  } else if(was_sampled && new_ptr == ptr) {
+    restore_sample(mprof, &sample);
+  }
+
+  return new_ptr;
+}
+
+void ms_mprof_free(ms_mprof *const mprof, void *const ptr) {
+  if(ptr != NULL) {
+    forget_sample(mprof, ptr, NULL);
+  }
+
+  ms_free(&mprof->allocator, ptr);
+}
+
+static uint64_t get_report_value(ms_mprof_site const *const site, ms_mprof_report const report) {
+  switch(report) {
+    case MS_MPROF_REPORT_LIVE_SIZE:
+      return site->live_size;
+    case MS_MPROF_REPORT_LIVE_COUNT:
+      return site->live_count;
+    case MS_MPROF_REPORT_ALLOC_SIZE:
+      return site->alloc_size;
+    case MS_MPROF_REPORT_ALLOC_COUNT:
+      return site->alloc_count;
+    default:
+      MSUNREACHABLE;
+  }
+}
+
+/**
+ * Write the name of a frame.
+ *
+ * Frames are named after their symbol, falling back to their
+ * module and offset and finally to their address.
+ *
+ * @return The number of characters written.
+ */
+static int write_frame_name(char *const out, size_t const out_size, void *const frame) {
+#ifndef _WIN32
+  Dl_info info;
+
+  if(dladdr(frame, &info) != 0) {
+    if(info.dli_sname != NULL) {
+      return snprintf(out, out_size, "%s", info.dli_sname);
+    }
+
+    if(info.dli_fname != NULL) {
+      char const *const slash = strrchr(info.dli_fname, '/');
+
+      return snprintf(
+        out,
+        out_size,
+        "%s+0x%llx",
+        slash ? slash + 1 : info.dli_fname,
+        (unsigned long long)((uint8_t *)frame - (uint8_t *)info.dli_fbase)
+      );
+    }
+  }
+#endif
+
+  return snprintf(out, out_size, "%p", frame);
+}
+
+void ms_mprof_dump(
+  ms_mprof *const mprof,
+  ms_mprof_report const report,
+  ms_mprof_write_clbk const write,
+  void * const user
+) {
+  char line[MS_MPROF_MAX_FRAMES * (MAX_SYMBOL_LEN + 1) + 32];
+
+  ms_mutex_lock(&mprof->lock);
+
+  for(uint32_t i = 0; i < mprof->site_count; ++i) {
+    ms_mprof_site const *const site = &mprof->sites[i];
+    uint64_t const value = get_report_value(site, report);
+
+    if(value == 0) {
+      continue;
+    }
+
+    size_t length = 0;
+
+    // Outermost frame first
+    for(uint32_t f = site->frame_count; f > 0; --f) {
+      char name[MAX_SYMBOL_LEN];
+      int const name_length = write_frame_name(name, sizeof(name), site->frames[f - 1]);
+
+      if(name_length > 0) {
+        // Separators are not allowed in frame names
+        for(char *c = name; *c != '\0'; ++c) {
+          if(*c == ';' || *c == ' ') {
+            *c = '_';
+          }
+        }
+
+        length += snprintf(line + length, sizeof(line) - length, f < site->frame_count ? ";%s" : "%s", name);
+      }
+    }
+
+    length += snprintf(line + length, sizeof(line) - length, " %llu\n", (unsigned long long)value);
+
+    write(user, line, length);
+  }
+
+  ms_mutex_unlock(&mprof->lock);
+}
@@ -0,0 +1,213 @@
+#include <memory.h>
+#include <moonsugar/assert.h>
+#include <moonsugar/log.h>
+#include <moonsugar/util.h>
+#include <moonsugar/slab.h>
+
+#define LINEAR_CLASS_COUNT (8u) // Classes up to 64 bytes, 8 bytes apart
+#define LINEAR_CLASS_STEP (8u)
+#define CLASSES_PER_POWER2 (4u)
+
+// Allocation tags, stored right before each allocation
+#define TAG_SMALL (1u) // Tag value = class index << 2 | TAG_SMALL
+#define TAG_LARGE (2u) // Tag value = offset from the parent allocation << 2 | TAG_LARGE
+#define TAG_KIND_MASK (3u)
+#define TAG_SHIFT (2u)
+
+#define GET_TAG(ptr) (((uintptr_t *)(ptr))[-1])
+#define GET_LARGE_COUNT(ptr) (((uintptr_t *)(ptr))[-2]) // Size of a large allocation, stored before its tag
+
+/**
+ * Get the size class serving an allocation.
+ *
+ * @param count The allocation size, in bytes. Must be between 1 and `MS_SLAB_MAX_CLASS_SIZE`.
+ */
+static uint32_t get_class_index(size_t const count) {
+  MS_ASSERT(count > 0 && count <= MS_SLAB_MAX_CLASS_SIZE);
+
+  if(count <= LINEAR_CLASS_COUNT * LINEAR_CLASS_STEP) {
+    return (count - 1) / LINEAR_CLASS_STEP;
+  }
+
+  uint32_t const log2 = 63 - __builtin_clzll(count - 1); // >= 6
+
+  return LINEAR_CLASS_COUNT
+    + (log2 - 6) * CLASSES_PER_POWER2
+    + ((count - 1) >> (log2 - 2))
+    - CLASSES_PER_POWER2;
+}
+
+static uint32_t get_class_size(uint32_t const class_index) {
+  if(class_index < LINEAR_CLASS_COUNT) {
+    return (class_index + 1) * LINEAR_CLASS_STEP;
+  }
+
+  uint32_t const group = (class_index - LINEAR_CLASS_COUNT) / CLASSES_PER_POWER2;
+  uint32_t const step = (class_index - LINEAR_CLASS_COUNT) % CLASSES_PER_POWER2;
+
+  return (64u << group) + (step + 1) * (16u << group);
+}
+
+static bool is_small(size_t const count, size_t const alignment) {
+  return count <= MS_SLAB_MAX_CLASS_SIZE && alignment <= MS_DEFAULT_ALIGNMENT;
+}
+
+size_t ms_slab_get_class_size(size_t const count) {
+  return count > 0 && count <= MS_SLAB_MAX_CLASS_SIZE ? get_class_size(get_class_index(count)) : 0;
+}
+
+ms_result ms_slab_construct(ms_slab *const slab, ms_slab_description const *const description) {
+  MS_ASSERT(slab);
+  MS_ASSERT(description);
+
+  slab->allocator = description->allocator;
+
+  for(uint32_t i = 0; i < MS_SLAB_CLASS_COUNT; ++i) {
+    uint32_t const item_size = get_class_size(i);
+    ms_pool_description const pool_description = {
+      description->allocator,
+      item_size,
+      ms_max(description->page_size / (item_size + sizeof(ms_pool_node)), 1) // items_per_page
+    };
+
+    ms_result const result = ms_pool_construct(&slab->pools[i], &pool_description);
+
+    if(result != MS_RESULT_SUCCESS) {
+      for(uint32_t j = 0; j < i; ++j) {
+        ms_pool_destroy(&slab->pools[j]);
+      }
+
+      return result;
+    }
+  }
+
+  return MS_RESULT_SUCCESS;
+}
+
+void ms_slab_destroy(ms_slab *const slab) {
+  MS_ASSERT(slab);
+
+  for(uint32_t i = 0; i < MS_SLAB_CLASS_COUNT; ++i) {
+    ms_pool_destroy(&slab->pools[i]);
+  }
+}
+
+static void * malloc_large(ms_slab *const slab, size_t const count, size_t alignment) {
+  alignment = ms_max(alignment, MS_DEFAULT_ALIGNMENT);
+
+  size_t const offset = ms_align_sz(2 * sizeof(uintptr_t), alignment); // Room for the size and tag
+  uint8_t *const base = ms_malloc(&slab->allocator, count + offset, alignment);
+
+  if(base == NULL) {
+    return NULL;
+  }
+
+  uint8_t *const ptr = base + offset;
+  GET_TAG(ptr) = (offset << TAG_SHIFT) | TAG_LARGE;
+  GET_LARGE_COUNT(ptr) = count;
+
+  return ptr;
+}
+
+void * ms_slab_malloc(ms_slab *const slab, size_t const count, size_t const alignment) {
+  MS_ASSERT(slab);
+
+  if(count == 0) {
+    return NULL;
+  }
+
+  if(!is_small(count, alignment)) {
+    return malloc_large(slab, count, alignment);
+  }
+
+  uint32_t const class_index = get_class_index(count);
+  void *const ptr = ms_pool_acquire(&slab->pools[class_index]);
+
+  if(ptr == NULL) {
+    return NULL;
+  }
+
+  // The node link is unused while the item is acquired
+  GET_TAG(ptr) = (class_index << TAG_SHIFT) | TAG_SMALL;
+
+  return ptr;
+}
+
+void ms_slab_free(ms_slab *const slab, void *const ptr) {
+  MS_ASSERT(slab);
+
+  if(ptr == NULL) {
+    return;
+  }
+
+  uintptr_t const tag = GET_TAG(ptr);
+
+  switch(tag & TAG_KIND_MASK) {
+    case TAG_SMALL:
+      MS_ASSERT((tag >> TAG_SHIFT) < MS_SLAB_CLASS_COUNT);
+
+      ms_pool_release(&slab->pools[tag >> TAG_SHIFT], ptr);
+      break;
+
+    case TAG_LARGE:
+      ms_free(&slab->allocator, (uint8_t *)ptr - (tag >> TAG_SHIFT));
+      break;
+
+    default:
+      ms_fatal("Attempting to free pointer not mallocd via this slab allocator.");
+  }
+}
+
+void * ms_slab_realloc(ms_slab *const slab, void *const ptr, size_t const new_count) {
+  MS_ASSERT(slab);
+
+  if(ptr == NULL) {
+    return ms_slab_malloc(slab, new_count, MS_DEFAULT_ALIGNMENT);
+  }
+
+  if(new_count == 0) {
+    ms_slab_free(slab, ptr);
+    return NULL;
+  }
+
+  uintptr_t const tag = GET_TAG(ptr);
+
+  if((tag & TAG_KIND_MASK) == TAG_LARGE) {
+    size_t const offset = tag >> TAG_SHIFT;
+    uint8_t *const new_base = ms_realloc(&slab->allocator, (uint8_t *)ptr - offset, new_count + offset);
+
+    if(new_base == NULL) {
+      return NULL;
+    }
+
+    // The parent keeps the alignment, and so the tag offset
+    GET_LARGE_COUNT(new_base + offset) = new_count;
+
+    return new_base + offset;
+  }
+
+  uint32_t const class_index = tag >> TAG_SHIFT;
+
+  if(new_count <= MS_SLAB_MAX_CLASS_SIZE && get_class_index(new_count) == class_index) {
+    return ptr;
+  }
+
+  void *const new_ptr = ms_slab_malloc(slab, new_count, MS_DEFAULT_ALIGNMENT);
+
+  if(new_ptr) {
+    memcpy(new_ptr, ptr, ms_min(get_class_size(class_index), new_count));
+    ms_slab_free(slab, ptr);
+  }
+
+  return new_ptr;
+}
+
+size_t ms_slab_get_size(ms_slab *const slab, void *const ptr) {
+  MS_ASSERT(slab);
+  MS_ASSERT(ptr);
+  ((void)slab);
+
+  uintptr_t const tag = GET_TAG(ptr);
+
+  return (tag & TAG_KIND_MASK) == TAG_SMALL ? get_class_size(tag >> TAG_SHIFT) : GET_LARGE_COUNT(ptr);
+}
@@ -3,11 +3,20 @@
 #include <moonsugar/util.h>
 #include <moonsugar/log.h>
 #include <moonsugar/memory.h>
+#include <moonsugar/sys.h>
+#include <moonsugar/thread.h>
 
-ms_result ms_stack_construct(ms_stack * const restrict stack, uint64_t const max_size) {
+static MS_THREAD_LOCAL ms_stack thread_stack;
+static MS_THREAD_LOCAL bool is_thread_stack_constructed;
+
+ms_result ms_stack_construct(
+  ms_stack * const restrict stack,
+  uint64_t const max_size,
+  ms_page_flags const page_flags
+) {
   MS_ASSERT(stack);
 
-  void * const memory = ms_reserve(max_size);
+  void * const memory = ms_reserve(max_size, page_flags);
 
   if(memory == NULL) {
     ms_error("Unable to reserve memory.");
@@ -18,7 +27,12 @@ ms_result ms_stack_construct(ms_stack * const restrict stack, uint64_t const max
     memory, // base
     max_size, // size
     memory, // top
-    memory // committed_top
+    memory, // committed_top
+    false, // commit_lock
+    page_flags,
+    MS_DECOMMIT_POLICY_DEFAULT,
+    0, // alloc_count
+    0 // peak_size
   };
 
   return MS_RESULT_SUCCESS;
@@ -31,10 +45,48 @@ void ms_stack_destroy(ms_stack * const restrict stack) {
     ms_warn("Memory leak detected.");
   }
 
-  ms_release(stack->base, stack->size);
+  ms_release(stack->base, stack->size, stack->page_flags);
   memset(stack, 0, sizeof(ms_stack));
 }
 
+static void lock_commits(ms_stack * const restrict stack) {
+  while(ms_atomic_test_and_set(&stack->commit_lock, MS_MEMORY_ORDER_ACQUIRE));
+}
+
+static void unlock_commits(ms_stack * const restrict stack) {
+  ms_atomic_clear(&stack->commit_lock, MS_MEMORY_ORDER_RELEASE);
+}
+
+/**
+ * Commit the stack memory up to the given pointer.
+ *
+ * @return False on failure.
+ */
+static bool commit_to(ms_stack * const restrict stack, uint8_t * const end_ptr) {
+  bool result = true;
+
+  lock_commits(stack);
+
+  // Another thread may have committed while waiting for the lock
+  uint8_t * const committed_top = ms_atomic_load(&stack->committed_top, MS_MEMORY_ORDER_RELAXED);
+
+  if(end_ptr > committed_top) {
+    uint8_t * const stack_end = (uint8_t*)stack->base + stack->size;
+    uint8_t * const page_end = ms_align_ptr(end_ptr, ms_get_sys_info()->page_size);
+    uint8_t * const new_committed_top = page_end < stack_end ? page_end : stack_end;
+
+    result = ms_commit(committed_top, new_committed_top - committed_top, stack->page_flags);
+
+    if(result) {
+      ms_atomic_store(&stack->committed_top, new_committed_top, MS_MEMORY_ORDER_RELEASE);
+    }
+  }
+
+  unlock_commits(stack);
+
+  return result;
+}
+
 void* ms_stack_malloc(
   ms_stack * const restrict stack,
   size_t size,
@@ -42,53 +94,127 @@ void* ms_stack_malloc(
 ) {
   MS_ASSERT(stack);
 
-  size = ms_choose(
-    size,
-    size + alignment - 1,
+  // Keep the top aligned to MS_DEFAULT_ALIGNMENT
+  size = ms_align_sz(size, MS_DEFAULT_ALIGNMENT) + ms_choose(
+    0,
+    alignment - MS_DEFAULT_ALIGNMENT,
     alignment <= MS_DEFAULT_ALIGNMENT
   );
 
-  uint8_t * const ptr = ms_atomic_fetch_add(&stack->top, size, MS_MEMORY_ORDER_RELAXED);
-  uint8_t * committed_ptr = ms_atomic_load(&stack->committed_top, MS_MEMORY_ORDER_ACQUIRE);
+  // Acquire pairs with the release of clearing
+  uint8_t * const ptr = ms_atomic_fetch_add(&stack->top, size, MS_MEMORY_ORDER_ACQUIRE);
   uint8_t * const end_ptr = ptr + size;
 
-  if(end_ptr > committed_ptr) {
-    uint64_t const size_to_commit = end_ptr - committed_ptr;
-    uint8_t * const new_committed_top = committed_ptr + size_to_commit;
-
-    bool const commit_result MSUNUSED = ms_commit(committed_ptr, size_to_commit);
-    MS_ASSERT(commit_result);
-
-    // If this fails, another write has succeeded. If the other commit is
-    // smaller than this, we'll commit again sooner than expected, but we can
-    // tolerate that, as it won't cause failures. If the other commit is larger,
-    // we have more memory committed so don't need to do anything anyway.
-    ms_atomic_compare_exchange_strong(
-      &stack->committed_top,
-      &committed_ptr,
-      new_committed_top,
-      MS_MEMORY_ORDER_RELEASE,
+#ifdef MS_FEAT_MEMORY_STATS
+  ms_atomic_add_fetch(&stack->alloc_count, 1, MS_MEMORY_ORDER_RELAXED);
+
+  uint64_t const top_size = end_ptr - (uint8_t*)stack->base;
+  uint64_t peak_size = ms_atomic_load(&stack->peak_size, MS_MEMORY_ORDER_RELAXED);
+
+  while(
+    peak_size < top_size
+    && !ms_atomic_compare_exchange_weak(
+      &stack->peak_size,
+      &peak_size,
+      top_size,
+      MS_MEMORY_ORDER_RELAXED,
       MS_MEMORY_ORDER_RELAXED
-    );
+    )
+  );
+#endif // MS_FEAT_MEMORY_STATS
+
+  if(end_ptr > (uint8_t*)stack->base + stack->size) {
+    return NULL;
   }
 
-  return ptr;
+  if(
+    end_ptr > ms_atomic_load(&stack->committed_top, MS_MEMORY_ORDER_ACQUIRE)
+    && !commit_to(stack, end_ptr)
+  ) {
+    ms_error("Unable to commit stack memory.");
+    return NULL;
+  }
+
+  return alignment <= MS_DEFAULT_ALIGNMENT ? ptr : ms_align_ptr(ptr, alignment);
 }
 
 void ms_stack_clear(ms_stack * const restrict stack) {
   MS_ASSERT(stack);
 
-  ms_atomic_store(&stack->top, stack->base, MS_MEMORY_ORDER_SEQ_CST);
+  lock_commits(stack);
 
-  // This could cause failures under high pressure as we're reducing the
-  // committed pointer to the base and AMSER performing memory decommittment.
-  // A thread could be attempting to commit memory that we are about to decommit.
-  uint8_t * const committed_top = ms_atomic_exchange(&stack->committed_top, stack->base, MS_MEMORY_ORDER_SEQ_CST);
-  uint64_t const committed_size = committed_top - (uint8_t*)stack->base;
+  uint8_t * const committed_top = ms_atomic_load(&stack->committed_top, MS_MEMORY_ORDER_RELAXED);
+  uint64_t const size_to_decommit = ms_decommit_policy_get_size(
+    &stack->decommit_policy,
+    committed_top - (uint8_t*)stack->base
+  );
 
-  if(committed_size > MS_HEAP_DEALLOC_THR) {
-    uint64_t const size_to_decommit = committed_size - MS_HEAP_DEALLOC_THR;
+  // The committed top is lowered before the top is reset, so that
+  // allocations from the cleared stack past the memory kept committed
+  // wait for the decommit to complete and commit again.
+  ms_atomic_store(&stack->committed_top, committed_top - size_to_decommit, MS_MEMORY_ORDER_RELAXED);
+  ms_atomic_store(&stack->top, stack->base, MS_MEMORY_ORDER_RELEASE);
 
-    ms_decommit(committed_top - size_to_decommit, size_to_decommit);
+  if(size_to_decommit > 0) {
+    ms_decommit(committed_top - size_to_decommit, size_to_decommit, stack->page_flags);
   }
+
+  unlock_commits(stack);
+}
+
+ms_stack_marker ms_stack_mark(ms_stack const * const restrict stack) {
+  MS_ASSERT(stack);
+
+  return ms_atomic_load(&stack->top, MS_MEMORY_ORDER_RELAXED);
+}
+
+void ms_stack_rewind(ms_stack * const restrict stack, ms_stack_marker const marker) {
+  MS_ASSERT(stack);
+  MS_ASSERT((uint8_t*)marker >= (uint8_t*)stack->base);
+  MS_ASSERT((uint8_t*)marker <= ms_atomic_load(&stack->top, MS_MEMORY_ORDER_RELAXED));
+
+  ms_atomic_store(&stack->top, marker, MS_MEMORY_ORDER_RELEASE);
+}
+
+static void on_thread_exit(void * const ctx) {
+  ((void)ctx);
+
+  ms_stack_destroy(&thread_stack);
+  is_thread_stack_constructed = false;
+}
+
+ms_stack * ms_stack_get_thread_stack(void) {
+  if(!is_thread_stack_constructed) {
+    if(ms_stack_construct(&thread_stack, MS_STACK_THREAD_SIZE, 0) != MS_RESULT_SUCCESS) {
+      return NULL;
+    }
+
+    is_thread_stack_constructed = true;
+
+    // Stacks of threads not spawned via ms_thread_spawn() live until the process exits
+    bool const is_callback_registered MSUNUSED = ms_thread_on_exit(on_thread_exit, NULL);
+  }
+
+  return &thread_stack;
+}
+
+void ms_stack_get_stats(ms_stack const * const restrict stack, ms_memory_stats *const out_stats) {
+  MS_ASSERT(stack);
+
+  uint8_t * const base = stack->base;
+  uint64_t const live_size = ms_min(ms_atomic_load(&stack->top, MS_MEMORY_ORDER_RELAXED) - base, stack->size);
+  uint64_t const free_size = stack->size - live_size;
+
+  *out_stats = (ms_memory_stats) {
+    stack->size, // reserved_size
+    ms_atomic_load(&stack->committed_top, MS_MEMORY_ORDER_RELAXED) - base, // committed_size
+    live_size,
+    ms_atomic_load(&stack->peak_size, MS_MEMORY_ORDER_RELAXED),
+    ms_atomic_load(&stack->alloc_count, MS_MEMORY_ORDER_RELAXED),
+    0, // free_count - stack memory is only released as a whole
+    free_size > 0 ? 1 : 0, // free_node_count
+    free_size,
+    free_size, // largest_free_size
+    0.0 // fragmentation
+  };
 }
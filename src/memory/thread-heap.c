@@ -0,0 +1,290 @@
+#include <memory.h>
+#include <moonsugar/assert.h>
+#include <moonsugar/log.h>
+#include <moonsugar/util.h>
+#include <moonsugar/thread-heap.h>
+
+// Blocks up to this size are cached - includes the slack of unsplit chunks
+#define MAX_CACHED_USABLE_SIZE (MS_THEAP_MAX_CLASS_SIZE + sizeof(ms_free_list_node) + MS_DEFAULT_ALIGNMENT)
+
+// Smallest usable size of a heap block, heap chunks must be able to host a free list node
+#define MIN_BLOCK_USABLE_SIZE (MS_ALIGN_SZ_STATIC(sizeof(ms_free_list_node), MS_DEFAULT_ALIGNMENT) - sizeof(ms_header))
+
+// Smallest class a heap block can be mapped back to
+#define MIN_CLASS_INDEX (MIN_BLOCK_USABLE_SIZE / MS_THEAP_CLASS_GRANULARITY - 1)
+
+typedef struct cached_block cached_block;
+
+struct cached_block {
+  cached_block *next;
+};
+
+typedef struct {
+  cached_block *first;
+  uint32_t count;
+} cache_bin;
+
+typedef struct {
+  uint64_t generation; // Generation of the owner, 0 = unused
+  ms_theap *owner;
+  cache_bin bins[MS_THEAP_CLASS_COUNT];
+} thread_cache;
+
+static MS_ATOMIC(uint32_t) used_slots; // Bit N set = slot N in use
+static MS_ATOMIC(uint64_t) slot_generations[MS_THEAP_MAX_INSTANCES]; // Generation of the live instance per slot
+static MS_ATOMIC(uint64_t) last_generation;
+
+static MS_THREAD_LOCAL thread_cache caches[MS_THEAP_MAX_INSTANCES];
+static MS_THREAD_LOCAL bool is_exit_callback_registered;
+
+/**
+ * Get the class serving an allocation of the given size.
+ */
+static uint32_t get_malloc_class_index(size_t const count) {
+  return ms_max((count - 1) / MS_THEAP_CLASS_GRANULARITY, MIN_CLASS_INDEX);
+}
+
+/**
+ * Get the class a block of the given usable size can serve.
+ */
+static uint32_t get_free_class_index(size_t const usable_size) {
+  return ms_min(usable_size / MS_THEAP_CLASS_GRANULARITY, MS_THEAP_CLASS_COUNT) - 1;
+}
+
+static void flush_cache(thread_cache *const cache) {
+  ms_theap *const theap = cache->owner;
+
+  ms_mutex_lock(&theap->lock);
+
+  for(uint32_t i = 0; i < MS_THEAP_CLASS_COUNT; ++i) {
+    cache_bin *const bin = &cache->bins[i];
+
+    for(cached_block *b = bin->first, *next; b != NULL; b = next) {
+      next = b->next;
+      ms_heap_free(theap->heap, b);
+    }
+
+    *bin = (cache_bin) { NULL, 0 };
+  }
+
+  ms_mutex_unlock(&theap->lock);
+}
+
+static void on_thread_exit(void *const ctx) {
+  ((void)ctx);
+
+  for(uint32_t i = 0; i < MS_THEAP_MAX_INSTANCES; ++i) {
+    thread_cache *const cache = &caches[i];
+
+    // Caches of destroyed instances are dropped along with their heap
+    if(
+      cache->generation != 0
+      && cache->generation == ms_atomic_load(&slot_generations[i], MS_MEMORY_ORDER_ACQUIRE)
+    ) {
+      flush_cache(cache);
+    }
+
+    cache->generation = 0;
+  }
+}
+
+static thread_cache * get_cache(ms_theap *const theap) {
+  thread_cache *const cache = &caches[theap->slot];
+
+  if(cache->generation != theap->generation) {
+    // First use or left behind by a destroyed instance
+    memset(cache, 0, sizeof(thread_cache));
+
+    cache->generation = theap->generation;
+    cache->owner = theap;
+
+    if(!is_exit_callback_registered) {
+      is_exit_callback_registered = ms_thread_on_exit(on_thread_exit, NULL);
+    }
+  }
+
+  return cache;
+}
+
+ms_result ms_theap_construct(ms_theap *const theap, ms_heap *const heap) {
+  MS_ASSERT(theap);
+  MS_ASSERT(heap);
+  MS_ASSERT(heap->growth_size == 0); // Ownership tests are not locked
+
+  uint32_t slots = ms_atomic_load(&used_slots, MS_MEMORY_ORDER_RELAXED);
+  uint32_t slot;
+
+  do {
+    if(slots == (1u << MS_THEAP_MAX_INSTANCES) - 1) {
+      ms_error("Too many thread-caching heaps.");
+
+      return MS_RESULT_RESOURCE_LIMIT;
+    }
+
+    slot = __builtin_ctz(~slots);
+  } while(
+    !ms_atomic_compare_exchange_weak(
+      &used_slots,
+      &slots,
+      slots | (1u << slot),
+      MS_MEMORY_ORDER_ACQ_REL,
+      MS_MEMORY_ORDER_RELAXED
+    )
+  );
+
+  theap->heap = heap;
+  theap->generation = ms_atomic_add_fetch(&last_generation, 1, MS_MEMORY_ORDER_RELAXED);
+  theap->slot = slot;
+
+  ms_mutex_construct(&theap->lock);
+  ms_atomic_store(&slot_generations[slot], theap->generation, MS_MEMORY_ORDER_RELEASE);
+
+  return MS_RESULT_SUCCESS;
+}
+
+void ms_theap_destroy(ms_theap *const theap) {
+  MS_ASSERT(theap);
+
+  ms_theap_flush(theap);
+
+  ms_atomic_store(&slot_generations[theap->slot], 0, MS_MEMORY_ORDER_RELEASE);
+  ms_atomic_and_fetch(&used_slots, ~(1u << theap->slot), MS_MEMORY_ORDER_ACQ_REL);
+  ms_mutex_destroy(&theap->lock);
+
+  theap->heap = NULL;
+  theap->generation = 0;
+}
+
+void ms_theap_flush(ms_theap *const theap) {
+  MS_ASSERT(theap);
+
+  thread_cache *const cache = &caches[theap->slot];
+
+  if(cache->generation == theap->generation) {
+    flush_cache(cache);
+  }
+}
+
+/**
+ * Refill a bin with a batch of blocks from the heap.
+ *
+ * @return The number of blocks added to the bin.
+ */
+static uint32_t refill_bin(ms_theap *const theap, cache_bin *const bin, size_t const block_size) {
+  uint32_t count = 0;
+
+  ms_mutex_lock(&theap->lock);
+
+  for(; count < MS_THEAP_BATCH_SIZE; ++count) {
+    cached_block *const b = ms_heap_malloc(theap->heap, block_size, MS_DEFAULT_ALIGNMENT);
+
+    if(b == NULL) {
+      break;
+    }
+
+    b->next = bin->first;
+    bin->first = b;
+  }
+
+  ms_mutex_unlock(&theap->lock);
+
+  bin->count += count;
+
+  return count;
+}
+
+/**
+ * Return a batch of blocks from a bin to the heap.
+ */
+static void drain_bin(ms_theap *const theap, cache_bin *const bin) {
+  ms_mutex_lock(&theap->lock);
+
+  for(uint32_t i = 0; i < MS_THEAP_BATCH_SIZE && bin->first != NULL; ++i) {
+    cached_block *const b = bin->first;
+
+    bin->first = b->next;
+    bin->count--;
+
+    ms_heap_free(theap->heap, b);
+  }
+
+  ms_mutex_unlock(&theap->lock);
+}
+
+void * ms_theap_malloc(ms_theap *const theap, size_t const count, size_t const alignment) {
+  MS_ASSERT(theap);
+
+  if(count == 0) {
+    return NULL;
+  }
+
+  if(count <= MS_THEAP_MAX_CLASS_SIZE && alignment <= MS_DEFAULT_ALIGNMENT) {
+    uint32_t const class_index = get_malloc_class_index(count);
+    cache_bin *const bin = &get_cache(theap)->bins[class_index];
+
+    if(bin->first == NULL) {
+      size_t const block_size = (class_index + 1) * MS_THEAP_CLASS_GRANULARITY;
+
+      if(refill_bin(theap, bin, block_size) == 0) {
+        return NULL;
+      }
+    }
+
+    cached_block *const b = bin->first;
+
+    bin->first = b->next;
+    bin->count--;
+
+    return b;
+  }
+
+  ms_mutex_lock(&theap->lock);
+  void *const ptr = ms_heap_malloc(theap->heap, count, alignment);
+  ms_mutex_unlock(&theap->lock);
+
+  return ptr;
+}
+
+void ms_theap_free(ms_theap *const theap, void *const ptr) {
+  MS_ASSERT(theap);
+
+  if(ptr == NULL) {
+    return;
+  }
+
+  MS_ASSERT(theap->heap->growth_size == 0);
+
+  if(!ms_heap_owns(theap->heap, ptr)) {
+    ms_error("Attempting to free pointer not mallocd via this heap.");
+    return;
+  }
+
+  ms_header const *const hdr = ms_heap_get_header(ptr);
+  size_t const usable_size = ms_heap_get_usable_size(ptr);
+
+  if(hdr->alignment <= MS_DEFAULT_ALIGNMENT && usable_size <= MAX_CACHED_USABLE_SIZE) {
+    uint32_t const class_index = get_free_class_index(usable_size);
+    cache_bin *const bin = &get_cache(theap)->bins[class_index];
+    cached_block *const b = ptr;
+
+    b->next = bin->first;
+    bin->first = b;
+    bin->count++;
+
+    if(bin->count > MS_THEAP_MAX_CACHED_BLOCKS) {
+      drain_bin(theap, bin);
+    }
+
+    return;
+  }
+
+  ms_mutex_lock(&theap->lock);
+  ms_heap_free(theap->heap, ptr);
+  ms_mutex_unlock(&theap->lock);
+}
+
+void * ms_theap_realloc(ms_theap *const theap, void *const ptr, size_t const new_count) {
+  MS_ASSERT(theap);
+
+  return ms_heap_realloc_via(&MS_ALLOCATOR_DEF_THEAP(*theap), ptr, new_count);
+}
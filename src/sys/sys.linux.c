@@ -0,0 +1,148 @@
+#include <dirent.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <moonsugar/sys.h>
+
+/**
+ * Read the default huge page size from /proc/meminfo.
+ *
+ * @return The size in bytes or 0 if the kernel does not support huge pages.
+ */
+static uint64_t read_default_huge_page_size(void) {
+  FILE * const f = fopen("/proc/meminfo", "r");
+  char line[128];
+  unsigned long long size_kb = 0;
+
+  if(f == NULL) {
+    return 0;
+  }
+
+  while(fgets(line, sizeof(line), f) != NULL) {
+    if(sscanf(line, "Hugepagesize: %llu kB", &size_kb) == 1) {
+      break;
+    }
+  }
+
+  fclose(f);
+
+  return (uint64_t)size_kb * 1024;
+}
+
+/**
+ * Read the transparent huge page size.
+ *
+ * @return The size in bytes or 0 if transparent huge pages are unsupported.
+ */
+static uint64_t read_transparent_huge_page_size(void) {
+  FILE * const f = fopen("/sys/kernel/mm/transparent_hugepage/hpage_pmd_size", "r");
+  unsigned long long size = 0;
+
+  if(f == NULL) {
+    return 0;
+  }
+
+  if(fscanf(f, "%llu", &size) != 1) {
+    size = 0;
+  }
+
+  fclose(f);
+
+  return size;
+}
+
+/**
+ * Enumerate the explicit huge page pools.
+ *
+ * @return A mask with bit N set for each supported page size of 2^N bytes.
+ */
+static uint64_t read_huge_page_sizes(void) {
+  DIR * const dir = opendir("/sys/kernel/mm/hugepages");
+  uint64_t sizes = 0;
+
+  if(dir == NULL) {
+    return 0;
+  }
+
+  for(struct dirent const *entry = readdir(dir); entry != NULL; entry = readdir(dir)) {
+    unsigned long long size_kb;
+
+    if(sscanf(entry->d_name, "hugepages-%llukB", &size_kb) == 1 && size_kb > 0) {
+      sizes |= (uint64_t)size_kb * 1024;
+    }
+  }
+
+  closedir(dir);
+
+  return sizes;
+}
+
+/**
+ * Read the online NUMA nodes.
+ *
+ * @return A mask with bit N set for each online node N or 0 if NUMA is unsupported.
+ */
+static uint64_t read_numa_node_mask(void) {
+  FILE * const f = fopen("/sys/devices/system/node/online", "r");
+  uint64_t mask = 0;
+  unsigned first, last;
+  char separator = ',';
+
+  if(f == NULL) {
+    return 0;
+  }
+
+  // Comma-separated list of node ranges, e.g. "0-1,3"
+  while(separator == ',' && fscanf(f, "%u", &first) == 1) {
+    last = first;
+
+    if(fscanf(f, "%c", &separator) == 1 && separator == '-') {
+      if(fscanf(f, "%u%c", &last, &separator) < 1) {
+        break;
+      }
+    }
+
+    for(unsigned node = first; node <= last && node < 64; ++node) {
+      mask |= 1ull << node;
+    }
+  }
+
+  fclose(f);
+
+  return mask;
+}
+
+void ms_sys_update_with_os(ms_sys_info *const result) {
+  long const page_size = sysconf(_SC_PAGESIZE);
+
+  result->page_size = page_size;
+  result->alloc_granularity = page_size; // mmap allocates page-aligned
+  result->proc_count = sysconf(_SC_NPROCESSORS_ONLN);
+
+  long const page_count = sysconf(_SC_PHYS_PAGES);
+  result->memory_size = page_count > 0 ? (uint64_t)page_count * page_size : UINT64_MAX;
+
+#ifdef _SC_LEVEL1_DCACHE_LINESIZE
+  long const cache_line_size = sysconf(_SC_LEVEL1_DCACHE_LINESIZE);
+
+  if(cache_line_size > 0) {
+    result->cache_line_size = cache_line_size;
+  }
+#endif // _SC_LEVEL1_DCACHE_LINESIZE
+
+  // Explicit huge pages, falling back to transparent huge pages
+  result->huge_page_size = read_default_huge_page_size();
+
+  if(result->huge_page_size == 0) {
+    result->huge_page_size = read_transparent_huge_page_size();
+  }
+
+  result->huge_page_sizes = read_huge_page_sizes() | result->huge_page_size;
+
+  result->numa_node_mask = read_numa_node_mask();
+
+  if(result->numa_node_mask == 0) {
+    result->numa_node_mask = 1;
+  }
+
+  result->numa_node_count = __builtin_popcountll(result->numa_node_mask);
+}
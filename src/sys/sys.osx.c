@@ -25,6 +25,8 @@ void ms_sys_update_with_os(ms_sys_info *const result) {
   result->page_size = page_size;
   result->proc_count = proc_count;
   result->alloc_granularity = page_size; // mmap allocates page-aligned
+  result->numa_node_count = 1; // Uniform memory access
+  result->numa_node_mask = 1;
   result->cpu_features = 0;
 
 #ifdef __ARM_FEATURE_ATOMICS
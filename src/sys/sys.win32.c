@@ -11,6 +11,19 @@ void ms_sys_update_with_os(ms_sys_info *const result) {
   result->proc_count = sys_info.dwNumberOfProcessors;
   result->alloc_granularity = sys_info.dwAllocationGranularity;
 
+  SIZE_T const large_page_size = GetLargePageMinimum();
+  result->huge_page_size = large_page_size;
+  result->huge_page_sizes = large_page_size; // Single power of two - bit set for its size
+
+  ULONG highest_numa_node = 0;
+
+  if(!GetNumaHighestNodeNumber(&highest_numa_node) || highest_numa_node > 63) {
+    highest_numa_node = 0;
+  }
+
+  result->numa_node_count = highest_numa_node + 1;
+  result->numa_node_mask = highest_numa_node < 63 ? (1ull << (highest_numa_node + 1)) - 1 : UINT64_MAX;
+
   ULONGLONG installed_memory;
   if(GetPhysicallyInstalledSystemMemory(&installed_memory)) {
     result->memory_size = installed_memory * 1024;
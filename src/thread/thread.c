@@ -5,6 +5,14 @@
 
 MS_THREAD_LOCAL char current_thread_name[MS_THREAD_NAME_MAX_LEN];
 
+typedef struct {
+  ms_thread_exit_clbk clbk;
+  void *ctx;
+} exit_callback;
+
+static MS_THREAD_LOCAL exit_callback exit_callbacks[MS_THREAD_MAX_EXIT_CALLBACKS];
+static MS_THREAD_LOCAL unsigned exit_callback_count;
+
 MS_ATOMIC(unsigned) current_descriptor_index;
 static ms_thread_start_descriptor thread_start_descriptors[MAX_DESCRIPTORS];
 
@@ -46,3 +54,21 @@ void ms_set_current_thread_name(char const * const name) {
   memcpy(current_thread_name, name, sizeof(char) * len);
   current_thread_name[MS_THREAD_NAME_MAX_LEN - 1] = '\0';
 }
+
+bool ms_thread_on_exit(ms_thread_exit_clbk const clbk, void * const ctx) {
+  if(exit_callback_count >= MS_THREAD_MAX_EXIT_CALLBACKS) {
+    return false;
+  }
+
+  exit_callbacks[exit_callback_count++] = (exit_callback) { clbk, ctx };
+
+  return true;
+}
+
+void ms_thread_run_exit_callbacks(void) {
+  while(exit_callback_count > 0) {
+    exit_callback const c = exit_callbacks[--exit_callback_count];
+
+    c.clbk(c.ctx);
+  }
+}
@@ -1,4 +1,5 @@
 #include <string.h>
+#include <time.h>
 #include <unistd.h>
 #include <pthread.h>
 #include <moonsugar/log.h>
@@ -27,6 +28,7 @@ static void *thread_main(void *const param) {
 
   ms_debugf("Thread %s has started.", ms_get_current_thread_name());
   desc.main(desc.ctx);
+  ms_thread_run_exit_callbacks();
   ms_debugf("Thread %s has terminated.", ms_get_current_thread_name());
 
   return NULL;
@@ -86,3 +88,11 @@ bool ms_thread_join(ms_thread *const t) {
 void ms_thread_yield(void) { sched_yield(); }
 void ms_thread_sleep(ms_time const count) { usleep(ms_max(1, ms_time_to_us(count))); }
 
+ms_time ms_get_time(void) {
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+
+  return ms_time_from_ns((uint64_t)ts.tv_sec * 1000000000llu + (uint64_t)ts.tv_nsec);
+}
+
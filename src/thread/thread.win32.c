@@ -18,6 +18,7 @@ static DWORD WINAPI thread_main(void * const param) {
 
   ms_debugf("Thread %s has started.", ms_get_current_thread_name());
   desc.main(desc.ctx);
+  ms_thread_run_exit_callbacks();
   ms_debugf("Thread %s has terminated.", ms_get_current_thread_name());
 
   return 0;
@@ -80,3 +81,20 @@ bool ms_thread_join(ms_thread *const t) {
 void ms_thread_yield(void) { SwitchToThread(); }
 void ms_thread_sleep(ms_time const count) { Sleep(ms_max(1, ms_time_to_ms(count))); }
 
+ms_time ms_get_time(void) {
+  static LARGE_INTEGER frequency; // Fixed at boot
+  LARGE_INTEGER counter;
+
+  if(frequency.QuadPart == 0) {
+    QueryPerformanceFrequency(&frequency);
+  }
+
+  QueryPerformanceCounter(&counter);
+
+  uint64_t const ticks = (uint64_t)counter.QuadPart;
+  uint64_t const freq = (uint64_t)frequency.QuadPart;
+
+  // Split to avoid overflowing
+  return ms_time_from_ns((ticks / freq) * 1000000000llu + (ticks % freq) * 1000000000llu / freq);
+}
+
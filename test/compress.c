@@ -21,7 +21,7 @@ static void* reallocate(void* p, void * ptr, size_t new_count) {
   return realloc(ptr, new_count);
 }
 
-static ms_allocator g_allocator = { allocate, deallocate, reallocate, NULL };
+static ms_allocator g_allocator = { allocate, deallocate, reallocate, NULL, NULL, NULL, NULL };
 
 MD_CASE(compress_decompress__cycle) {
   char input[] = "some random text to compress";
@@ -0,0 +1,161 @@
+#include <moonsugar/test.h>
+#include <moonsugar/thread-heap.h>
+#include <moonsugar/containers/concurrent-map.h>
+
+#define THREAD_COUNT (4u)
+#define KEY_COUNT (4096u) // Keys per thread
+
+static ms_mheap mheap;
+static ms_cmap map;
+
+static void suite_setup(md_suite * const suite) {
+  ((void)suite);
+  MST_MEMORY_INIT();
+}
+
+static void suite_cleanup(md_suite * const suite) {
+  ((void)suite);
+  MST_MEMORY_DESTROY();
+}
+
+static void each_setup(void *ctx) {
+  ((void)ctx);
+
+  ms_result result MSUNUSED = ms_mheap_construct(
+    &mheap,
+    &(ms_mheap_description) {
+      g_allocator, // allocator
+      4llu * 1024 * 1024, // arena_size
+      4096, // page_size
+      0, // page_flags
+      2 // arena_count
+    }
+  );
+
+  result = ms_cmap_construct(
+    &map,
+    &(ms_cmap_description) {
+      {
+        MS_ALLOCATOR_DEF_MHEAP(mheap),
+        ms_equals_u32,
+        ms_hash_u32,
+        ms_none_test_max_u32,
+        ms_none_set_max_u32,
+        16, // capacity
+        2, // growth_factor
+        sizeof(uint32_t),
+        sizeof(uint32_t)
+      },
+      8 // shard_count
+    }
+  );
+}
+
+static void each_cleanup(void *ctx) {
+  ((void)ctx);
+
+  ms_cmap_destroy(&map);
+  ms_mheap_destroy(&mheap);
+}
+
+MD_CASE(construct) {
+  md_assert(map.shards != NULL);
+  md_assert(map.shard_count == 8);
+  md_assert(ms_cmap_get_count(&map) == 0);
+}
+
+MD_CASE(set) {
+  uint32_t value;
+
+  md_assert(ms_cmap_set(&map, &(uint32_t){1}, &(uint32_t){10}) == MS_RESULT_SUCCESS);
+  md_assert(ms_cmap_set(&map, &(uint32_t){1}, &(uint32_t){11}) == MS_RESULT_SUCCESS);
+
+  md_assert(ms_cmap_get(&map, &(uint32_t){1}, &value));
+  md_assert(value == 11);
+  md_assert(!ms_cmap_get(&map, &(uint32_t){2}, &value));
+
+  md_assert(ms_cmap_remove(&map, &(uint32_t){1}));
+  md_assert(!ms_cmap_remove(&map, &(uint32_t){1}));
+  md_assert(!ms_cmap_get(&map, &(uint32_t){1}, &value));
+}
+
+static ms_result compute_double(void const *const key, void *const out_value, void *const ctx) {
+  ++*(uint32_t*)ctx;
+  *(uint32_t*)out_value = *(uint32_t const*)key * 2;
+
+  return MS_RESULT_SUCCESS;
+}
+
+static ms_result compute_fail(void const *const key, void *const out_value, void *const ctx) {
+  ((void)key);
+  ((void)out_value);
+  ((void)ctx);
+
+  return MS_RESULT_NOT_FOUND;
+}
+
+MD_CASE(compute_if_absent) {
+  uint32_t call_count = 0;
+  uint32_t value;
+
+  md_assert(ms_cmap_compute_if_absent(&map, &(uint32_t){21}, compute_double, &call_count, &value) == MS_RESULT_SUCCESS);
+  md_assert(value == 42);
+  md_assert(ms_cmap_compute_if_absent(&map, &(uint32_t){21}, compute_double, &call_count, &value) == MS_RESULT_SUCCESS);
+  md_assert(value == 42);
+  md_assert(call_count == 1);
+
+  md_assert(ms_cmap_compute_if_absent(&map, &(uint32_t){5}, compute_fail, NULL, &value) == MS_RESULT_NOT_FOUND);
+  md_assert(!ms_cmap_get(&map, &(uint32_t){5}, &value));
+}
+
+static void writer_main(void *const ctx) {
+  uint32_t const first_key = *(uint32_t const*)ctx * KEY_COUNT;
+
+  for(uint32_t key = first_key; key < first_key + KEY_COUNT; ++key) {
+    ms_result const result MSUNUSED = ms_cmap_set(&map, &key, &(uint32_t){key + 1});
+    uint32_t value;
+
+    // Keys written by the other threads are read concurrently
+    ms_cmap_get(&map, &(uint32_t){(key + KEY_COUNT) % (KEY_COUNT * THREAD_COUNT)}, &value);
+  }
+}
+
+MD_CASE(set__concurrent) {
+  ms_thread threads[THREAD_COUNT];
+  uint32_t thread_indices[THREAD_COUNT];
+
+  for(uint32_t i = 0; i < THREAD_COUNT; ++i) {
+    thread_indices[i] = i;
+
+    md_assert(ms_thread_spawn(&threads[i], &(ms_thread_description) { writer_main, NULL, &thread_indices[i] }) == MS_RESULT_SUCCESS);
+  }
+
+  for(uint32_t i = 0; i < THREAD_COUNT; ++i) {
+    ms_thread_join(&threads[i]);
+  }
+
+  md_assert(ms_cmap_get_count(&map) == KEY_COUNT * THREAD_COUNT);
+
+  for(uint32_t key = 0; key < KEY_COUNT * THREAD_COUNT; ++key) {
+    uint32_t value;
+
+    md_assert(ms_cmap_get(&map, &key, &value));
+    md_assert(value == key + 1);
+  }
+}
+
+int main(int argc, char** argv) {
+  md_suite suite = md_suite_create();
+
+  suite.suite_setup = suite_setup;
+  suite.suite_cleanup = suite_cleanup;
+  suite.each_setup = each_setup;
+  suite.each_cleanup = each_cleanup;
+
+  md_add(&suite, construct);
+  md_add(&suite, set);
+  md_add(&suite, compute_if_absent);
+  md_add(&suite, set__concurrent);
+
+  return md_run(argc, argv, &suite);
+}
@@ -1,7 +1,7 @@
 #include <moonsugar/test.h>
 #include <moonsugar/containers/map.h>
 
-static ms_result test_map_construct(ms_map * const map, uint32_t const initial_capacity) {
+static ms_result test_map_construct_growable(ms_map * const map, uint32_t const initial_capacity, uint32_t const growth_factor) {
   return ms_map_construct(map, &(ms_map_description) {
     g_allocator,
     ms_equals_u32,
@@ -9,12 +9,25 @@ static ms_result test_map_construct(ms_map * const map, uint32_t const initial_c
     ms_none_test_max_u32,
     ms_none_set_max_u32,
     initial_capacity,
-    0,
+    growth_factor,
     sizeof(uint32_t),
     sizeof(uint32_t)
   });
 }
 
+static ms_result test_map_construct(ms_map * const map, uint32_t const initial_capacity) {
+  return test_map_construct_growable(map, initial_capacity, 0);
+}
+
+MS_HDECL(test_handle);
+
+MS_MAP_DEFINE(u32_map, uint32_t, uint64_t, MS_MAP_HASH_IDENTITY, MS_MAP_EQUALS)
+
+#define HANDLE_EQUALS(a, b) ms_heq(a, b)
+#define HANDLE_HASH(h) MS_MAP_HASH_IDENTITY((h).raw)
+
+MS_MAP_DEFINE(handle_map, test_handle, uint32_t, HANDLE_HASH, HANDLE_EQUALS)
+
 static void suite_setup(md_suite *suite) { ((void)suite); MST_MEMORY_INIT(); }
 static void suite_cleanup(md_suite *suite) { ((void)suite); MST_MEMORY_DESTROY(); }
 
@@ -68,6 +81,342 @@ MD_CASE(remove) {
   md_assert(ptr2 == NULL);
 }
 
+MD_CASE(set__many) {
+  ms_map map;
+
+  ms_result const result = test_map_construct_growable(&map, 16, 2);
+  md_assert(result == MS_RESULT_SUCCESS);
+
+  for(uint32_t i = 0; i < 4096; ++i) {
+    md_assert(ms_map_set(&map, &i, &(uint32_t){i * 2}) == MS_RESULT_SUCCESS);
+  }
+
+  for(uint32_t i = 0; i < 4096; ++i) {
+    uint32_t *const value = ms_map_get_value(&map, &i);
+
+    md_assert(value != NULL);
+    md_assert(*value == i * 2);
+  }
+
+  md_assert(ms_map_get_value(&map, &(uint32_t){4096}) == NULL);
+
+  ms_map_destroy(&map);
+}
+
+MD_CASE(set__overwrite) {
+  ms_map map;
+
+  ms_result const result = test_map_construct(&map, 16);
+  md_assert(result == MS_RESULT_SUCCESS);
+
+  ms_map_set(&map, &(uint32_t){7}, &(uint32_t){1});
+  ms_map_set(&map, &(uint32_t){7}, &(uint32_t){2});
+
+  md_assert(*(uint32_t*)ms_map_get_value(&map, &(uint32_t){7}) == 2);
+
+  ms_map_remove(&map, &(uint32_t){7});
+  md_assert(ms_map_get_value(&map, &(uint32_t){7}) == NULL);
+
+  ms_map_destroy(&map);
+}
+
+MD_CASE(set__small) { // Capacity below the group size
+  ms_map map;
+
+  ms_result const result = test_map_construct(&map, 4);
+  md_assert(result == MS_RESULT_SUCCESS);
+
+  for(uint32_t i = 0; i < 4; ++i) {
+    md_assert(ms_map_set(&map, &i, &i) == MS_RESULT_SUCCESS);
+  }
+
+  md_assert(ms_map_set(&map, &(uint32_t){4}, &(uint32_t){4}) == MS_RESULT_FULL);
+
+  for(uint32_t i = 0; i < 4; ++i) {
+    md_assert(*(uint32_t*)ms_map_get_value(&map, &i) == i);
+  }
+
+  ms_map_remove(&map, &(uint32_t){2});
+  md_assert(ms_map_get_value(&map, &(uint32_t){2}) == NULL);
+  md_assert(ms_map_set(&map, &(uint32_t){4}, &(uint32_t){4}) == MS_RESULT_SUCCESS);
+  md_assert(*(uint32_t*)ms_map_get_value(&map, &(uint32_t){4}) == 4);
+
+  ms_map_destroy(&map);
+}
+
+static uint64_t hash_cluster(void const *const key) {
+  return *(uint32_t const*)key / 64; // Clusters of 64 keys
+}
+
+static uint64_t hash_constant(void const *const key) {
+  ((void)key);
+  return 0;
+}
+
+MD_CASE(set__load) {
+  ms_map map;
+  ms_map_stats stats;
+
+  md_assert(test_map_construct_growable(&map, 1024, 2) == MS_RESULT_SUCCESS);
+
+  uint32_t const max_count = MS_MAP_GET_MAX_COUNT(1024);
+
+  for(uint32_t i = 0; i < max_count; ++i) {
+    md_assert(ms_map_set(&map, &(uint32_t){i * 4096}, &i) == MS_RESULT_SUCCESS);
+  }
+
+  ms_map_get_stats(&map, &stats);
+
+  md_assert(map.capacity == 1024);
+  md_assert(stats.count == max_count);
+  md_assert(stats.load_factor > 0.85);
+  md_assert(stats.mean_probe < 8.0);
+
+  // One more pair grows the map
+  md_assert(ms_map_set(&map, &(uint32_t){max_count * 4096}, &max_count) == MS_RESULT_SUCCESS);
+  md_assert(map.capacity == 2048);
+  md_assert(map.count == max_count + 1);
+
+  for(uint32_t i = 0; i <= max_count; ++i) {
+    md_assert(*(uint32_t*)ms_map_get_value(&map, &(uint32_t){i * 4096}) == i);
+  }
+
+  ms_map_destroy(&map);
+}
+
+MD_CASE(remove__shift) {
+  ms_map map;
+  ms_map_stats stats;
+
+  md_assert(ms_map_construct(&map, &(ms_map_description) {
+    g_allocator,
+    ms_equals_u32,
+    hash_cluster,
+    ms_none_test_max_u32,
+    ms_none_set_max_u32,
+    1024,
+    0,
+    sizeof(uint32_t),
+    sizeof(uint32_t)
+  }) == MS_RESULT_SUCCESS);
+
+  for(uint32_t i = 0; i < 512; ++i) {
+    md_assert(ms_map_set(&map, &i, &i) == MS_RESULT_SUCCESS);
+  }
+
+  ms_map_get_stats(&map, &stats);
+  md_assert(stats.max_probe > 16); // Probed past the first group
+
+  // Remove every other key - the others shift back
+  for(uint32_t i = 0; i < 512; i += 2) {
+    md_assert(ms_map_remove(&map, &i));
+  }
+
+  md_assert(map.count == 256);
+
+  for(uint32_t i = 0; i < 512; ++i) {
+    uint32_t *const value = ms_map_get_value(&map, &i);
+
+    md_assert(i % 2 == 0 ? value == NULL : *value == i);
+  }
+
+  ms_map_get_stats(&map, &stats);
+  md_assert(stats.count == 256);
+  md_assert(stats.max_probe < 256);
+
+  ms_map_destroy(&map);
+}
+
+MD_CASE(set__probe_overflow) {
+  ms_map map;
+
+  md_assert(ms_map_construct(&map, &(ms_map_description) {
+    g_allocator,
+    ms_equals_u32,
+    hash_constant,
+    ms_none_test_max_u32,
+    ms_none_set_max_u32,
+    1024,
+    0,
+    sizeof(uint32_t),
+    sizeof(uint32_t)
+  }) == MS_RESULT_SUCCESS);
+
+  // 256 keys with the same hash fit, one more exceeds the max probe length
+  for(uint32_t i = 0; i <= MS_MAP_MAX_PROBE; ++i) {
+    md_assert(ms_map_set(&map, &i, &i) == MS_RESULT_SUCCESS);
+  }
+
+  md_assert(ms_map_set(&map, &(uint32_t){MS_MAP_MAX_PROBE + 1}, &(uint32_t){0}) == MS_RESULT_FULL);
+  md_assert(map.count == MS_MAP_MAX_PROBE + 1);
+
+  for(uint32_t i = 0; i <= MS_MAP_MAX_PROBE; ++i) {
+    md_assert(*(uint32_t*)ms_map_get_value(&map, &i) == i);
+  }
+
+  ms_map_destroy(&map);
+}
+
+MD_CASE(next) {
+  ms_map map;
+
+  md_assert(test_map_construct_growable(&map, 16, 2) == MS_RESULT_SUCCESS);
+
+  for(uint32_t i = 0; i < 100; ++i) {
+    md_assert(ms_map_set(&map, &i, &(uint32_t){i + 1}) == MS_RESULT_SUCCESS);
+  }
+
+  uint32_t cursor = 0;
+  uint32_t *key;
+  uint32_t *value;
+  uint64_t key_sum = 0;
+  uint32_t count = 0;
+
+  while(ms_map_next(&map, &cursor, (void**)&key, (void**)&value)) {
+    md_assert(*value == *key + 1);
+    key_sum += *key;
+    ++count;
+  }
+
+  md_assert(count == 100);
+  md_assert(key_sum == 99 * 100 / 2);
+  md_assert(!ms_map_next(&map, &cursor, NULL, NULL));
+
+  ms_map_destroy(&map);
+}
+
+MD_CASE(reserve) {
+  ms_map map;
+
+  md_assert(test_map_construct_growable(&map, 16, 2) == MS_RESULT_SUCCESS);
+  md_assert(ms_map_set(&map, &(uint32_t){1}, &(uint32_t){1}) == MS_RESULT_SUCCESS);
+
+  md_assert(ms_map_reserve(&map, 1000) == MS_RESULT_SUCCESS);
+  md_assert(map.capacity == 2048);
+  md_assert(*(uint32_t*)ms_map_get_value(&map, &(uint32_t){1}) == 1);
+
+  md_assert(ms_map_reserve(&map, 10) == MS_RESULT_SUCCESS); // Never shrinks
+  md_assert(map.capacity == 2048);
+
+  for(uint32_t i = 0; i < 1000; ++i) {
+    md_assert(ms_map_set(&map, &i, &i) == MS_RESULT_SUCCESS);
+  }
+
+  md_assert(map.capacity == 2048);
+
+  ms_map_destroy(&map);
+}
+
+MD_CASE(clear) {
+  ms_map map;
+
+  md_assert(test_map_construct(&map, 64) == MS_RESULT_SUCCESS);
+
+  for(uint32_t i = 0; i < 64; ++i) {
+    md_assert(ms_map_set(&map, &i, &i) == MS_RESULT_SUCCESS);
+  }
+
+  ms_map_clear(&map);
+
+  md_assert(map.count == 0);
+  md_assert(map.capacity == 64);
+  md_assert(ms_map_get_value(&map, &(uint32_t){5}) == NULL);
+  md_assert(*(uint32_t*)MS_MAP_GET_KEY(&map, 5) == UINT32_MAX);
+
+  md_assert(ms_map_set(&map, &(uint32_t){5}, &(uint32_t){6}) == MS_RESULT_SUCCESS);
+  md_assert(*(uint32_t*)ms_map_get_value(&map, &(uint32_t){5}) == 6);
+
+  ms_map_destroy(&map);
+}
+
+MD_CASE(set_many) {
+  ms_map map;
+  uint32_t keys[100];
+  uint32_t values[100];
+  void *found[100];
+
+  md_assert(test_map_construct_growable(&map, 16, 2) == MS_RESULT_SUCCESS);
+
+  for(uint32_t i = 0; i < 100; ++i) {
+    keys[i] = i * 2;
+    values[i] = i;
+  }
+
+  md_assert(ms_map_set_many(&map, 100, keys, values) == MS_RESULT_SUCCESS);
+  md_assert(map.count == 100);
+
+  md_assert(ms_map_get_many(&map, 100, keys, found) == 100);
+
+  for(uint32_t i = 0; i < 100; ++i) {
+    md_assert(*(uint32_t*)found[i] == i);
+  }
+
+  // Odd keys are missing
+  for(uint32_t i = 0; i < 100; ++i) {
+    keys[i] = i;
+  }
+
+  md_assert(ms_map_get_many(&map, 100, keys, found) == 50);
+
+  for(uint32_t i = 0; i < 100; ++i) {
+    md_assert(i % 2 == 0 ? *(uint32_t*)found[i] == i / 2 : found[i] == NULL);
+  }
+
+  ms_map_destroy(&map);
+}
+
+MD_CASE(typed) {
+  ms_map map;
+
+  md_assert(u32_map_construct(&map, g_allocator, 16, 2) == MS_RESULT_SUCCESS);
+
+  for(uint32_t i = 0; i < 1024; ++i) {
+    md_assert(u32_map_set(&map, i, (uint64_t)i << 32) == MS_RESULT_SUCCESS);
+  }
+
+  for(uint32_t i = 0; i < 1024; ++i) {
+    uint64_t *const value = u32_map_get(&map, i);
+
+    md_assert(value != NULL);
+    md_assert(*value == (uint64_t)i << 32);
+  }
+
+  md_assert(u32_map_get(&map, 1024) == NULL);
+  md_assert(u32_map_remove(&map, 10));
+  md_assert(!u32_map_remove(&map, 10));
+  md_assert(u32_map_get(&map, 10) == NULL);
+
+  // Generic functions work on typed maps
+  md_assert(*(uint64_t*)ms_map_get_value(&map, &(uint32_t){11}) == 11llu << 32);
+
+  uint32_t cursor = 0;
+  uint32_t *key;
+  uint64_t *value;
+  uint32_t count = 0;
+
+  while(u32_map_next(&map, &cursor, &key, &value)) {
+    md_assert(*value == (uint64_t)*key << 32);
+    ++count;
+  }
+
+  md_assert(count == 1023);
+
+  ms_map_destroy(&map);
+}
+
+MD_CASE(typed__handle) {
+  ms_map map;
+
+  md_assert(handle_map_construct(&map, g_allocator, 64, 0) == MS_RESULT_SUCCESS);
+  md_assert(handle_map_set(&map, (test_handle) { 5 }, 50) == MS_RESULT_SUCCESS);
+  md_assert(handle_map_set(&map, (test_handle) { 5 }, 51) == MS_RESULT_SUCCESS);
+
+  md_assert(*handle_map_get(&map, (test_handle) { 5 }) == 51);
+  md_assert(handle_map_get(&map, (test_handle) { 6 }) == NULL);
+
+  ms_map_destroy(&map);
+}
+
 int main(int argc, char **argv) {
   md_suite suite = md_suite_create();
 
@@ -78,6 +427,18 @@ int main(int argc, char **argv) {
   md_add(&suite, construct__capacity_not_power_2);
   md_add(&suite, get);
   md_add(&suite, remove);
+  md_add(&suite, set__many);
+  md_add(&suite, set__overwrite);
+  md_add(&suite, set__small);
+  md_add(&suite, set__load);
+  md_add(&suite, remove__shift);
+  md_add(&suite, set__probe_overflow);
+  md_add(&suite, next);
+  md_add(&suite, reserve);
+  md_add(&suite, clear);
+  md_add(&suite, set_many);
+  md_add(&suite, typed);
+  md_add(&suite, typed__handle);
 
   return md_run(argc, argv, &suite);
 }
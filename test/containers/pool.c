@@ -40,6 +40,37 @@ MD_CASE(release) {
   md_assert(pool.items->next = old_items);
 }
 
+static bool fail_malloc;
+
+static void *failing_malloc(void * const user, size_t const count, size_t const alignment) {
+  return fail_malloc ? NULL : ms_heap_malloc(user, count, alignment);
+}
+
+MD_CASE(acquire__failure) {
+  ms_pool failing_pool;
+  ms_allocator allocator = g_allocator;
+
+  allocator.allocate = failing_malloc;
+  md_assert(ms_pool_construct(&failing_pool, &(ms_pool_description) {allocator, sizeof(int), 2}) == MS_RESULT_SUCCESS);
+
+  int* const p1 = ms_pool_acquire(&failing_pool);
+  int* const p2 = ms_pool_acquire(&failing_pool);
+
+  // The page array grows, but the page allocation fails
+  fail_malloc = true;
+  md_assert(ms_pool_acquire(&failing_pool) == NULL);
+  md_assert(failing_pool.item_count == 2);
+  md_assert(failing_pool.pages != NULL);
+  fail_malloc = false;
+
+  md_assert(ms_pool_acquire(&failing_pool) != NULL);
+  md_assert(failing_pool.item_count == 4);
+
+  ms_pool_release(&failing_pool, p2);
+  ms_pool_release(&failing_pool, p1);
+  ms_pool_destroy(&failing_pool);
+}
+
 int main(int argc, char **argv) {
   md_suite suite = md_suite_create();
 
@@ -52,6 +83,7 @@ int main(int argc, char **argv) {
   md_add(&suite, ctor);
   md_add(&suite, acquire);
   md_add(&suite, release);
+  md_add(&suite, acquire__failure);
 
   return md_run(argc, argv, &suite);
 }
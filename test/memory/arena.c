@@ -22,7 +22,8 @@ void each_setup(void *ctx) {
   ms_arena_description const description = {
     ARENA_BASE_SIZE,
     MS_ALLOCATOR_DEF_HEAP(g_heap),
-    0
+    0,
+    0 // page_flags
   };
 
   ms_arena_construct(&arena, &description);
@@ -33,7 +34,32 @@ void each_setup_sticky(void *ctx) {
   ms_arena_description const description = {
     ARENA_BASE_SIZE,
     MS_ALLOCATOR_DEF_HEAP(g_heap),
-    MS_ARENA_STICKY_BIT
+    MS_ARENA_STICKY_BIT,
+    0 // page_flags
+  };
+
+  ms_arena_construct(&arena, &description);
+}
+
+void each_setup_linear(void *ctx) {
+  ((void)ctx);
+  ms_arena_description const description = {
+    ARENA_BASE_SIZE,
+    MS_ALLOCATOR_DEF_HEAP(g_heap),
+    MS_ARENA_LINEAR_BIT,
+    0 // page_flags
+  };
+
+  ms_arena_construct(&arena, &description);
+}
+
+void each_setup_linear_sticky(void *ctx) {
+  ((void)ctx);
+  ms_arena_description const description = {
+    ARENA_BASE_SIZE,
+    MS_ALLOCATOR_DEF_HEAP(g_heap),
+    MS_ARENA_LINEAR_BIT | MS_ARENA_STICKY_BIT,
+    0 // page_flags
   };
 
   ms_arena_construct(&arena, &description);
@@ -154,6 +180,60 @@ MD_CASE(inverse_free) {
   md_assert(arena.first == NULL);
 }
 
+// Empty nodes are unlinked without dropping the nodes chained after them
+MD_CASE(free__chained) {
+  // Each allocation does not fit in the previous node
+  void * const ptr1 = ms_arena_malloc(&arena, 8, MS_DEFAULT_ALIGNMENT);
+  void * const ptr2 = ms_arena_malloc(&arena, ARENA_BASE_SIZE * 2, MS_DEFAULT_ALIGNMENT);
+  void * const ptr3 = ms_arena_malloc(&arena, ARENA_BASE_SIZE * 32, MS_DEFAULT_ALIGNMENT);
+
+  md_assert(arena.first->next->next != NULL);
+
+  ms_arena_free(&arena, ptr2);
+  md_assert(arena.first->next != NULL);
+  md_assert(arena.first->next->next == NULL);
+  md_assert(arena.first->next->prev == arena.first);
+
+  ms_arena_free(&arena, ptr1);
+  md_assert(arena.first != NULL);
+  md_assert(arena.first->prev == NULL);
+
+  ms_arena_free(&arena, ptr3);
+  md_assert(arena.first == NULL);
+}
+
+MD_CASE(free__other_arena) {
+  ms_arena other;
+  ms_arena_description const description = {
+    ARENA_BASE_SIZE,
+    MS_ALLOCATOR_DEF_HEAP(g_heap),
+    0, // flags
+    0 // page_flags
+  };
+
+  ms_arena_construct(&other, &description);
+
+  void * const ptr = ms_arena_malloc(&arena, 8, MS_DEFAULT_ALIGNMENT);
+  void * const other_ptr = ms_arena_malloc(&other, 8, MS_DEFAULT_ALIGNMENT);
+
+  // Rejected, leaving both arenas untouched
+  ms_arena_free(&other, ptr);
+  ms_arena_free(&arena, other_ptr);
+
+  md_assert(arena.first != NULL);
+  md_assert(arena.first->allocated_size > 0);
+  md_assert(other.first != NULL);
+  md_assert(other.first->allocated_size > 0);
+
+  ms_arena_free(&arena, ptr);
+  ms_arena_free(&other, other_ptr);
+
+  md_assert(arena.first == NULL);
+  md_assert(other.first == NULL);
+
+  ms_arena_destroy(&other);
+}
+
 MD_CASE(static_constraints) {
   md_assert((MS_HEAP_DEALLOC_THR) >= sizeof(ms_free_list_node));
 }
@@ -177,6 +257,136 @@ MD_CASE(clear__sticky) { // Arena here is sticky
   md_assert(ptr1 == ptr2);
 }
 
+MD_CASE(linear) { // Arena here is linear
+  uint8_t * const ptr1 = ms_arena_malloc(&arena, 8, MS_DEFAULT_ALIGNMENT);
+  uint8_t * const ptr2 = ms_arena_malloc(&arena, 8, MS_DEFAULT_ALIGNMENT);
+  uint8_t * const ptr3 = ms_arena_malloc(&arena, 8, 64);
+
+  md_assert(ptr1 != NULL);
+  md_assert(ptr2 == ptr1 + 8); // No header
+  md_assert(((uintptr_t)ptr3 & 63) == 0);
+}
+
+MD_CASE(linear__chained) { // Arena here is linear
+  void * const ptr1 = ms_arena_malloc(&arena, ARENA_BASE_SIZE, MS_DEFAULT_ALIGNMENT);
+  void * const ptr2 = ms_arena_malloc(&arena, ARENA_BASE_SIZE * 16, MS_DEFAULT_ALIGNMENT); // Past the first node
+
+  md_assert(ptr1 != NULL);
+  md_assert(ptr2 != NULL);
+  md_assert(arena.first->next != NULL);
+  md_assert(arena.current == arena.first->next);
+}
+
+MD_CASE(linear__realloc) { // Arena here is linear
+  uint8_t * const ptr = ms_arena_malloc(&arena, 16, MS_DEFAULT_ALIGNMENT);
+  md_assert(ptr != NULL);
+
+  for(uint8_t i = 0; i < 16; ++i) {
+    ptr[i] = i;
+  }
+
+  uint8_t * const new_ptr = ms_arena_realloc(&arena, ptr, ARENA_BASE_SIZE * 4);
+  md_assert(new_ptr != NULL);
+
+  for(uint8_t i = 0; i < 16; ++i) {
+    md_assert(new_ptr[i] == i);
+  }
+
+#ifdef MS_FEAT_MEMORY_STATS
+  ms_memory_stats stats;
+  ms_arena_get_stats(&arena, &stats);
+
+  md_assert(stats.alloc_count == 2);
+  md_assert(stats.peak_live_size == 16 + ARENA_BASE_SIZE * 4);
+#endif // MS_FEAT_MEMORY_STATS
+}
+
+MD_CASE(linear__clear) { // Arena here is linear and sticky
+  void * const ptr1 = ms_arena_malloc(&arena, ARENA_BASE_SIZE, MS_DEFAULT_ALIGNMENT);
+  void * const ptr2 = ms_arena_malloc(&arena, ARENA_BASE_SIZE, MS_DEFAULT_ALIGNMENT);
+
+  ms_arena_clear(&arena);
+  md_assert(arena.current == arena.first);
+
+  md_assert(ms_arena_malloc(&arena, ARENA_BASE_SIZE, MS_DEFAULT_ALIGNMENT) == ptr1);
+  md_assert(ms_arena_malloc(&arena, ARENA_BASE_SIZE, MS_DEFAULT_ALIGNMENT) == ptr2);
+}
+
+MD_CASE(linear__rollback) { // Arena here is linear
+  md_assert(ms_arena_malloc(&arena, 8, MS_DEFAULT_ALIGNMENT) != NULL);
+  ms_arena_savepoint const outer = ms_arena_save(&arena);
+
+  void * const ptr2 = ms_arena_malloc(&arena, 8, MS_DEFAULT_ALIGNMENT);
+  ms_arena_savepoint const inner = ms_arena_save(&arena);
+
+  (void)ms_arena_malloc(&arena, ARENA_BASE_SIZE * 4, MS_DEFAULT_ALIGNMENT);
+  md_assert(arena.first->next != NULL);
+
+  ms_arena_rollback(&arena, &inner);
+  md_assert(arena.first->next == NULL);
+
+  ms_arena_rollback(&arena, &outer);
+  md_assert(ms_arena_malloc(&arena, 8, MS_DEFAULT_ALIGNMENT) == ptr2);
+
+  ms_arena_savepoint const empty = { NULL, 0, 0 };
+  ms_arena_rollback(&arena, &empty);
+  md_assert(arena.first == NULL);
+  md_assert(ms_arena_malloc(&arena, 8, MS_DEFAULT_ALIGNMENT) != NULL);
+}
+
+MD_CASE(get_stats) {
+  ms_memory_stats stats;
+
+  ms_arena_get_stats(&arena, &stats);
+  md_assert(stats.reserved_size == 0);
+  md_assert(stats.live_size == 0);
+  md_assert(stats.free_node_count == 0);
+
+  void * const ptr1 = ms_arena_malloc(&arena, 64, MS_DEFAULT_ALIGNMENT);
+  void * const ptr2 = ms_arena_malloc(&arena, 64, MS_DEFAULT_ALIGNMENT);
+  size_t const chunk_size = ms_arena_get_header(ptr1)->size;
+
+  ms_arena_free(&arena, ptr1);
+  ms_arena_get_stats(&arena, &stats);
+
+  md_assert(stats.reserved_size == arena.first->total_size + sizeof(ms_arena_node));
+  md_assert(stats.committed_size == stats.reserved_size);
+  md_assert(stats.live_size == ms_arena_get_header(ptr2)->size);
+  md_assert(stats.free_node_count == 2);
+  md_assert(stats.free_size == arena.first->total_size - stats.live_size);
+  md_assert(stats.largest_free_size == stats.free_size - chunk_size);
+  md_assert(stats.fragmentation > 0.0);
+
+#ifdef MS_FEAT_MEMORY_STATS
+  md_assert(stats.alloc_count == 2);
+  md_assert(stats.free_count == 1);
+  md_assert(stats.peak_live_size == chunk_size + stats.live_size);
+#endif // MS_FEAT_MEMORY_STATS
+
+  ms_arena_free(&arena, ptr2);
+}
+
+MD_CASE(linear__get_stats) {
+  ms_memory_stats stats;
+
+  void * const ptr MSUNUSED = ms_arena_malloc(&arena, 64, MS_DEFAULT_ALIGNMENT);
+  ms_arena_get_stats(&arena, &stats);
+
+  md_assert(stats.live_size == 64);
+  md_assert(stats.free_node_count == 1);
+  md_assert(stats.free_size == arena.first->total_size - 64);
+  md_assert(stats.fragmentation == 0.0);
+
+  ms_arena_clear(&arena);
+  ms_arena_get_stats(&arena, &stats);
+  md_assert(stats.live_size == 0);
+
+#ifdef MS_FEAT_MEMORY_STATS
+  md_assert(stats.alloc_count == 1);
+  md_assert(stats.peak_live_size == 64);
+#endif // MS_FEAT_MEMORY_STATS
+}
+
 int main(int argc, char** argv) {
   md_suite suite = md_suite_create();
 
@@ -197,13 +407,30 @@ int main(int argc, char** argv) {
   md_add(&suite, realloc_more_cross_page_boundary);
   md_add(&suite, realloc_zero);
   md_add(&suite, inverse_free);
+  md_add(&suite, free__chained);
+  md_add(&suite, free__other_arena);
   md_add(&suite, static_constraints);
+  md_add(&suite, get_stats);
   md_add(&suite, clear);
   md_case * const sticky_case = md_add(&suite, sticky);
   md_case * const clear__sticky_case = md_add(&suite, clear__sticky);
 
+  md_case * const linear_cases[] = {
+    md_add(&suite, linear),
+    md_add(&suite, linear__chained),
+    md_add(&suite, linear__realloc),
+    md_add(&suite, linear__rollback),
+    md_add(&suite, linear__get_stats)
+  };
+  md_case * const linear__clear_case = md_add(&suite, linear__clear);
+
   sticky_case->setup = each_setup_sticky;
   clear__sticky_case->setup = each_setup_sticky;
+  linear__clear_case->setup = each_setup_linear_sticky;
+
+  for(size_t i = 0; i < sizeof(linear_cases) / sizeof(linear_cases[0]); ++i) {
+    linear_cases[i]->setup = each_setup_linear;
+  }
 
   return md_run(argc, argv, &suite);
 }
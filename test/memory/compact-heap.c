@@ -0,0 +1,171 @@
+#include <string.h>
+#include <moonsugar/test.h>
+#include <moonsugar/compact-heap.h>
+
+static ms_compact_heap heap;
+
+#define HEAP_SIZE (64llu * 1024)
+#define BLOCK_SIZE (1000u)
+#define BLOCK_COUNT (32u)
+
+static void suite_setup(md_suite * const suite) {
+  ((void)suite);
+  MST_MEMORY_INIT();
+}
+
+static void suite_cleanup(md_suite * const suite) {
+  ((void)suite);
+  MST_MEMORY_DESTROY();
+}
+
+static void each_setup(void *ctx) {
+  ((void)ctx);
+
+  ms_result const result MSUNUSED = ms_compact_heap_construct(
+    &heap,
+    &(ms_compact_heap_description) {
+      g_allocator, // allocator
+      HEAP_SIZE, // size
+      64 // handle_capacity
+    }
+  );
+}
+
+static void each_cleanup(void *ctx) {
+  ((void)ctx);
+  ms_compact_heap_destroy(&heap);
+}
+
+/**
+ * Allocate blocks filled with their index, then free the even ones.
+ */
+static void fragment(ms_compact_handle *const handles) {
+  for(uint32_t i = 0; i < BLOCK_COUNT; ++i) {
+    handles[i] = ms_compact_heap_malloc(&heap, BLOCK_SIZE);
+    memset(ms_compact_heap_resolve(&heap, handles[i]), (int)i, BLOCK_SIZE);
+  }
+
+  for(uint32_t i = 0; i < BLOCK_COUNT; i += 2) {
+    ms_compact_heap_free(&heap, handles[i]);
+  }
+}
+
+static bool check_block(ms_compact_handle const handle, uint8_t const value) {
+  uint8_t const *const ptr = ms_compact_heap_resolve(&heap, handle);
+
+  for(uint32_t i = 0; i < BLOCK_SIZE; ++i) {
+    if(ptr[i] != value) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+MD_CASE(malloc) {
+  ms_compact_handle const a = ms_compact_heap_malloc(&heap, BLOCK_SIZE);
+  ms_compact_handle const b = ms_compact_heap_malloc(&heap, 1);
+
+  md_assert(ms_his_valid(a));
+  md_assert(ms_his_valid(b));
+  md_assert(!ms_heq(a, b));
+  md_assert(ms_compact_heap_get_size(&heap, a) >= BLOCK_SIZE);
+  md_assert(ms_is_multiple((uint64_t)ms_compact_heap_resolve(&heap, b), MS_COMPACT_HEAP_ALIGNMENT));
+  md_assert(!ms_his_valid(ms_compact_heap_malloc(&heap, 0)));
+  md_assert(!ms_his_valid(ms_compact_heap_malloc(&heap, HEAP_SIZE)));
+
+  ms_compact_heap_free(&heap, b);
+  ms_compact_heap_free(&heap, a);
+
+  md_assert(heap.top == heap.base);
+}
+
+MD_CASE(malloc__handle_growth) {
+  ms_compact_handle handles[100];
+
+  for(uint32_t i = 0; i < 100; ++i) {
+    handles[i] = ms_compact_heap_malloc(&heap, 16);
+    md_assert(ms_his_valid(handles[i]));
+  }
+
+  md_assert(heap.handles.item_count >= 100);
+
+  for(uint32_t i = 0; i < 100; ++i) {
+    ms_compact_heap_free(&heap, handles[i]);
+  }
+}
+
+MD_CASE(compact) {
+  ms_compact_handle handles[BLOCK_COUNT];
+
+  fragment(handles);
+
+  uint8_t *const old_top = heap.top;
+
+  md_assert(ms_compact_heap_compact(&heap, MS_TIME_INFINITY));
+  md_assert(heap.free_size == 0);
+  md_assert(heap.top < old_top);
+
+  for(uint32_t i = 1; i < BLOCK_COUNT; i += 2) {
+    md_assert(check_block(handles[i], (uint8_t)i));
+  }
+
+  md_assert(ms_compact_heap_compact(&heap, MS_TIME_INFINITY)); // Nothing to do
+}
+
+MD_CASE(compact__incremental) {
+  ms_compact_handle handles[BLOCK_COUNT];
+
+  fragment(handles);
+
+  uint32_t step_count = 1;
+
+  while(!ms_compact_heap_compact(&heap, 0)) {
+    ++step_count;
+
+    // Blocks can be allocated and freed between steps
+    ms_compact_handle const handle = ms_compact_heap_malloc(&heap, 16);
+    ms_compact_heap_free(&heap, handle);
+  }
+
+  md_assert(step_count > 1);
+
+  for(uint32_t i = 1; i < BLOCK_COUNT; i += 2) {
+    md_assert(check_block(handles[i], (uint8_t)i));
+  }
+}
+
+MD_CASE(malloc__compacts) {
+  ms_compact_handle handles[BLOCK_COUNT];
+
+  fragment(handles);
+
+  // Fill the top, then allocate more than the space left
+  while(ms_compact_heap_malloc(&heap, BLOCK_SIZE).raw != MS_HINVALID && (uint64_t)(heap.base + heap.size - heap.top) > BLOCK_SIZE * 4);
+
+  ms_compact_handle const large = ms_compact_heap_malloc(&heap, BLOCK_SIZE * 8);
+
+  md_assert(ms_his_valid(large));
+  md_assert(heap.free_size == 0);
+
+  for(uint32_t i = 1; i < BLOCK_COUNT; i += 2) {
+    md_assert(check_block(handles[i], (uint8_t)i));
+  }
+}
+
+int main(int argc, char** argv) {
+  md_suite suite = md_suite_create();
+
+  suite.suite_setup = suite_setup;
+  suite.suite_cleanup = suite_cleanup;
+  suite.each_setup = each_setup;
+  suite.each_cleanup = each_cleanup;
+
+  md_add(&suite, malloc);
+  md_add(&suite, malloc__handle_growth);
+  md_add(&suite, compact);
+  md_add(&suite, compact__incremental);
+  md_add(&suite, malloc__compacts);
+
+  return md_run(argc, argv, &suite);
+}
@@ -0,0 +1,232 @@
+#include <moonsugar/test.h>
+#include <moonsugar/slab.h>
+#include <moonsugar/compose.h>
+
+static ms_heap primary_heap;
+static ms_heap secondary_heap;
+static ms_slab slab;
+
+#define PRIMARY_HEAP_SIZE (64u * 1024u)
+#define SECONDARY_HEAP_SIZE (256u * 1024u)
+#define PAGE_SIZE (1024u)
+#define THRESHOLD (256u)
+
+#define ROUTED_HEAP(heap) (ms_routed_allocator) { MS_ALLOCATOR_DEF_HEAP(heap), (ms_owns_clbk)ms_heap_owns, (ms_size_clbk)ms_heap_get_block_size }
+#define ROUTED_SLAB(slab) (ms_routed_allocator) { MS_ALLOCATOR_DEF_SLAB(slab), NULL, (ms_size_clbk)ms_slab_get_size }
+#define ROUTED_DEFAULT (ms_routed_allocator) { g_allocator, NULL, NULL }
+
+static void fill(uint8_t *const ptr, size_t const count) {
+  for(size_t i = 0; i < count; ++i) {
+    ptr[i] = (uint8_t)i;
+  }
+}
+
+static bool is_filled(uint8_t const *const ptr, size_t const count) {
+  for(size_t i = 0; i < count; ++i) {
+    if(ptr[i] != (uint8_t)i) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+static void suite_setup(md_suite * const suite) {
+  ((void)suite);
+  MST_MEMORY_INIT();
+}
+
+static void suite_cleanup(md_suite * const suite) {
+  ((void)suite);
+  MST_MEMORY_DESTROY();
+}
+
+static void each_setup(void *ctx) {
+  ((void)ctx);
+
+  ms_heap_construct(&primary_heap, PRIMARY_HEAP_SIZE, PAGE_SIZE, 0);
+  ms_heap_construct(&secondary_heap, SECONDARY_HEAP_SIZE, PAGE_SIZE, 0);
+  ms_result const result MSUNUSED = ms_slab_construct(&slab, &(ms_slab_description) { g_allocator, 4096 });
+}
+
+static void each_cleanup(void *ctx) {
+  ((void)ctx);
+
+  ms_slab_destroy(&slab);
+  ms_heap_destroy(&secondary_heap);
+  ms_heap_destroy(&primary_heap);
+}
+
+MD_CASE(fallback) {
+  ms_fallback fallback;
+  ms_fallback_description const description = { ROUTED_HEAP(primary_heap), ROUTED_DEFAULT };
+
+  md_assert(ms_fallback_construct(&fallback, &description) == MS_RESULT_SUCCESS);
+
+  ms_allocator const allocator = MS_ALLOCATOR_DEF_FALLBACK(fallback);
+  void *const a = ms_malloc(&allocator, 1024, MS_DEFAULT_ALIGNMENT);
+  void *const b = ms_malloc(&allocator, PRIMARY_HEAP_SIZE, MS_DEFAULT_ALIGNMENT); // Too large for the primary
+
+  md_assert(ms_heap_owns(&primary_heap, a));
+  md_assert(ms_heap_owns(&g_heap, b));
+
+  void *const new_b = ms_realloc(&allocator, b, PRIMARY_HEAP_SIZE * 2);
+  md_assert(ms_heap_owns(&g_heap, new_b));
+
+  ms_free(&allocator, a);
+  ms_free(&allocator, new_b);
+}
+
+MD_CASE(fallback__realloc) {
+  ms_fallback fallback;
+  ms_fallback_description const description = { ROUTED_HEAP(primary_heap), ROUTED_DEFAULT };
+
+  md_assert(ms_fallback_construct(&fallback, &description) == MS_RESULT_SUCCESS);
+
+  ms_allocator const allocator = MS_ALLOCATOR_DEF_FALLBACK(fallback);
+  uint8_t *const a = ms_malloc(&allocator, 1024, MS_DEFAULT_ALIGNMENT);
+  void *const b = ms_malloc(&allocator, PRIMARY_HEAP_SIZE / 2, MS_DEFAULT_ALIGNMENT); // Blocks the growth of a
+
+  md_assert(ms_heap_owns(&primary_heap, a));
+  md_assert(ms_heap_owns(&primary_heap, b));
+
+  fill(a, 1024);
+
+  // The primary cannot host the block anymore
+  uint8_t *const new_a = ms_realloc(&allocator, a, PRIMARY_HEAP_SIZE / 2);
+
+  md_assert(new_a != NULL);
+  md_assert(ms_heap_owns(&g_heap, new_a));
+  md_assert(is_filled(new_a, 1024));
+
+  ms_free(&allocator, new_a);
+  ms_free(&allocator, b);
+
+  ms_memory_stats stats;
+  ms_heap_get_stats(&primary_heap, &stats);
+  md_assert(stats.live_size == 0);
+}
+
+MD_CASE(fallback__no_owner) {
+  ms_fallback fallback;
+  ms_fallback_description const description = { ROUTED_DEFAULT, ROUTED_DEFAULT };
+
+  md_assert(ms_fallback_construct(&fallback, &description) == MS_RESULT_INVALID_ARGUMENT);
+}
+
+MD_CASE(segregator) {
+  ms_segregator segregator;
+  ms_segregator_description const description = { ROUTED_SLAB(slab), ROUTED_HEAP(primary_heap), THRESHOLD };
+
+  md_assert(ms_segregator_construct(&segregator, &description) == MS_RESULT_SUCCESS);
+
+  ms_allocator const allocator = MS_ALLOCATOR_DEF_SEGREGATOR(segregator);
+  void *const small = ms_malloc(&allocator, THRESHOLD, MS_DEFAULT_ALIGNMENT);
+  void *const large = ms_malloc(&allocator, THRESHOLD + 1, MS_DEFAULT_ALIGNMENT);
+
+  md_assert(ms_heap_owns(&g_heap, small)); // Slab pages are drawn from the parent
+  md_assert(ms_heap_owns(&primary_heap, large));
+
+  void *const new_large = ms_realloc(&allocator, large, 2048);
+  md_assert(ms_heap_owns(&primary_heap, new_large));
+
+  void *const new_small = ms_realloc(&allocator, small, 16);
+  md_assert(ms_heap_owns(&g_heap, new_small));
+
+  ms_free(&allocator, new_small);
+  ms_free(&allocator, new_large);
+}
+
+MD_CASE(segregator__realloc_cross) {
+  ms_segregator segregator;
+  ms_segregator_description const description = { ROUTED_SLAB(slab), ROUTED_HEAP(primary_heap), THRESHOLD };
+
+  md_assert(ms_segregator_construct(&segregator, &description) == MS_RESULT_SUCCESS);
+
+  ms_allocator const allocator = MS_ALLOCATOR_DEF_SEGREGATOR(segregator);
+  uint8_t *const small = ms_malloc(&allocator, 100, MS_DEFAULT_ALIGNMENT);
+
+  fill(small, 100);
+
+  // Small to large
+  uint8_t *const large = ms_realloc(&allocator, small, THRESHOLD + 1);
+
+  md_assert(ms_heap_owns(&primary_heap, large));
+  md_assert(is_filled(large, 100));
+
+  fill(large, THRESHOLD + 1);
+
+  // Large to small
+  uint8_t *const new_small = ms_realloc(&allocator, large, 32);
+
+  md_assert(!ms_heap_owns(&primary_heap, new_small));
+  md_assert(is_filled(new_small, 32));
+
+  ms_free(&allocator, new_small);
+
+  ms_memory_stats stats;
+  ms_heap_get_stats(&primary_heap, &stats);
+  md_assert(stats.live_size == 0);
+}
+
+MD_CASE(bucketizer) {
+  ms_bucketizer bucketizer;
+  ms_bucket const buckets[] = {
+    { ROUTED_SLAB(slab), 64 },
+    { ROUTED_HEAP(primary_heap), 4096 },
+    { ROUTED_HEAP(secondary_heap), 65536 } // Must not own the slab pages
+  };
+  ms_bucketizer_description const description = { buckets, 3 };
+
+  md_assert(ms_bucketizer_construct(&bucketizer, &description) == MS_RESULT_SUCCESS);
+  md_assert(bucketizer.default_owner == 0);
+
+  ms_allocator const allocator = MS_ALLOCATOR_DEF_BUCKETIZER(bucketizer);
+  void *const a = ms_malloc(&allocator, 64, MS_DEFAULT_ALIGNMENT);
+  void *const b = ms_malloc(&allocator, 65, MS_DEFAULT_ALIGNMENT);
+  void *const c = ms_malloc(&allocator, 4097, MS_DEFAULT_ALIGNMENT);
+
+  md_assert(!ms_heap_owns(&primary_heap, a));
+  md_assert(ms_heap_owns(&primary_heap, b));
+  md_assert(ms_heap_owns(&secondary_heap, c));
+  md_assert(ms_malloc(&allocator, 65537, MS_DEFAULT_ALIGNMENT) == NULL);
+
+  ms_free(&allocator, a);
+  ms_free(&allocator, b);
+  ms_free(&allocator, c);
+}
+
+MD_CASE(bucketizer__invalid) {
+  ms_bucketizer bucketizer;
+  ms_bucket const unsorted[] = {
+    { ROUTED_HEAP(primary_heap), 4096 },
+    { ROUTED_HEAP(secondary_heap), 64 }
+  };
+  ms_bucket const no_owner[] = {
+    { ROUTED_SLAB(slab), 64 },
+    { ROUTED_DEFAULT, 4096 }
+  };
+
+  md_assert(ms_bucketizer_construct(&bucketizer, &(ms_bucketizer_description) { unsorted, 2 }) == MS_RESULT_INVALID_ARGUMENT);
+  md_assert(ms_bucketizer_construct(&bucketizer, &(ms_bucketizer_description) { no_owner, 2 }) == MS_RESULT_INVALID_ARGUMENT);
+  md_assert(ms_bucketizer_construct(&bucketizer, &(ms_bucketizer_description) { no_owner, 0 }) == MS_RESULT_INVALID_ARGUMENT);
+}
+
+int main(int argc, char** argv) {
+  md_suite suite = md_suite_create();
+
+  suite.suite_setup = suite_setup;
+  suite.suite_cleanup = suite_cleanup;
+  suite.each_setup = each_setup;
+  suite.each_cleanup = each_cleanup;
+
+  md_add(&suite, fallback);
+  md_add(&suite, fallback__realloc);
+  md_add(&suite, fallback__no_owner);
+  md_add(&suite, segregator);
+  md_add(&suite, segregator__realloc_cross);
+  md_add(&suite, bucketizer);
+  md_add(&suite, bucketizer__invalid);
+
+  return md_run(argc, argv, &suite);
+}
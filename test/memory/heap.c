@@ -8,7 +8,12 @@ static ms_heap heap;
 
 void each_setup(void *ctx) {
   ((void)ctx);
-  ms_heap_construct(&heap, HEAP_SIZE, PAGE_SIZE);
+  ms_heap_construct(&heap, HEAP_SIZE, PAGE_SIZE, 0);
+}
+
+void each_setup_huge(void *ctx) {
+  ((void)ctx);
+  ms_heap_construct(&heap, HEAP_SIZE, PAGE_SIZE, MS_PAGE_HUGE_BIT);
 }
 
 void each_cleanup(void *ctx) {
@@ -95,7 +100,7 @@ MD_CASE(realloc_more_cross_page_boundary) {
 
   void * const ptr_after = ms_heap_realloc(&heap, ptr_before, 1024);
   md_assert(ptr_after != NULL);
-  md_assert(ptr_after != ptr_before);
+  md_assert(ptr_after == ptr_before); // Grown into the free memory that follows
 
   hdr = ms_heap_get_header(ptr_after);
 
@@ -118,6 +123,57 @@ MD_CASE(realloc_zero) {
   md_assert(ptr_after == NULL);
 }
 
+MD_CASE(realloc__grow_in_place) {
+  uint8_t * const ptr_before = ms_heap_malloc(&heap, PAGE_SIZE, MS_DEFAULT_ALIGNMENT);
+  md_assert(ptr_before != NULL);
+
+  for(unsigned i = 0; i < PAGE_SIZE; ++i) {
+    ptr_before[i] = (uint8_t)i;
+  }
+
+  uint8_t * const ptr_after = ms_heap_realloc(&heap, ptr_before, 4 * PAGE_SIZE);
+  md_assert(ptr_after == ptr_before);
+  md_assert(ms_heap_get_header(ptr_after)->size >= 4 * PAGE_SIZE);
+
+  for(unsigned i = 0; i < PAGE_SIZE; ++i) {
+    md_assert(ptr_after[i] == (uint8_t)i);
+  }
+
+  ptr_after[4 * PAGE_SIZE - 1] = 1;
+
+  ms_heap_free(&heap, ptr_after);
+  md_assert(heap.free_list.first->size == HEAP_SIZE);
+}
+
+MD_CASE(realloc__grow_blocked) {
+  void * const ptr_before = ms_heap_malloc(&heap, PAGE_SIZE, MS_DEFAULT_ALIGNMENT);
+  void * const blocker = ms_heap_malloc(&heap, PAGE_SIZE, MS_DEFAULT_ALIGNMENT);
+
+  void * const ptr_after = ms_heap_realloc(&heap, ptr_before, 4 * PAGE_SIZE);
+  md_assert(ptr_after != ptr_before);
+
+  ms_heap_free(&heap, ptr_after);
+  ms_heap_free(&heap, blocker);
+  md_assert(heap.free_list.first->size == HEAP_SIZE);
+}
+
+MD_CASE(realloc__shrink_in_place) {
+  void * const ptr_before = ms_heap_malloc(&heap, 4 * PAGE_SIZE, MS_DEFAULT_ALIGNMENT);
+  size_t const size_before = ms_heap_get_header(ptr_before)->size;
+
+  void * const ptr_after = ms_heap_realloc(&heap, ptr_before, PAGE_SIZE);
+  md_assert(ptr_after == ptr_before);
+  md_assert(ms_heap_get_header(ptr_after)->size < size_before);
+
+  // The tail can be reused
+  void * const tail = ms_heap_malloc(&heap, PAGE_SIZE, MS_DEFAULT_ALIGNMENT);
+  md_assert((uint8_t *)tail < (uint8_t *)ptr_before + size_before);
+
+  ms_heap_free(&heap, tail);
+  ms_heap_free(&heap, ptr_after);
+  md_assert(heap.free_list.first->size == HEAP_SIZE);
+}
+
 // Allocate two blocks and free them in allocation order
 // The allocator must fall back into its IC
 MD_CASE(inverse_free) {
@@ -137,10 +193,296 @@ MD_CASE(inverse_free) {
   md_assert(heap.free_list.first->size == HEAP_SIZE);
 }
 
+MD_CASE(malloc__fragmented) {
+  void *ptrs[64];
+
+  for(unsigned i = 0; i < 64; ++i) {
+    ptrs[i] = ms_heap_malloc(&heap, 64, MS_DEFAULT_ALIGNMENT);
+    md_assert(ptrs[i] != NULL);
+  }
+
+  for(unsigned i = 0; i < 64; i += 2) {
+    ms_heap_free(&heap, ptrs[i]);
+  }
+
+  // Holes are reused before the tail of the heap
+  void * const ptr = ms_heap_malloc(&heap, 64, MS_DEFAULT_ALIGNMENT);
+  md_assert(ptr != NULL);
+  md_assert(ptr < ptrs[63]);
+
+  ms_heap_free(&heap, ptr);
+
+  for(unsigned i = 1; i < 64; i += 2) {
+    ms_heap_free(&heap, ptrs[i]);
+  }
+
+  md_assert(heap.free_list.first->next == NULL);
+  md_assert(heap.free_list.first->size == HEAP_SIZE);
+}
+
+MD_CASE(free__out_of_order) {
+  void *ptrs[128];
+
+  for(unsigned i = 0; i < 128; ++i) {
+    ptrs[i] = ms_heap_malloc(&heap, 32 + i, MS_DEFAULT_ALIGNMENT);
+    md_assert(ptrs[i] != NULL);
+  }
+
+  // Stride coprime with the count visits every pointer once
+  for(unsigned i = 0; i < 128; ++i) {
+    ms_heap_free(&heap, ptrs[(i * 37) % 128]);
+  }
+
+  md_assert(heap.free_list.first == heap.free_list.root);
+  md_assert(heap.free_list.root->left == NULL);
+  md_assert(heap.free_list.root->right == NULL);
+  md_assert(heap.free_list.first->next == NULL);
+  md_assert(heap.free_list.first->size == HEAP_SIZE);
+}
+
+MD_CASE(malloc__exhausted) {
+  void * const ptr1 = ms_heap_malloc(&heap, HEAP_SIZE / 2, MS_DEFAULT_ALIGNMENT);
+  void * const ptr2 = ms_heap_malloc(&heap, HEAP_SIZE / 4, MS_DEFAULT_ALIGNMENT);
+  md_assert(ptr1 != NULL);
+  md_assert(ptr2 != NULL);
+
+  // Only the chunk of ptr1 can host this
+  ms_heap_free(&heap, ptr1);
+  void * const ptr3 = ms_heap_malloc(&heap, HEAP_SIZE / 2, MS_DEFAULT_ALIGNMENT);
+  md_assert(ptr3 == ptr1);
+
+  md_assert(ms_heap_malloc(&heap, HEAP_SIZE / 2, MS_DEFAULT_ALIGNMENT) == NULL);
+
+  ms_heap_free(&heap, ptr3);
+  ms_heap_free(&heap, ptr2);
+}
+
+MD_CASE(free__decommit_immediate) {
+  heap.decommit_policy = (ms_decommit_policy) { MS_DECOMMIT_IMMEDIATE, 0 };
+
+  void * const ptr = ms_heap_malloc(&heap, HEAP_SIZE / 2, MS_DEFAULT_ALIGNMENT);
+  md_assert(heap.committed_size >= HEAP_SIZE / 2);
+
+  ms_heap_free(&heap, ptr);
+  md_assert(heap.committed_size <= heap.commit_page_size);
+}
+
+MD_CASE(free__decommit_delayed) {
+  heap.decommit_policy = (ms_decommit_policy) { MS_DECOMMIT_DELAYED, 0 };
+
+  void * const ptr = ms_heap_malloc(&heap, HEAP_SIZE / 2, MS_DEFAULT_ALIGNMENT);
+  uint64_t const committed_size = heap.committed_size;
+
+  ms_heap_free(&heap, ptr);
+  md_assert(heap.committed_size == committed_size);
+
+  ms_heap_purge(&heap);
+  md_assert(heap.committed_size <= heap.commit_page_size);
+
+  // Memory is committed again on demand
+  uint8_t * const new_ptr = ms_heap_malloc(&heap, HEAP_SIZE / 2, MS_DEFAULT_ALIGNMENT);
+  new_ptr[HEAP_SIZE / 2 - 1] = 1;
+  ms_heap_free(&heap, new_ptr);
+}
+
+MD_CASE(trim) {
+  heap.decommit_policy = (ms_decommit_policy) { MS_DECOMMIT_DELAYED, 0 };
+
+  void * const head = ms_heap_malloc(&heap, PAGE_SIZE, MS_DEFAULT_ALIGNMENT);
+  void * const hole = ms_heap_malloc(&heap, HEAP_SIZE / 2, MS_DEFAULT_ALIGNMENT);
+  void * const tail = ms_heap_malloc(&heap, PAGE_SIZE, MS_DEFAULT_ALIGNMENT);
+
+  ms_heap_free(&heap, hole);
+
+  uint64_t const committed_size = heap.committed_size;
+  uint64_t const reset_size = ms_heap_trim(&heap);
+
+  md_assert(reset_size >= HEAP_SIZE / 2 - 2 * heap.commit_page_size);
+  md_assert(heap.committed_size <= committed_size);
+
+  // Interior free memory stays usable
+  uint8_t * const new_hole = ms_heap_malloc(&heap, HEAP_SIZE / 2, MS_DEFAULT_ALIGNMENT);
+
+  md_assert(new_hole == hole);
+  new_hole[0] = 1;
+  new_hole[HEAP_SIZE / 2 - 1] = 1;
+
+  ms_heap_free(&heap, new_hole);
+  ms_heap_free(&heap, tail);
+  ms_heap_free(&heap, head);
+
+  md_assert(heap.free_list.first->size == HEAP_SIZE);
+}
+
+MD_CASE(free__decommit_threshold) {
+  heap.decommit_policy = (ms_decommit_policy) { MS_DECOMMIT_THRESHOLD, HEAP_SIZE / 4 };
+
+  void * const small_ptr = ms_heap_malloc(&heap, HEAP_SIZE / 4, MS_DEFAULT_ALIGNMENT);
+  ms_heap_free(&heap, small_ptr);
+  md_assert(heap.committed_size >= HEAP_SIZE / 4); // Below twice the threshold
+
+  void * const large_ptr = ms_heap_malloc(&heap, HEAP_SIZE * 3 / 4, MS_DEFAULT_ALIGNMENT);
+  ms_heap_free(&heap, large_ptr);
+  md_assert(heap.committed_size <= HEAP_SIZE / 4 + 2 * heap.commit_page_size);
+}
+
+MD_CASE(free_n) {
+  ms_allocator const allocator = MS_ALLOCATOR_DEF_HEAP(heap);
+  void *ptrs[8];
+
+  heap.decommit_policy = (ms_decommit_policy) { MS_DECOMMIT_IMMEDIATE, 0 };
+
+  md_assert(ms_malloc_n(&allocator, HEAP_SIZE / 16, MS_DEFAULT_ALIGNMENT, ptrs, 8) == 8);
+  md_assert(heap.committed_size >= HEAP_SIZE / 2);
+
+  void * const live_ptr = ptrs[3];
+
+  ptrs[3] = NULL; // Skipped
+  ms_free_n(&allocator, ptrs, 8);
+  md_assert(heap.committed_size > heap.commit_page_size); // The fourth block is still live
+
+  ms_free_n(&allocator, &live_ptr, 1);
+
+  // Blocks are coalesced back into a single chunk
+  md_assert(heap.free_list.first != NULL);
+  md_assert(heap.committed_size <= heap.commit_page_size);
+}
+
+MD_CASE(free_sized) {
+  ms_allocator const allocator = MS_ALLOCATOR_DEF_HEAP(heap);
+  void * const ptr_before = ms_malloc(&allocator, PAGE_SIZE, MS_DEFAULT_ALIGNMENT);
+
+  ms_free_sized(&allocator, ptr_before, PAGE_SIZE); // Falls back to ms_heap_free()
+
+  void * const ptr_after = ms_heap_malloc(&heap, PAGE_SIZE, MS_DEFAULT_ALIGNMENT);
+  md_assert(ptr_before == ptr_after);
+}
+
 MD_CASE(static_constraints) {
   md_assert((MS_HEAP_DEALLOC_THR) >= sizeof(ms_free_list_node));
 }
 
+MD_CASE(malloc__huge_pages) { // Heap here uses huge pages
+  md_assert(heap.commit_page_size >= PAGE_SIZE);
+
+  uint8_t * const ptr = ms_heap_malloc(&heap, HEAP_SIZE / 2, MS_DEFAULT_ALIGNMENT);
+  md_assert(ptr != NULL);
+
+  ptr[0] = 1;
+  ptr[HEAP_SIZE / 2 - 1] = 1;
+
+  ms_heap_free(&heap, ptr);
+  md_assert(heap.free_list.first->size == HEAP_SIZE);
+}
+
+MD_CASE(get_stats) {
+  ms_memory_stats stats;
+
+  ms_heap_get_stats(&heap, &stats);
+  md_assert(stats.reserved_size == HEAP_SIZE);
+  md_assert(stats.committed_size == heap.committed_size);
+  md_assert(stats.live_size == 0);
+  md_assert(stats.free_node_count == 1);
+  md_assert(stats.free_size == HEAP_SIZE);
+  md_assert(stats.largest_free_size == HEAP_SIZE);
+  md_assert(stats.fragmentation == 0.0);
+
+  void * const ptr1 = ms_heap_malloc(&heap, PAGE_SIZE, MS_DEFAULT_ALIGNMENT);
+  void * const ptr2 = ms_heap_malloc(&heap, PAGE_SIZE, MS_DEFAULT_ALIGNMENT);
+  size_t const chunk_size = ms_heap_get_header(ptr1)->size;
+
+  ms_heap_free(&heap, ptr1);
+  ms_heap_get_stats(&heap, &stats);
+
+  md_assert(stats.live_size == ms_heap_get_header(ptr2)->size);
+  md_assert(stats.free_node_count == 2);
+  md_assert(stats.free_size == HEAP_SIZE - stats.live_size);
+  md_assert(stats.largest_free_size == HEAP_SIZE - chunk_size - stats.live_size);
+  md_assert(stats.fragmentation > 0.0);
+
+#ifdef MS_FEAT_MEMORY_STATS
+  md_assert(stats.alloc_count == 2);
+  md_assert(stats.free_count == 1);
+  md_assert(stats.peak_live_size == chunk_size + stats.live_size);
+#endif // MS_FEAT_MEMORY_STATS
+
+  ms_heap_free(&heap, ptr2);
+}
+
+MD_CASE(malloc__grow) {
+  heap.growth_size = HEAP_SIZE / 2;
+
+  void * const ptr1 = ms_heap_malloc(&heap, HEAP_SIZE - PAGE_SIZE, MS_DEFAULT_ALIGNMENT);
+  void * const ptr2 = ms_heap_malloc(&heap, HEAP_SIZE / 4, MS_DEFAULT_ALIGNMENT); // Served by a new region
+  void * const ptr3 = ms_heap_malloc(&heap, HEAP_SIZE * 2, MS_DEFAULT_ALIGNMENT); // Larger than the growth size
+
+  md_assert(ptr2 != NULL);
+  md_assert(ptr3 != NULL);
+  md_assert(heap.region_count == 2);
+  md_assert(ms_heap_owns(&heap, ptr2));
+  md_assert(ms_heap_owns(&heap, ptr3));
+  md_assert(!ms_heap_owns(heap.regions[0], ptr1));
+  md_assert((uintptr_t)ptr2 % MS_DEFAULT_ALIGNMENT == 0);
+
+  ms_memory_stats stats;
+  ms_heap_get_stats(&heap, &stats);
+
+  md_assert(stats.reserved_size > HEAP_SIZE * 3);
+  md_assert(stats.live_size >= HEAP_SIZE - PAGE_SIZE + HEAP_SIZE / 4 + HEAP_SIZE * 2);
+
+  // Empty regions are released
+  ms_heap_free(&heap, ptr3);
+  md_assert(heap.region_count == 1);
+
+  ms_heap_free(&heap, ptr2);
+  md_assert(heap.region_count == 0);
+
+  ms_heap_free(&heap, ptr1);
+}
+
+MD_CASE(malloc__grow_aligned) {
+  heap.growth_size = PAGE_SIZE;
+
+  void * const ptr1 = ms_heap_malloc(&heap, HEAP_SIZE - PAGE_SIZE, MS_DEFAULT_ALIGNMENT);
+  void *ptrs[4];
+
+  // Each allocation needs a new region, larger than the growth size
+  for(uint32_t i = 0; i < 4; ++i) {
+    ptrs[i] = ms_heap_malloc(&heap, 100, 1024);
+
+    md_assert(ptrs[i] != NULL);
+    md_assert((uintptr_t)ptrs[i] % 1024 == 0);
+    md_assert(heap.region_count <= i + 1);
+  }
+
+  ms_heap_free_n(&heap, ptrs, 4);
+  md_assert(heap.region_count == 0);
+
+  ms_heap_free(&heap, ptr1);
+}
+
+MD_CASE(realloc__grow) {
+  heap.growth_size = HEAP_SIZE;
+
+  void * const ptr1 = ms_heap_malloc(&heap, HEAP_SIZE - PAGE_SIZE, MS_DEFAULT_ALIGNMENT);
+  uint8_t * const ptr2 = ms_heap_malloc(&heap, PAGE_SIZE, MS_DEFAULT_ALIGNMENT);
+
+  ptr2[0] = 0xab;
+
+  // Relocated to another region
+  uint8_t * const new_ptr2 = ms_heap_realloc(&heap, ptr2, HEAP_SIZE * 2);
+
+  md_assert(new_ptr2 != NULL);
+  md_assert(new_ptr2[0] == 0xab);
+  md_assert(heap.region_count == 1);
+
+  void * const ptrs[] = { ptr1, new_ptr2 };
+  ms_heap_free_n(&heap, ptrs, 2);
+
+  md_assert(heap.region_count == 0);
+  md_assert(heap.free_list.first->size == HEAP_SIZE);
+}
+
 int main(int argc, char** argv) {
   md_suite suite = md_suite_create();
 
@@ -157,8 +499,27 @@ int main(int argc, char** argv) {
   md_add(&suite, realloc_more_within_page_boundary);
   md_add(&suite, realloc_more_cross_page_boundary);
   md_add(&suite, realloc_zero);
+  md_add(&suite, realloc__grow_in_place);
+  md_add(&suite, realloc__grow_blocked);
+  md_add(&suite, realloc__shrink_in_place);
   md_add(&suite, inverse_free);
+  md_add(&suite, malloc__fragmented);
+  md_add(&suite, malloc__exhausted);
+  md_add(&suite, free__out_of_order);
+  md_add(&suite, free__decommit_immediate);
+  md_add(&suite, free__decommit_delayed);
+  md_add(&suite, free__decommit_threshold);
+  md_add(&suite, trim);
+  md_add(&suite, free_n);
+  md_add(&suite, free_sized);
   md_add(&suite, static_constraints);
+  md_add(&suite, get_stats);
+  md_add(&suite, malloc__grow);
+  md_add(&suite, malloc__grow_aligned);
+  md_add(&suite, realloc__grow);
+
+  md_case * const malloc__huge_pages_case = md_add(&suite, malloc__huge_pages);
+  malloc__huge_pages_case->setup = each_setup_huge;
 
   return md_run(argc, argv, &suite);
 }
@@ -0,0 +1,230 @@
+#include <moonsugar/test.h>
+#include <moonsugar/thread-heap.h>
+
+static ms_mheap mheap;
+
+#define ARENA_SIZE (4llu * 1024 * 1024)
+#define PAGE_SIZE (4096llu)
+#define ARENA_COUNT (2u)
+#define THREAD_COUNT (4u)
+#define ALLOCATION_COUNT (256u)
+
+static void suite_setup(md_suite * const suite) {
+  ((void)suite);
+  MST_MEMORY_INIT();
+}
+
+static void suite_cleanup(md_suite * const suite) {
+  ((void)suite);
+  MST_MEMORY_DESTROY();
+}
+
+static void each_setup(void *ctx) {
+  ((void)ctx);
+
+  ms_mheap_construct(
+    &mheap,
+    &(ms_mheap_description) {
+      g_allocator,
+      ARENA_SIZE,
+      PAGE_SIZE,
+      0, // page_flags
+      ARENA_COUNT
+    }
+  );
+}
+
+static void each_cleanup(void *ctx) {
+  ((void)ctx);
+  ms_mheap_destroy(&mheap);
+}
+
+static bool is_arena_empty(ms_mheap_arena const *const arena) {
+  return arena->heap.free_list.first->next == NULL && arena->heap.free_list.first->size == ARENA_SIZE;
+}
+
+MD_CASE(construct) {
+  md_assert(mheap.arenas != NULL);
+  md_assert(mheap.arena_count == ARENA_COUNT);
+}
+
+MD_CASE(construct__failure) {
+  ms_mheap other;
+  ms_memory_stats stats_before, stats_after;
+
+  ms_heap_get_stats(&g_heap, &stats_before);
+
+  ms_result const result = ms_mheap_construct(
+    &other,
+    &(ms_mheap_description) {
+      g_allocator,
+      1llu << 62, // arena_size - cannot be reserved
+      PAGE_SIZE,
+      0, // page_flags
+      ARENA_COUNT
+    }
+  );
+
+  md_assert(result != MS_RESULT_SUCCESS);
+  md_assert(other.arenas == NULL);
+
+  ms_heap_get_stats(&g_heap, &stats_after);
+  md_assert(stats_after.live_size == stats_before.live_size); // Arena array released
+}
+
+MD_CASE(malloc) {
+  void * const ptr = ms_mheap_malloc(&mheap, 24, MS_DEFAULT_ALIGNMENT);
+
+  md_assert(ptr != NULL);
+  md_assert(ms_heap_get_header(ptr)->size >= 24);
+
+  ms_mheap_free(&mheap, ptr);
+
+  for(uint32_t i = 0; i < ARENA_COUNT; ++i) {
+    md_assert(is_arena_empty(&mheap.arenas[i]));
+  }
+}
+
+MD_CASE(malloc_zero) {
+  md_assert(ms_mheap_malloc(&mheap, 0, MS_DEFAULT_ALIGNMENT) == NULL);
+}
+
+MD_CASE(malloc__exhausted) {
+  // Larger than half an arena, so each arena fits a single one
+  void * const first = ms_mheap_malloc(&mheap, ARENA_SIZE / 2 + 1, MS_DEFAULT_ALIGNMENT);
+  void * const second = ms_mheap_malloc(&mheap, ARENA_SIZE / 2 + 1, MS_DEFAULT_ALIGNMENT);
+
+  md_assert(first != NULL);
+  md_assert(second != NULL);
+  md_assert(ms_mheap_malloc(&mheap, ARENA_SIZE / 2 + 1, MS_DEFAULT_ALIGNMENT) == NULL);
+
+  ms_mheap_free(&mheap, first);
+  ms_mheap_free(&mheap, second);
+}
+
+MD_CASE(realloc) {
+  uint8_t * const ptr = ms_mheap_malloc(&mheap, 16, MS_DEFAULT_ALIGNMENT);
+  md_assert(ptr != NULL);
+
+  for(uint8_t i = 0; i < 16; ++i) {
+    ptr[i] = i;
+  }
+
+  uint8_t * const new_ptr = ms_mheap_realloc(&mheap, ptr, 1024);
+  md_assert(new_ptr != NULL);
+
+  for(uint8_t i = 0; i < 16; ++i) {
+    md_assert(new_ptr[i] == i);
+  }
+
+  md_assert(ms_mheap_realloc(&mheap, new_ptr, 0) == NULL);
+}
+
+static void remote_free_main(void *const ctx) {
+  void ** const ptrs = ctx;
+
+  for(unsigned i = 0; i < ALLOCATION_COUNT; ++i) {
+    ms_mheap_free(&mheap, ptrs[i]);
+  }
+}
+
+MD_CASE(free__remote) {
+  void *ptrs[ALLOCATION_COUNT];
+
+  for(unsigned i = 0; i < ALLOCATION_COUNT; ++i) {
+    ptrs[i] = ms_mheap_malloc(&mheap, 64, MS_DEFAULT_ALIGNMENT);
+    md_assert(ptrs[i] != NULL);
+  }
+
+  ms_thread thread;
+  ms_thread_description const d = { remote_free_main, NULL, ptrs };
+
+  md_assert(ms_thread_spawn(&thread, &d) == MS_RESULT_SUCCESS);
+  ms_thread_join(&thread);
+
+  // Deferred blocks are released on the next allocation
+  void * const ptr = ms_mheap_malloc(&mheap, 64, MS_DEFAULT_ALIGNMENT);
+  md_assert(ptr == ptrs[0] || ptr == ptrs[ALLOCATION_COUNT - 1]);
+
+  ms_mheap_free(&mheap, ptr);
+
+  for(uint32_t i = 0; i < ARENA_COUNT; ++i) {
+    md_assert(is_arena_empty(&mheap.arenas[i]));
+  }
+}
+
+static void worker_main(void *const ctx) {
+  MS_ATOMIC(uint32_t) * const failure_count = ctx;
+  uint64_t *ptrs[ALLOCATION_COUNT];
+
+  for(unsigned round = 0; round < 64; ++round) {
+    for(unsigned i = 0; i < ALLOCATION_COUNT; ++i) {
+      ptrs[i] = ms_mheap_malloc(&mheap, 8 + (i * 8) % 512, MS_DEFAULT_ALIGNMENT);
+
+      if(ptrs[i] == NULL) {
+        ms_atomic_add_fetch(failure_count, 1, MS_MEMORY_ORDER_RELAXED);
+        return;
+      }
+
+      *ptrs[i] = (uint64_t)ptrs[i];
+    }
+
+    for(unsigned i = 0; i < ALLOCATION_COUNT; ++i) {
+      if(*ptrs[i] != (uint64_t)ptrs[i]) {
+        ms_atomic_add_fetch(failure_count, 1, MS_MEMORY_ORDER_RELAXED);
+      }
+
+      ms_mheap_free(&mheap, ptrs[i]);
+    }
+  }
+}
+
+MD_CASE(threads) {
+  MS_ATOMIC(uint32_t) failure_count = 0;
+  ms_thread threads[THREAD_COUNT];
+
+  for(unsigned i = 0; i < THREAD_COUNT; ++i) {
+    ms_thread_description const d = { worker_main, NULL, &failure_count };
+
+    md_assert(ms_thread_spawn(&threads[i], &d) == MS_RESULT_SUCCESS);
+  }
+
+  for(unsigned i = 0; i < THREAD_COUNT; ++i) {
+    ms_thread_join(&threads[i]);
+  }
+
+  md_assert(failure_count == 0);
+}
+
+MD_CASE(trim) {
+  void * const head = ms_mheap_malloc(&mheap, PAGE_SIZE, MS_DEFAULT_ALIGNMENT);
+  void * const hole = ms_mheap_malloc(&mheap, ARENA_SIZE / 2, MS_DEFAULT_ALIGNMENT);
+  void * const tail = ms_mheap_malloc(&mheap, PAGE_SIZE, MS_DEFAULT_ALIGNMENT);
+
+  ms_mheap_free(&mheap, hole);
+  md_assert(ms_mheap_trim(&mheap) >= ARENA_SIZE / 2 - 2 * PAGE_SIZE);
+
+  ms_mheap_free(&mheap, tail);
+  ms_mheap_free(&mheap, head);
+}
+
+int main(int argc, char** argv) {
+  md_suite suite = md_suite_create();
+
+  suite.suite_setup = suite_setup;
+  suite.suite_cleanup = suite_cleanup;
+  suite.each_setup = each_setup;
+  suite.each_cleanup = each_cleanup;
+
+  md_add(&suite, construct);
+  md_add(&suite, construct__failure);
+  md_add(&suite, malloc);
+  md_add(&suite, malloc_zero);
+  md_add(&suite, malloc__exhausted);
+  md_add(&suite, realloc);
+  md_add(&suite, free__remote);
+  md_add(&suite, threads);
+  md_add(&suite, trim);
+
+  return md_run(argc, argv, &suite);
+}
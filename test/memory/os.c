@@ -1,37 +1,111 @@
 #include <moondance/test.h>
 #include <moonsugar/memory.h>
+#include <moonsugar/sys.h>
 
 MD_CASE(reserve) {
-  void *const ptr = ms_reserve(1024);
+  void *const ptr = ms_reserve(1024, 0);
   md_assert(ptr);
 }
 
 MD_CASE(commit) {
-  void *const ptr = ms_reserve(1024);
+  void *const ptr = ms_reserve(1024, 0);
   md_assert(ptr);
 
-  bool const commit_result = ms_commit(ptr, 1024);
+  bool const commit_result = ms_commit(ptr, 1024, 0);
   md_assert(commit_result);
 }
 
 MD_CASE(release) {
-  void *const ptr = ms_reserve(1024);
+  void *const ptr = ms_reserve(1024, 0);
   md_assert(ptr);
 
-  bool const commit_result = ms_commit(ptr, 1024);
+  bool const commit_result = ms_commit(ptr, 1024, 0);
   md_assert(commit_result);
 
-  ms_release(ptr, 1024);
+  ms_release(ptr, 1024, 0);
 }
 
 MD_CASE(decommit) {
-  void *const ptr = ms_reserve(1024);
+  void *const ptr = ms_reserve(1024, 0);
   md_assert(ptr);
 
-  bool const commit_result = ms_commit(ptr, 1024);
+  bool const commit_result = ms_commit(ptr, 1024, 0);
   md_assert(commit_result);
 
-  ms_decommit(ptr, 1024);
+  ms_decommit(ptr, 1024, 0);
+}
+
+MD_CASE(reset) {
+  uint64_t const page_size = ms_get_sys_info()->page_size;
+  uint8_t *const ptr = ms_reserve(page_size * 4, 0);
+  md_assert(ptr);
+
+  bool const commit_result = ms_commit(ptr, page_size * 4, 0);
+  md_assert(commit_result);
+
+  ptr[page_size] = 1;
+  ms_reset(ptr + 1, page_size * 3, 0); // Partial pages are kept
+
+  // Pages stay accessible
+  ptr[0] = 1;
+  ptr[page_size] = 1;
+  md_assert(ptr[0] == 1);
+
+  ms_release(ptr, page_size * 4, 0);
+}
+
+MD_CASE(commit__huge) {
+  uint64_t const huge_page_size = ms_get_sys_info()->huge_page_size;
+
+  if(huge_page_size == 0) { // Huge pages are unsupported
+    return;
+  }
+
+  uint8_t *const ptr = ms_reserve(1024, MS_PAGE_HUGE_BIT);
+  md_assert(ptr);
+  md_assert(((uintptr_t)ptr & (huge_page_size - 1)) == 0);
+
+  bool const commit_result = ms_commit(ptr, 1024, MS_PAGE_HUGE_BIT);
+  md_assert(commit_result);
+
+  ptr[0] = 1;
+  ptr[huge_page_size - 1] = 1; // The whole huge page is committed
+
+  ms_decommit(ptr, 1024, MS_PAGE_HUGE_BIT);
+  ms_release(ptr, 1024, MS_PAGE_HUGE_BIT);
+}
+
+MD_CASE(commit__numa) {
+  ms_page_flags const flags[] = {
+    MS_PAGE_NUMA_PREFERRED_BIT | MS_PAGE_NUMA_NODE(0),
+    MS_PAGE_NUMA_BIND_BIT | MS_PAGE_NUMA_NODE(0),
+    MS_PAGE_NUMA_INTERLEAVE_BIT
+  };
+  uint64_t const page_size = ms_get_sys_info()->page_size;
+
+  md_assert(ms_get_sys_info()->numa_node_count >= 1);
+  md_assert(ms_get_sys_info()->numa_node_mask & 1);
+
+  for(uint32_t i = 0; i < sizeof(flags) / sizeof(flags[0]); ++i) {
+    uint8_t *const ptr = ms_reserve(page_size * 4, flags[i]);
+    md_assert(ptr);
+
+    bool const commit_result = ms_commit(ptr, page_size * 4, flags[i]);
+    md_assert(commit_result);
+
+    ptr[0] = 1;
+    ptr[page_size * 4 - 1] = 1;
+
+    ms_place(ptr, page_size * 4, flags[i]);
+    md_assert(ptr[0] == 1);
+
+    ms_release(ptr, page_size * 4, flags[i]);
+  }
+}
+
+MD_CASE(set_thread_numa_policy) {
+  md_assert(ms_set_thread_numa_policy(MS_PAGE_NUMA_PREFERRED_BIT | MS_PAGE_NUMA_NODE(0)));
+  md_assert(ms_set_thread_numa_policy(0)); // Restore the default policy
 }
 
 int main(int argc, char **argv) {
@@ -39,8 +113,12 @@ int main(int argc, char **argv) {
 
   md_add(&suite, commit);
   md_add(&suite, decommit);
+  md_add(&suite, reset);
   md_add(&suite, reserve);
   md_add(&suite, release);
+  md_add(&suite, commit__huge);
+  md_add(&suite, commit__numa);
+  md_add(&suite, set_thread_numa_policy);
 
   return md_run(argc, argv, &suite);
 }
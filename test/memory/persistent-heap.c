@@ -0,0 +1,207 @@
+#include <stdio.h>
+#include <moondance/test.h>
+#include <moonsugar/persistent-heap.h>
+
+#define HEAP_PATH "test-pheap.bin"
+#define OTHER_PATH "test-pheap-other.bin"
+#define HEAP_SIZE (256llu * 1024)
+
+typedef struct node {
+  struct node *next;
+  uint32_t value;
+} node;
+
+static ms_pheap_description const description = {
+  HEAP_PATH, // path
+  HEAP_SIZE, // size
+  NULL, // base
+  0 // flags
+};
+
+static void each_setup(void *ctx) {
+  ((void)ctx);
+  remove(HEAP_PATH);
+  remove(OTHER_PATH);
+}
+
+static void each_cleanup(void *ctx) {
+  ((void)ctx);
+  remove(HEAP_PATH);
+  remove(OTHER_PATH);
+}
+
+/**
+ * Build a two-node list rooted in the heap.
+ */
+static void populate(ms_pheap *const pheap) {
+  node *const a = ms_heap_malloc(pheap->heap, sizeof(node), MS_DEFAULT_ALIGNMENT);
+  node *const b = ms_heap_malloc(pheap->heap, sizeof(node), MS_DEFAULT_ALIGNMENT);
+
+  *a = (node) { b, 1 };
+  *b = (node) { NULL, 2 };
+
+  ms_pheap_set_root(pheap, a);
+}
+
+MD_CASE(open__new) {
+  ms_pheap pheap;
+
+  md_assert(ms_pheap_open(&pheap, &description) == MS_RESULT_SUCCESS);
+  md_assert(pheap.is_new);
+  md_assert(pheap.relocation_offset == 0);
+  md_assert(pheap.heap->size == HEAP_SIZE);
+  md_assert(ms_pheap_get_root(&pheap) == NULL);
+
+  ms_pheap_close(&pheap);
+}
+
+MD_CASE(reopen) {
+  ms_pheap pheap;
+
+  md_assert(ms_pheap_open(&pheap, &description) == MS_RESULT_SUCCESS);
+  populate(&pheap);
+  ms_pheap_close(&pheap);
+
+  md_assert(ms_pheap_open(&pheap, &description) == MS_RESULT_SUCCESS);
+  md_assert(!pheap.is_new);
+  md_assert(pheap.relocation_offset == 0);
+
+  node *const a = ms_pheap_get_root(&pheap);
+
+  md_assert(a != NULL);
+  md_assert(a->value == 1);
+  md_assert(a->next->value == 2);
+
+  ms_heap_free(pheap.heap, a->next);
+  ms_heap_free(pheap.heap, a);
+  ms_pheap_set_root(&pheap, NULL);
+
+  void *const ptr = ms_heap_malloc(pheap.heap, HEAP_SIZE / 2, MS_DEFAULT_ALIGNMENT);
+  md_assert(ptr != NULL);
+
+  ms_heap_free(pheap.heap, ptr);
+  ms_pheap_close(&pheap);
+}
+
+MD_CASE(reopen__in_use) {
+  ms_pheap pheap;
+  ms_pheap other;
+
+  md_assert(ms_pheap_open(&pheap, &description) == MS_RESULT_SUCCESS);
+  md_assert(ms_pheap_sync(&pheap));
+  md_assert(ms_pheap_open(&other, &description) == MS_RESULT_ACCESS);
+
+  ms_pheap_close(&pheap);
+}
+
+MD_CASE(reopen__not_closed) {
+  ms_pheap pheap;
+
+  md_assert(ms_pheap_open(&pheap, &description) == MS_RESULT_SUCCESS);
+  populate(&pheap);
+  md_assert(ms_pheap_sync(&pheap));
+
+  // Crash - the file is closed, not the heap
+  ms_unmap_file(&pheap.mapping);
+
+  md_assert(ms_pheap_open(&pheap, &description) == MS_RESULT_SUCCESS);
+
+  node *const a = ms_pheap_get_root(&pheap);
+
+  md_assert(a != NULL);
+  md_assert(a->value == 1);
+  md_assert(a->next->value == 2);
+
+  ms_pheap_close(&pheap);
+}
+
+MD_CASE(reopen__dirty) {
+  ms_pheap pheap;
+
+  md_assert(ms_pheap_open(&pheap, &description) == MS_RESULT_SUCCESS);
+  populate(&pheap);
+
+  // Crash before any sync
+  ms_unmap_file(&pheap.mapping);
+
+  md_assert(ms_pheap_open(&pheap, &description) == MS_RESULT_ACCESS);
+
+  ms_pheap_description recover = description;
+  recover.flags = MS_PHEAP_RECOVER_BIT;
+
+  md_assert(ms_pheap_open(&pheap, &recover) == MS_RESULT_SUCCESS);
+  md_assert(((node*)ms_pheap_get_root(&pheap))->value == 1);
+
+  ms_pheap_close(&pheap);
+
+  // Closing cleans the heap
+  md_assert(ms_pheap_open(&pheap, &description) == MS_RESULT_SUCCESS);
+  ms_pheap_close(&pheap);
+}
+
+MD_CASE(reopen__relocated) {
+  ms_pheap pheap;
+  ms_file_mapping blocker;
+
+  md_assert(ms_pheap_open(&pheap, &description) == MS_RESULT_SUCCESS);
+  populate(&pheap);
+
+  void *const previous_base = pheap.mapping.base;
+  uint64_t const previous_size = pheap.mapping.size;
+
+  ms_pheap_close(&pheap);
+
+  // Take the previous base away
+  md_assert(ms_map_file(OTHER_PATH, previous_size, previous_base, &blocker) == MS_RESULT_SUCCESS);
+
+  if(blocker.base != previous_base) {
+    ms_unmap_file(&blocker);
+    return; // Address not granted - nothing to test
+  }
+
+  md_assert(ms_pheap_open(&pheap, &description) == MS_RESULT_MEMORY);
+
+  ms_pheap_description relocatable = description;
+  relocatable.flags = MS_PHEAP_RELOCATABLE_BIT;
+
+  md_assert(ms_pheap_open(&pheap, &relocatable) == MS_RESULT_SUCCESS);
+  md_assert(pheap.relocation_offset != 0);
+  md_assert(pheap.relocation_offset == (uint8_t*)pheap.mapping.base - (uint8_t*)previous_base);
+
+  node *const a = ms_pheap_get_root(&pheap);
+
+  md_assert(ms_heap_owns(pheap.heap, a));
+  md_assert(a->value == 1);
+
+  // Pointers stored by the user are relocated by the user
+  a->next = (node*)((uint8_t*)a->next + pheap.relocation_offset);
+
+  md_assert(ms_heap_owns(pheap.heap, a->next));
+  md_assert(a->next->value == 2);
+
+  ms_heap_free(pheap.heap, a->next);
+
+  void *const ptr = ms_heap_malloc(pheap.heap, sizeof(node), MS_DEFAULT_ALIGNMENT);
+  md_assert(ms_heap_owns(pheap.heap, ptr));
+
+  ms_heap_free(pheap.heap, ptr);
+  ms_heap_free(pheap.heap, a);
+  ms_pheap_close(&pheap);
+  ms_unmap_file(&blocker);
+}
+
+int main(int argc, char** argv) {
+  md_suite suite = md_suite_create();
+
+  suite.each_setup = each_setup;
+  suite.each_cleanup = each_cleanup;
+
+  md_add(&suite, open__new);
+  md_add(&suite, reopen);
+  md_add(&suite, reopen__in_use);
+  md_add(&suite, reopen__not_closed);
+  md_add(&suite, reopen__dirty);
+  md_add(&suite, reopen__relocated);
+
+  return md_run(argc, argv, &suite);
+}
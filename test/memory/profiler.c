@@ -0,0 +1,214 @@
+#include <string.h>
+#include <moonsugar/test.h>
+#include <moonsugar/profiler.h>
+
+static ms_mprof mprof;
+
+#define SAMPLE_INTERVAL (1024u)
+#define ALLOCATION_COUNT (1024u)
+#define ALLOCATION_SIZE (64u)
+
+typedef struct {
+  char data[1024];
+  size_t size;
+  uint32_t line_count;
+} report_buffer;
+
+static void suite_setup(md_suite * const suite) {
+  ((void)suite);
+  MST_MEMORY_INIT();
+}
+
+static void suite_cleanup(md_suite * const suite) {
+  ((void)suite);
+  MST_MEMORY_DESTROY();
+}
+
+static void each_setup(void *ctx) {
+  ((void)ctx);
+
+  ms_result const result MSUNUSED = ms_mprof_construct(&mprof, &(ms_mprof_description) { g_allocator, 0 });
+}
+
+static void each_setup_sampled(void *ctx) {
+  ((void)ctx);
+
+  ms_result const result MSUNUSED = ms_mprof_construct(&mprof, &(ms_mprof_description) { g_allocator, SAMPLE_INTERVAL });
+}
+
+static void each_cleanup(void *ctx) {
+  ((void)ctx);
+  ms_mprof_destroy(&mprof);
+}
+
+static void write_report(void * const user, char const * const data, size_t const size) {
+  report_buffer * const buffer = user;
+
+  if(buffer->size + size < sizeof(buffer->data)) {
+    memcpy(buffer->data + buffer->size, data, size);
+    buffer->size += size;
+    buffer->data[buffer->size] = '\0';
+  }
+
+  buffer->line_count++;
+}
+
+// Allocations made by the same function share a call site
+static MSNOINLINE void allocate_from_site_a(void ** const ptrs, uint32_t const count, size_t const size) {
+  for(uint32_t i = 0; i < count; ++i) {
+    ptrs[i] = ms_mprof_malloc(&mprof, size, MS_DEFAULT_ALIGNMENT);
+  }
+}
+
+static MSNOINLINE void allocate_from_site_b(void ** const ptrs, uint32_t const count, size_t const size) {
+  for(uint32_t i = 0; i < count; ++i) {
+    ptrs[i] = ms_mprof_malloc(&mprof, size, MS_DEFAULT_ALIGNMENT);
+  }
+}
+
+MD_CASE(construct) {
+  md_assert(mprof.sites != NULL);
+  md_assert(mprof.samples != NULL);
+  md_assert(mprof.site_count == 0);
+  md_assert(mprof.sample_count == 0);
+}
+
+MD_CASE(malloc) {
+  void *ptrs[3];
+
+  allocate_from_site_a(ptrs, 2, 32);
+  allocate_from_site_b(ptrs + 2, 1, 16);
+
+  md_assert(ptrs[0] != NULL);
+  md_assert(ptrs[1] != NULL);
+  md_assert(ptrs[2] != NULL);
+  md_assert(mprof.site_count == 2);
+  md_assert(mprof.sample_count == 3);
+
+  md_assert(mprof.sites[0].live_count == 2);
+  md_assert(mprof.sites[0].live_size == 64);
+  md_assert(mprof.sites[1].live_count == 1);
+  md_assert(mprof.sites[1].live_size == 16);
+
+  for(uint32_t i = 0; i < 3; ++i) {
+    ms_mprof_free(&mprof, ptrs[i]);
+  }
+
+  md_assert(mprof.sample_count == 0);
+  md_assert(mprof.sites[0].live_size == 0);
+  md_assert(mprof.sites[0].alloc_count == 2);
+  md_assert(mprof.sites[0].alloc_size == 64);
+}
+
+MD_CASE(realloc) {
+  void *ptr;
+
+  allocate_from_site_a(&ptr, 1, 32);
+
+  void * const new_ptr = ms_mprof_realloc(&mprof, ptr, 128);
+
+  md_assert(new_ptr != NULL);
+  md_assert(mprof.sample_count == 1);
+  md_assert(mprof.sites[0].live_size == 0);
+  md_assert(mprof.sites[1].live_size == 128);
+
+  ms_mprof_free(&mprof, new_ptr);
+  md_assert(mprof.sample_count == 0);
+}
+
+static void *failing_realloc(void * const user, void * const ptr, size_t const new_count) {
+  ((void)user);
+  ((void)ptr);
+  ((void)new_count);
+
+  return NULL;
+}
+
+MD_CASE(realloc__failure) {
+  void *ptr;
+
+  allocate_from_site_a(&ptr, 1, 32);
+
+  ms_realloc_clbk const reallocate = mprof.allocator.reallocate;
+
+  mprof.allocator.reallocate = failing_realloc;
+  md_assert(ms_mprof_realloc(&mprof, ptr, 128) == NULL);
+  mprof.allocator.reallocate = reallocate;
+
+  // The block is still live
+  md_assert(mprof.sample_count == 1);
+  md_assert(mprof.sites[0].live_count == 1);
+  md_assert(mprof.sites[0].live_size == 32);
+
+  ms_mprof_free(&mprof, ptr);
+  md_assert(mprof.sample_count == 0);
+  md_assert(mprof.sites[0].live_size == 0);
+}
+
+MD_CASE(malloc__sampled) {
+  void *ptrs[ALLOCATION_COUNT];
+
+  allocate_from_site_a(ptrs, ALLOCATION_COUNT, ALLOCATION_SIZE);
+
+  uint64_t const total_size = ALLOCATION_COUNT * ALLOCATION_SIZE;
+
+  md_assert(mprof.site_count == 1);
+  md_assert(mprof.sample_count > 0);
+  md_assert(mprof.sample_count < ALLOCATION_COUNT);
+
+  // Estimates are within a factor of two of the actual size
+  md_assert(mprof.sites[0].live_size >= total_size / 2);
+  md_assert(mprof.sites[0].live_size <= total_size * 2);
+  md_assert(mprof.sites[0].live_count == mprof.sites[0].live_size / ALLOCATION_SIZE);
+
+  for(uint32_t i = 0; i < ALLOCATION_COUNT; ++i) {
+    ms_mprof_free(&mprof, ptrs[i]);
+  }
+
+  md_assert(mprof.sample_count == 0);
+  md_assert(mprof.sites[0].live_size == 0);
+  md_assert(mprof.sites[0].alloc_size >= total_size / 2);
+}
+
+MD_CASE(dump) {
+  report_buffer buffer = { { 0 }, 0, 0 };
+
+  void *ptr1, *ptr2;
+
+  allocate_from_site_a(&ptr1, 1, 32);
+  allocate_from_site_b(&ptr2, 1, 16);
+
+  ms_mprof_free(&mprof, ptr2);
+  ms_mprof_dump(&mprof, MS_MPROF_REPORT_LIVE_SIZE, write_report, &buffer);
+
+  md_assert(buffer.line_count == 1); // Sites without live memory are omitted
+  md_assert(buffer.size > 4);
+  md_assert(strcmp(buffer.data + buffer.size - 4, " 32\n") == 0);
+  md_assert(strchr(buffer.data, ';') != NULL);
+
+  buffer = (report_buffer) { { 0 }, 0, 0 };
+  ms_mprof_dump(&mprof, MS_MPROF_REPORT_ALLOC_COUNT, write_report, &buffer);
+  md_assert(buffer.line_count == 2);
+
+  ms_mprof_free(&mprof, ptr1);
+}
+
+int main(int argc, char** argv) {
+  md_suite suite = md_suite_create();
+
+  suite.suite_setup = suite_setup;
+  suite.suite_cleanup = suite_cleanup;
+  suite.each_setup = each_setup;
+  suite.each_cleanup = each_cleanup;
+
+  md_add(&suite, construct);
+  md_add(&suite, malloc);
+  md_add(&suite, realloc);
+  md_add(&suite, realloc__failure);
+  md_add(&suite, dump);
+
+  md_case * const malloc__sampled_case = md_add(&suite, malloc__sampled);
+  malloc__sampled_case->setup = each_setup_sampled;
+
+  return md_run(argc, argv, &suite);
+}
@@ -0,0 +1,153 @@
+#include <moonsugar/test.h>
+#include <moonsugar/util.h>
+#include <moonsugar/slab.h>
+
+static ms_slab slab;
+
+#define PAGE_SIZE (4096u)
+
+static void suite_setup(md_suite * const suite) {
+  ((void)suite);
+  MST_MEMORY_INIT();
+}
+
+static void suite_cleanup(md_suite * const suite) {
+  ((void)suite);
+  MST_MEMORY_DESTROY();
+}
+
+static void each_setup(void *ctx) {
+  ((void)ctx);
+
+  ms_result const result MSUNUSED = ms_slab_construct(&slab, &(ms_slab_description) { g_allocator, PAGE_SIZE });
+}
+
+static void each_cleanup(void *ctx) {
+  ((void)ctx);
+  ms_slab_destroy(&slab);
+}
+
+MD_CASE(get_class_size) {
+  md_assert(ms_slab_get_class_size(0) == 0);
+  md_assert(ms_slab_get_class_size(1) == 8);
+  md_assert(ms_slab_get_class_size(8) == 8);
+  md_assert(ms_slab_get_class_size(9) == 16);
+  md_assert(ms_slab_get_class_size(64) == 64);
+  md_assert(ms_slab_get_class_size(65) == 80);
+  md_assert(ms_slab_get_class_size(128) == 128);
+  md_assert(ms_slab_get_class_size(129) == 160);
+  md_assert(ms_slab_get_class_size(1000) == 1024);
+  md_assert(ms_slab_get_class_size(MS_SLAB_MAX_CLASS_SIZE) == MS_SLAB_MAX_CLASS_SIZE);
+  md_assert(ms_slab_get_class_size(MS_SLAB_MAX_CLASS_SIZE + 1) == 0);
+
+  for(size_t i = 1; i <= MS_SLAB_MAX_CLASS_SIZE; ++i) {
+    md_assert(ms_slab_get_class_size(i) >= i);
+  }
+}
+
+MD_CASE(malloc) {
+  uint8_t * const ptr1 = ms_slab_malloc(&slab, 24, MS_DEFAULT_ALIGNMENT);
+  uint8_t * const ptr2 = ms_slab_malloc(&slab, 24, MS_DEFAULT_ALIGNMENT);
+
+  md_assert(ptr1 != NULL);
+  md_assert(ptr2 != NULL);
+  md_assert(ms_is_multiple((uintptr_t)ptr1, MS_DEFAULT_ALIGNMENT));
+
+  // Small objects are packed without header
+  md_assert(ptr2 - ptr1 == 24 + sizeof(ms_pool_node));
+
+  ms_slab_free(&slab, ptr2);
+  ms_slab_free(&slab, ptr1);
+
+  md_assert(ms_slab_malloc(&slab, 20, MS_DEFAULT_ALIGNMENT) == ptr1);
+}
+
+MD_CASE(malloc_zero) {
+  md_assert(ms_slab_malloc(&slab, 0, MS_DEFAULT_ALIGNMENT) == NULL);
+}
+
+MD_CASE(malloc__large) {
+  void * const ptr = ms_slab_malloc(&slab, MS_SLAB_MAX_CLASS_SIZE + 1, MS_DEFAULT_ALIGNMENT);
+  void * const aligned_ptr = ms_slab_malloc(&slab, 32, 64);
+
+  md_assert(ptr != NULL);
+  md_assert(ms_heap_owns(&g_heap, ptr));
+  md_assert(aligned_ptr != NULL);
+  md_assert(ms_is_multiple((uintptr_t)aligned_ptr, 64));
+
+  ms_slab_free(&slab, ptr);
+  ms_slab_free(&slab, aligned_ptr);
+}
+
+MD_CASE(realloc) {
+  uint8_t * const ptr = ms_slab_malloc(&slab, 20, MS_DEFAULT_ALIGNMENT);
+
+  for(uint8_t i = 0; i < 20; ++i) {
+    ptr[i] = i;
+  }
+
+  md_assert(ms_slab_realloc(&slab, ptr, 24) == ptr); // Same class
+
+  uint8_t * const small_ptr = ms_slab_realloc(&slab, ptr, 100);
+  md_assert(small_ptr != ptr);
+
+  uint8_t * const large_ptr = ms_slab_realloc(&slab, small_ptr, 4096);
+  md_assert(large_ptr != NULL);
+
+  uint8_t * const larger_ptr = ms_slab_realloc(&slab, large_ptr, 8192);
+  md_assert(larger_ptr != NULL);
+
+  for(uint8_t i = 0; i < 20; ++i) {
+    md_assert(larger_ptr[i] == i);
+  }
+
+  md_assert(ms_slab_realloc(&slab, larger_ptr, 0) == NULL);
+}
+
+static bool fail_allocations;
+
+static void *failing_malloc(void * const user, size_t const count, size_t const alignment) {
+  return fail_allocations ? NULL : ms_heap_malloc(user, count, alignment);
+}
+
+static void *failing_realloc(void * const user, void * const ptr, size_t const new_count) {
+  return fail_allocations ? NULL : ms_heap_realloc(user, ptr, new_count);
+}
+
+MD_CASE(malloc__failure) {
+  ms_slab failing_slab;
+  ms_allocator allocator = g_allocator;
+
+  allocator.allocate = failing_malloc;
+  allocator.reallocate = failing_realloc;
+  md_assert(ms_slab_construct(&failing_slab, &(ms_slab_description) { allocator, PAGE_SIZE }) == MS_RESULT_SUCCESS);
+
+  fail_allocations = true;
+  md_assert(ms_slab_malloc(&failing_slab, 24, MS_DEFAULT_ALIGNMENT) == NULL);
+  md_assert(ms_slab_malloc(&failing_slab, MS_SLAB_MAX_CLASS_SIZE + 1, MS_DEFAULT_ALIGNMENT) == NULL);
+  fail_allocations = false;
+
+  void * const ptr = ms_slab_malloc(&failing_slab, 24, MS_DEFAULT_ALIGNMENT);
+  md_assert(ptr != NULL);
+
+  ms_slab_free(&failing_slab, ptr);
+  ms_slab_destroy(&failing_slab);
+}
+
+int main(int argc, char** argv) {
+  md_suite suite = md_suite_create();
+
+  suite.suite_setup = suite_setup;
+  suite.suite_cleanup = suite_cleanup;
+  suite.each_setup = each_setup;
+  suite.each_cleanup = each_cleanup;
+
+  md_add(&suite, get_class_size);
+  md_add(&suite, malloc);
+  md_add(&suite, malloc_zero);
+  md_add(&suite, malloc__large);
+  md_add(&suite, malloc__failure);
+  md_add(&suite, realloc);
+
+  return md_run(argc, argv, &suite);
+}
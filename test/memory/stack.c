@@ -0,0 +1,184 @@
+#include <moondance/test.h>
+#include <moonsugar/memory.h>
+#include <moonsugar/sys.h>
+#include <moonsugar/thread.h>
+
+static ms_stack stack;
+
+#define STACK_SIZE (4llu * 1024 * 1024)
+#define THREAD_COUNT (4u)
+#define ALLOCATION_COUNT (256u)
+
+void each_setup(void *ctx) {
+  ((void)ctx);
+  ms_stack_construct(&stack, STACK_SIZE, 0);
+}
+
+void each_cleanup(void *ctx) {
+  ((void)ctx);
+  ms_stack_clear(&stack);
+  ms_stack_destroy(&stack);
+}
+
+MD_CASE(malloc) {
+  uint8_t *const a = ms_stack_malloc(&stack, 3, MS_DEFAULT_ALIGNMENT);
+  uint8_t *const b = ms_stack_malloc(&stack, 16, MS_DEFAULT_ALIGNMENT);
+  uint8_t *const c = ms_stack_malloc(&stack, 16, 256);
+
+  md_assert(a == stack.base);
+  md_assert(b == a + MS_DEFAULT_ALIGNMENT);
+  md_assert(((uintptr_t)c & 255) == 0);
+
+  a[0] = 1;
+  b[15] = 1;
+  c[15] = 1;
+}
+
+MD_CASE(malloc__exhausted) {
+  md_assert(ms_stack_malloc(&stack, STACK_SIZE + 1, MS_DEFAULT_ALIGNMENT) == NULL);
+}
+
+MD_CASE(rewind) {
+  ms_stack_marker const outer = ms_stack_mark(&stack);
+  uint8_t *const a = ms_stack_malloc(&stack, 64, MS_DEFAULT_ALIGNMENT);
+
+  ms_stack_marker const inner = ms_stack_mark(&stack);
+  uint8_t *const b = ms_stack_malloc(&stack, 64, MS_DEFAULT_ALIGNMENT);
+
+  md_assert(outer == stack.base);
+  md_assert(inner == a + 64);
+  md_assert(b == inner);
+
+  ms_stack_rewind(&stack, inner);
+  md_assert(ms_stack_malloc(&stack, 64, MS_DEFAULT_ALIGNMENT) == b);
+
+  ms_stack_rewind(&stack, outer);
+  md_assert(ms_stack_mark(&stack) == stack.base);
+  md_assert(stack.committed_top > (uint8_t*)stack.base); // Rewinding does not decommit
+}
+
+MD_CASE(clear) {
+  stack.decommit_policy = (ms_decommit_policy) { MS_DECOMMIT_IMMEDIATE, 0 };
+
+  uint8_t *const ptr = ms_stack_malloc(&stack, 65536, MS_DEFAULT_ALIGNMENT);
+  ptr[65535] = 1;
+
+  md_assert(stack.committed_top >= ptr + 65536);
+
+  ms_stack_clear(&stack);
+
+  md_assert(stack.top == stack.base);
+  md_assert(stack.committed_top == stack.base);
+
+  // Decommitted memory is committed again
+  uint8_t *const new_ptr = ms_stack_malloc(&stack, 65536, MS_DEFAULT_ALIGNMENT);
+  new_ptr[65535] = 1;
+}
+
+MD_CASE(clear__threshold) {
+  uint64_t const page_size = ms_get_sys_info()->page_size;
+
+  stack.decommit_policy = (ms_decommit_policy) { MS_DECOMMIT_THRESHOLD, page_size };
+
+  uint8_t *const ptr = ms_stack_malloc(&stack, page_size * 4, MS_DEFAULT_ALIGNMENT);
+  ptr[0] = 1;
+
+  ms_stack_clear(&stack);
+
+  md_assert(stack.committed_top == (uint8_t*)stack.base + page_size);
+}
+
+static void worker_main(void *const ctx) {
+  MS_ATOMIC(uint32_t) * const failure_count = ctx;
+  uint64_t *ptrs[ALLOCATION_COUNT];
+
+  for(unsigned i = 0; i < ALLOCATION_COUNT; ++i) {
+    ptrs[i] = ms_stack_malloc(&stack, 8 + (i * 40) % 4096, MS_DEFAULT_ALIGNMENT);
+
+    if(ptrs[i] == NULL) {
+      ms_atomic_add_fetch(failure_count, 1, MS_MEMORY_ORDER_RELAXED);
+      return;
+    }
+
+    *ptrs[i] = (uint64_t)ptrs[i];
+  }
+
+  for(unsigned i = 0; i < ALLOCATION_COUNT; ++i) {
+    if(*ptrs[i] != (uint64_t)ptrs[i]) {
+      ms_atomic_add_fetch(failure_count, 1, MS_MEMORY_ORDER_RELAXED);
+    }
+  }
+}
+
+MD_CASE(threads) {
+  MS_ATOMIC(uint32_t) failure_count = 0;
+  ms_thread threads[THREAD_COUNT];
+
+  stack.decommit_policy = (ms_decommit_policy) { MS_DECOMMIT_IMMEDIATE, 0 };
+
+  for(unsigned round = 0; round < 8; ++round) {
+    for(unsigned i = 0; i < THREAD_COUNT; ++i) {
+      ms_thread_description const d = { worker_main, NULL, &failure_count };
+
+      md_assert(ms_thread_spawn(&threads[i], &d) == MS_RESULT_SUCCESS);
+    }
+
+    for(unsigned i = 0; i < THREAD_COUNT; ++i) {
+      ms_thread_join(&threads[i]);
+    }
+
+    ms_stack_clear(&stack);
+  }
+
+  md_assert(failure_count == 0);
+}
+
+static void thread_stack_main(void *const ctx) {
+  ms_stack **const out_stack = ctx;
+  ms_stack *const thread_stack = ms_stack_get_thread_stack();
+
+  ms_stack_marker const marker = ms_stack_mark(thread_stack);
+  uint8_t *const ptr = ms_stack_malloc(thread_stack, 64, MS_DEFAULT_ALIGNMENT);
+
+  if(ptr != NULL) {
+    ptr[63] = 1;
+    *out_stack = thread_stack;
+  }
+
+  ms_stack_rewind(thread_stack, marker);
+}
+
+MD_CASE(get_thread_stack) {
+  ms_stack *const thread_stack = ms_stack_get_thread_stack();
+  ms_stack *other_thread_stack = NULL;
+  ms_thread thread;
+
+  md_assert(thread_stack != NULL);
+  md_assert(ms_stack_get_thread_stack() == thread_stack);
+  md_assert(thread_stack->size == MS_STACK_THREAD_SIZE);
+
+  ms_thread_description const d = { thread_stack_main, NULL, &other_thread_stack };
+
+  md_assert(ms_thread_spawn(&thread, &d) == MS_RESULT_SUCCESS);
+  ms_thread_join(&thread);
+
+  md_assert(other_thread_stack != NULL);
+  md_assert(other_thread_stack != thread_stack);
+}
+
+int main(int argc, char **argv) {
+  md_suite suite = md_suite_create();
+
+  suite.each_setup = each_setup;
+  suite.each_cleanup = each_cleanup;
+
+  md_add(&suite, malloc);
+  md_add(&suite, malloc__exhausted);
+  md_add(&suite, rewind);
+  md_add(&suite, clear);
+  md_add(&suite, clear__threshold);
+  md_add(&suite, threads);
+  md_add(&suite, get_thread_stack);
+
+  return md_run(argc, argv, &suite);
+}
@@ -0,0 +1,167 @@
+#include <moondance/test.h>
+#include <moonsugar/thread-heap.h>
+
+static ms_heap heap;
+static ms_theap theap;
+
+#define HEAP_SIZE (16llu * 1024 * 1024)
+#define PAGE_SIZE (4096llu)
+#define THREAD_COUNT (4u)
+#define ALLOCATION_COUNT (256u)
+
+static void each_setup(void *ctx) {
+  ((void)ctx);
+  ms_heap_construct(&heap, HEAP_SIZE, PAGE_SIZE, 0);
+  ms_theap_construct(&theap, &heap);
+}
+
+static void each_cleanup(void *ctx) {
+  ((void)ctx);
+  ms_theap_destroy(&theap);
+  ms_heap_destroy(&heap);
+}
+
+static bool is_heap_empty(void) {
+  return heap.free_list.first->next == NULL && heap.free_list.first->size == HEAP_SIZE;
+}
+
+MD_CASE(malloc) {
+  void * const ptr = ms_theap_malloc(&theap, 24, MS_DEFAULT_ALIGNMENT);
+
+  md_assert(ptr != NULL);
+  md_assert(ms_heap_owns(&heap, ptr));
+  md_assert(ms_heap_get_header(ptr)->size >= 24);
+
+  ms_theap_free(&theap, ptr);
+}
+
+MD_CASE(malloc_zero) {
+  md_assert(ms_theap_malloc(&theap, 0, MS_DEFAULT_ALIGNMENT) == NULL);
+}
+
+MD_CASE(free__cached) {
+  void * const ptr_before = ms_theap_malloc(&theap, 24, MS_DEFAULT_ALIGNMENT);
+  ms_theap_free(&theap, ptr_before);
+
+  void * const ptr_after = ms_theap_malloc(&theap, 24, MS_DEFAULT_ALIGNMENT);
+  md_assert(ptr_before == ptr_after);
+
+  ms_theap_free(&theap, ptr_after);
+}
+
+MD_CASE(malloc__large) {
+  void * const ptr = ms_theap_malloc(&theap, 2 * MS_THEAP_MAX_CLASS_SIZE, MS_DEFAULT_ALIGNMENT);
+  md_assert(ptr != NULL);
+
+  ms_theap_free(&theap, ptr);
+  md_assert(is_heap_empty());
+}
+
+MD_CASE(malloc__aligned) {
+  void * const ptr = ms_theap_malloc(&theap, 16, 64);
+
+  md_assert(ptr != NULL);
+  md_assert(((uintptr_t)ptr & 63) == 0);
+
+  ms_theap_free(&theap, ptr);
+}
+
+MD_CASE(realloc) {
+  uint8_t * const ptr = ms_theap_malloc(&theap, 16, MS_DEFAULT_ALIGNMENT);
+  md_assert(ptr != NULL);
+
+  for(uint8_t i = 0; i < 16; ++i) {
+    ptr[i] = i;
+  }
+
+  uint8_t * const new_ptr = ms_theap_realloc(&theap, ptr, 1024);
+  md_assert(new_ptr != NULL);
+
+  for(uint8_t i = 0; i < 16; ++i) {
+    md_assert(new_ptr[i] == i);
+  }
+
+  md_assert(ms_theap_realloc(&theap, new_ptr, 0) == NULL);
+}
+
+MD_CASE(flush) {
+  void *ptrs[ALLOCATION_COUNT];
+
+  for(unsigned i = 0; i < ALLOCATION_COUNT; ++i) {
+    ptrs[i] = ms_theap_malloc(&theap, 1 + i % MS_THEAP_MAX_CLASS_SIZE, MS_DEFAULT_ALIGNMENT);
+    md_assert(ptrs[i] != NULL);
+  }
+
+  for(unsigned i = 0; i < ALLOCATION_COUNT; ++i) {
+    ms_theap_free(&theap, ptrs[i]);
+  }
+
+  md_assert(!is_heap_empty());
+
+  ms_theap_flush(&theap);
+  md_assert(is_heap_empty());
+}
+
+static void worker_main(void *const ctx) {
+  MS_ATOMIC(uint32_t) * const failure_count = ctx;
+  uint64_t *ptrs[ALLOCATION_COUNT];
+
+  for(unsigned round = 0; round < 64; ++round) {
+    for(unsigned i = 0; i < ALLOCATION_COUNT; ++i) {
+      ptrs[i] = ms_theap_malloc(&theap, 8 + (i * 8) % MS_THEAP_MAX_CLASS_SIZE, MS_DEFAULT_ALIGNMENT);
+
+      if(ptrs[i] == NULL) {
+        ms_atomic_add_fetch(failure_count, 1, MS_MEMORY_ORDER_RELAXED);
+        return;
+      }
+
+      *ptrs[i] = (uint64_t)ptrs[i];
+    }
+
+    for(unsigned i = 0; i < ALLOCATION_COUNT; ++i) {
+      if(*ptrs[i] != (uint64_t)ptrs[i]) {
+        ms_atomic_add_fetch(failure_count, 1, MS_MEMORY_ORDER_RELAXED);
+      }
+
+      ms_theap_free(&theap, ptrs[i]);
+    }
+  }
+}
+
+MD_CASE(threads) {
+  MS_ATOMIC(uint32_t) failure_count = 0;
+  ms_thread threads[THREAD_COUNT];
+
+  for(unsigned i = 0; i < THREAD_COUNT; ++i) {
+    ms_thread_description const d = { worker_main, NULL, &failure_count };
+
+    md_assert(ms_thread_spawn(&threads[i], &d) == MS_RESULT_SUCCESS);
+  }
+
+  for(unsigned i = 0; i < THREAD_COUNT; ++i) {
+    ms_thread_join(&threads[i]);
+  }
+
+  md_assert(failure_count == 0);
+
+  // Thread caches are flushed on exit
+  md_assert(is_heap_empty());
+}
+
+int main(int argc, char** argv) {
+  md_suite suite = md_suite_create();
+
+  suite.each_setup = each_setup;
+  suite.each_cleanup = each_cleanup;
+
+  md_add(&suite, malloc);
+  md_add(&suite, malloc_zero);
+  md_add(&suite, malloc__large);
+  md_add(&suite, malloc__aligned);
+  md_add(&suite, free__cached);
+  md_add(&suite, realloc);
+  md_add(&suite, flush);
+  md_add(&suite, threads);
+
+  return md_run(argc, argv, &suite);
+}
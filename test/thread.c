@@ -54,6 +54,14 @@ MD_CASE(lifecycle__multiple) {
   md_assert(ctx.n == 4);
 }
 
+MD_CASE(get_time) {
+  ms_time const start = ms_get_time();
+
+  ms_thread_sleep(ms_time_from_ms(2));
+
+  md_assert(ms_get_time() - start >= ms_time_from_ms(1));
+}
+
 int main(int argc, char **argv) {
   md_suite suite = md_suite_create();
 
@@ -61,6 +69,7 @@ int main(int argc, char **argv) {
 
   md_add(&suite, lifecycle__one);
   md_add(&suite, lifecycle__multiple);
+  md_add(&suite, get_time);
 
   return md_run(argc, argv, &suite);
 }